@@ -1,2 +1,4 @@
 get_filename_component(SELF_DIR "${CMAKE_CURRENT_LIST_FILE}" PATH)
+include(CMakeFindDependencyMacro)
+find_dependency(Threads)
 include(${SELF_DIR}/schnek.cmake)
@@ -32,6 +32,53 @@
 #include "grid/array.hpp"
 #include "grid/grid.hpp"
 
+#include <ostream>
+
+namespace schnek {
+  namespace internal {
+    /**
+     * @brief Buffered text output of the values of a grid
+     *
+     * Arithmetic values are formatted with std::to_chars into a large buffer
+     * that is passed to the stream in bulk. The output is the same as when
+     * writing the values to the stream directly. The fast path is only taken
+     * if the stream uses the default flags, no field width and the classic
+     * locale. Otherwise, and for all other types, the values are passed to the
+     * stream one by one.
+     */
+    template<typename T>
+    class DatastreamWriter {
+      private:
+        std::ostream &out;
+        bool fast;
+        int precision;
+        size_t pos;
+        char buffer[65536];
+
+      public:
+        DatastreamWriter(std::ostream &out);
+        ~DatastreamWriter() { flush(); }
+
+        /// Write a single value
+        void value(const T &val);
+        /// Write a single character
+        void put(char c);
+        /// Pass the buffered characters to the stream
+        void flush();
+    };
+  }  // namespace internal
+
+  /** @brief Write an object as raw binary data
+   *
+   * Grids, and classes derived from them, are written value by value in the
+   * same order as by the stream operators, i.e. with the first index varying
+   * fastest. Other trivially copyable types are written as they are. For all
+   * other types a std::runtime_error is thrown.
+   */
+  template<typename T>
+  void writeBinary(std::ostream &, const T &);
+}  // namespace schnek
+
 /** A simple stream operator for the Array template class
  *
  * This operator writes out the elements of the array separated by spaces.
@@ -24,6 +24,125 @@
  *
  */
 
+#include <charconv>
+#include <cstring>
+#include <locale>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "grid/iteration/range-iteration.hpp"
+
+namespace schnek {
+  namespace internal {
+    /// True for the types that are formatted with std::to_chars
+    template<typename T>
+    struct ToCharsFormattable : public std::false_type {};
+
+#ifdef __cpp_lib_to_chars
+    template<> struct ToCharsFormattable<short> : public std::true_type {};
+    template<> struct ToCharsFormattable<unsigned short> : public std::true_type {};
+    template<> struct ToCharsFormattable<int> : public std::true_type {};
+    template<> struct ToCharsFormattable<unsigned int> : public std::true_type {};
+    template<> struct ToCharsFormattable<long> : public std::true_type {};
+    template<> struct ToCharsFormattable<unsigned long> : public std::true_type {};
+    template<> struct ToCharsFormattable<long long> : public std::true_type {};
+    template<> struct ToCharsFormattable<unsigned long long> : public std::true_type {};
+    template<> struct ToCharsFormattable<float> : public std::true_type {};
+    template<> struct ToCharsFormattable<double> : public std::true_type {};
+    template<> struct ToCharsFormattable<long double> : public std::true_type {};
+#endif
+
+    template<typename T>
+    DatastreamWriter<T>::DatastreamWriter(std::ostream &out_) : out(out_), precision(out_.precision()), pos(0) {
+      fast = ToCharsFormattable<T>::value && ((out.flags() & ~std::ios_base::skipws) == std::ios_base::dec)
+             && (out.width() == 0) && (out.getloc() == std::locale::classic());
+    }
+
+    template<typename T>
+    inline void DatastreamWriter<T>::value(const T &val) {
+      if constexpr (ToCharsFormattable<T>::value) {
+        if (fast) {
+          // large enough for any value of an arithmetic type
+          if (sizeof(buffer) - pos < 128) flush();
+          std::to_chars_result res;
+          if constexpr (std::is_floating_point<T>::value)
+            res = std::to_chars(buffer + pos, buffer + sizeof(buffer), val, std::chars_format::general, precision);
+          else
+            res = std::to_chars(buffer + pos, buffer + sizeof(buffer), val);
+          pos = res.ptr - buffer;
+          return;
+        }
+      }
+      out << val;
+    }
+
+    template<typename T>
+    inline void DatastreamWriter<T>::put(char c) {
+      if (!fast) {
+        out.put(c);
+        return;
+      }
+      if (pos == sizeof(buffer)) flush();
+      buffer[pos++] = c;
+    }
+
+    template<typename T>
+    void DatastreamWriter<T>::flush() {
+      if (pos > 0) out.write(buffer, pos);
+      pos = 0;
+      out.flush();
+    }
+  }  // namespace internal
+
+  namespace internal {
+    /// True for grids and classes derived from them
+    template<typename T, typename = void>
+    struct IsGridLike : public std::false_type {};
+
+    template<typename T>
+    struct IsGridLike<T, std::void_t<typename T::value_type, typename T::RangeType, decltype(std::declval<const T &>().getLo())> >
+        : public std::true_type {};
+
+    template<typename GridType>
+    void writeBinaryGrid(std::ostream &out, const GridType &grid) {
+      typedef typename GridType::value_type T;
+      typedef typename GridType::RangeType RangeType;
+      static_assert(std::is_trivially_copyable<T>::value, "writeBinary needs a trivially copyable value type");
+
+      if (!(grid.getLo() <= grid.getHi())) return;
+
+      std::vector<T> buffer;
+      const size_t maxBuffer = 65536 / sizeof(T) + 1;
+      buffer.reserve(maxBuffer);
+
+      RangeFortranIterationPolicy<GridType::Rank>::forEach(
+          RangeType(grid.getLo(), grid.getHi()),
+          [&](const typename GridType::IndexType &pos) {
+            buffer.push_back(grid[pos]);
+            if (buffer.size() == maxBuffer) {
+              out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(T));
+              buffer.clear();
+            }
+          }
+      );
+      out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(T));
+    }
+  }  // namespace internal
+
+  template<typename T>
+  void writeBinary(std::ostream &out, const T &value) {
+    if constexpr (internal::IsGridLike<T>::value) {
+      internal::writeBinaryGrid(out, value);
+    } else if constexpr (std::is_trivially_copyable<T>::value) {
+      out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    } else {
+      throw std::runtime_error("Binary output is not supported for this type");
+    }
+  }
+}  // namespace schnek
+
 template<class T, size_t length, template<size_t> class CheckingPolicy>
 std::ostream &operator<<(std::ostream &out, const schnek::Array<T, length, CheckingPolicy> &arr) {
   if (length == 0) return out;
@@ -40,8 +159,12 @@ std::ostream &operator<<(std::ostream &out, const schnek::Grid<T, 1, CheckingPol
   const IndexType &high = M.getHi();
 
   if (!(low <= high)) return out;
-  out << M(low[0]);
-  for (int i = low[0] + 1; i <= high[0]; ++i) out << " " << M(i);
+  schnek::internal::DatastreamWriter<T> writer(out);
+  writer.value(M(low[0]));
+  for (int i = low[0] + 1; i <= high[0]; ++i) {
+    writer.put(' ');
+    writer.value(M(i));
+  }
   return out;
 }
 
@@ -53,10 +176,14 @@ std::ostream &operator<<(std::ostream &out, const schnek::Grid<T, 2, CheckingPol
   const IndexType &high = M.getHi();
 
   if (!(low <= high)) return out;
+  schnek::internal::DatastreamWriter<T> writer(out);
   for (int j = low[1]; j <= high[1]; ++j) {
-    out << M(low[0], j);
-    for (int i = low[0] + 1; i <= high[0]; ++i) out << " " << M(i, j);
-    out << std::endl;
+    writer.value(M(low[0], j));
+    for (int i = low[0] + 1; i <= high[0]; ++i) {
+      writer.put(' ');
+      writer.value(M(i, j));
+    }
+    writer.put('\n');
   }
 
   return out;
@@ -70,13 +197,17 @@ std::ostream &operator<<(std::ostream &out, const schnek::Grid<T, 3, CheckingPol
   const IndexType &high = M.getHi();
 
   if (!(low <= high)) return out;
+  schnek::internal::DatastreamWriter<T> writer(out);
   for (int k = low[2]; k <= high[2]; ++k) {
     for (int j = low[1]; j <= high[1]; ++j) {
-      out << M(low[0], j, k);
-      for (int i = low[0] + 1; i <= high[0]; ++i) out << " " << M(i, j, k);
-      out << std::endl;
+      writer.value(M(low[0], j, k));
+      for (int i = low[0] + 1; i <= high[0]; ++i) {
+        writer.put(' ');
+        writer.value(M(i, j, k));
+      }
+      writer.put('\n');
     }
-    out << std::endl;
+    writer.put('\n');
   }
 
   return out;
@@ -90,14 +221,18 @@ std::ostream &operator<<(std::ostream &out, const schnek::Grid<T, 4, CheckingPol
   const IndexType &high = M.getHi();
 
   if (!(low <= high)) return out;
+  schnek::internal::DatastreamWriter<T> writer(out);
   for (int l = low[3]; l <= high[3]; ++l) {
     for (int k = low[2]; k <= high[2]; ++k) {
       for (int j = low[1]; j <= high[1]; ++j) {
-        out << M(low[0], j, k, l);
-        for (int i = low[0] + 1; i <= high[0]; ++i) out << " " << M(i, j, k, l);
-        out << std::endl;
+        writer.value(M(low[0], j, k, l));
+        for (int i = low[0] + 1; i <= high[0]; ++i) {
+          writer.put(' ');
+          writer.value(M(i, j, k, l));
+        }
+        writer.put('\n');
       }
-      out << std::endl;
+      writer.put('\n');
     }
   }
 
@@ -112,15 +247,19 @@ std::ostream &operator<<(std::ostream &out, const schnek::Grid<T, 5, CheckingPol
   const IndexType &high = M.getHi();
 
   if (!(low <= high)) return out;
+  schnek::internal::DatastreamWriter<T> writer(out);
   for (int m = low[4]; m <= high[4]; ++m) {
     for (int l = low[3]; l <= high[3]; ++l) {
       for (int k = low[2]; k <= high[2]; ++k) {
         for (int j = low[1]; j <= high[1]; ++j) {
-          out << M(low[0], j, k, l, m);
-          for (int i = low[0] + 1; i <= high[0]; ++i) out << " " << M(i, j, k, l, m);
-          out << std::endl;
+          writer.value(M(low[0], j, k, l, m));
+          for (int i = low[0] + 1; i <= high[0]; ++i) {
+            writer.put(' ');
+            writer.value(M(i, j, k, l, m));
+          }
+          writer.put('\n');
         }
-        out << std::endl;
+        writer.put('\n');
       }
     }
   }
@@ -0,0 +1,117 @@
+/*
+ * asyncoutput.cpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "asyncoutput.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace schnek;
+
+AsyncOutputQueue::AsyncOutputQueue() : started(false), busy(false), maxPending(2), taskTime(0.0), waitTime(0.0) {}
+
+void AsyncOutputQueue::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    taskAdded.wait(lock, [this] { return !tasks.empty(); });
+
+    Task task = std::move(tasks.front());
+    tasks.pop_front();
+    busy = true;
+
+    lock.unlock();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    try {
+      task();
+    } catch (...) {
+      lock.lock();
+      if (!error) error = std::current_exception();
+      lock.unlock();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    lock.lock();
+
+    taskTime += elapsed.count();
+    busy = false;
+    taskDone.notify_all();
+  }
+}
+
+void AsyncOutputQueue::checkError() {
+  if (error) {
+    std::exception_ptr e = error;
+    error = nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+void AsyncOutputQueue::enqueue(Task task) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!started) {
+    // The singleton is never destroyed, so the thread runs until the program exits
+    std::thread(&AsyncOutputQueue::run, this).detach();
+    started = true;
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  taskDone.wait(lock, [this] { return tasks.size() < maxPending; });
+  std::chrono::duration<double> waited = std::chrono::steady_clock::now() - start;
+  waitTime += waited.count();
+  checkError();
+
+  tasks.push_back(std::move(task));
+  taskAdded.notify_one();
+}
+
+void AsyncOutputQueue::flush() {
+  std::unique_lock<std::mutex> lock(mutex);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  taskDone.wait(lock, [this] { return tasks.empty() && !busy; });
+  std::chrono::duration<double> waited = std::chrono::steady_clock::now() - start;
+  waitTime += waited.count();
+  checkError();
+}
+
+bool AsyncOutputQueue::idle() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return tasks.empty() && !busy;
+}
+
+void AsyncOutputQueue::setMaxPending(size_t maxPending_) {
+  std::lock_guard<std::mutex> lock(mutex);
+  maxPending = (maxPending_ > 0) ? maxPending_ : 1;
+  taskDone.notify_all();
+}
+
+double AsyncOutputQueue::collectTaskTime() {
+  std::lock_guard<std::mutex> lock(mutex);
+  // a wait that overlaps a task that is still running is matched at a later call
+  double overlap = std::min(taskTime, waitTime);
+  double time = taskTime - overlap;
+  waitTime -= overlap;
+  taskTime = 0.0;
+  return time;
+}
@@ -0,0 +1,186 @@
+/*
+ * asyncoutput.hpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCHNEK_ASYNCOUTPUT_HPP_
+#define SCHNEK_ASYNCOUTPUT_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../util/singleton.hpp"
+
+namespace schnek {
+
+  /** @brief A background thread that carries out output tasks
+   *
+   *  Tasks are executed one after the other in the order in which they were
+   *  added. The thread is started when the first task is added.
+   *
+   *  The number of tasks waiting in the queue is limited. When the limit is
+   *  reached, enqueue blocks until the I/O thread has caught up. This stops the
+   *  simulation from running arbitrarily far ahead of the output.
+   *
+   *  Exceptions thrown by a task are passed on to the caller of the next
+   *  enqueue or flush.
+   *
+   *  The queue is never destroyed. Tasks still pending when the program exits
+   *  are lost, so DiagnosticManager::flush() should be called at the end of a run.
+   */
+  class AsyncOutputQueue : public Singleton<AsyncOutputQueue> {
+    public:
+      typedef std::function<void()> Task;
+
+    private:
+      /// True once the I/O thread has been started
+      bool started;
+      std::mutex mutex;
+      /// Signals the I/O thread that tasks are available
+      std::condition_variable taskAdded;
+      /// Signals waiting callers that a task has completed
+      std::condition_variable taskDone;
+
+      std::deque<Task> tasks;
+      /// True while the I/O thread is executing a task
+      bool busy;
+      /// The maximum number of tasks waiting in the queue
+      size_t maxPending;
+      /// The first exception thrown by a task and not yet passed on
+      std::exception_ptr error;
+      /// The wall time in seconds spent executing tasks since the last call of collectTaskTime
+      double taskTime;
+      /// The wall time in seconds callers of enqueue and flush have waited for tasks and not yet matched with taskTime
+      double waitTime;
+
+      friend class Singleton<AsyncOutputQueue>;
+      friend class CreateUsingNew<AsyncOutputQueue>;
+
+      AsyncOutputQueue();
+
+      /// The main loop of the I/O thread
+      void run();
+
+      /// Rethrow a pending exception, the mutex must be held by the caller
+      void checkError();
+
+    public:
+      /** @brief Add a task to the queue
+       *
+       *  Blocks while the queue holds the maximum number of pending tasks.
+       */
+      void enqueue(Task task);
+
+      /// Wait until all tasks in the queue have been completed
+      void flush();
+
+      /// Return true if there are no pending or running tasks
+      bool idle();
+
+      /// Set the maximum number of tasks waiting in the queue
+      void setMaxPending(size_t maxPending_);
+
+      /** @brief Return the wall time in seconds spent executing tasks since the last call and reset it
+       *
+       *  The time callers of enqueue or flush have spent waiting for the tasks
+       *  is subtracted, because the callers already count it as their own.
+       */
+      double collectTaskTime();
+  };
+
+  /** @brief A pool of staging buffers for asynchronous output
+   *
+   *  The pool hands out at most `capacity` buffers at any time. A buffer is
+   *  returned to the pool when the last shared_ptr referring to it is released.
+   *  When all buffers are in use, acquire blocks until one is returned. With a
+   *  capacity of two this gives double buffering: one snapshot can be written
+   *  while the next one is taken.
+   *
+   *  All buffers must have been returned before the pool is destroyed.
+   */
+  template<class BufferType>
+  class StagingPool {
+    private:
+      std::mutex mutex;
+      std::condition_variable returned;
+      std::vector<std::unique_ptr<BufferType> > available;
+      size_t capacity;
+      size_t created;
+
+      void release(BufferType *buffer);
+
+    public:
+      /// Construct with the maximum number of buffers
+      StagingPool(size_t capacity_ = 2) : capacity(capacity_), created(0) {}
+
+      /** @brief Return a buffer from the pool
+       *
+       *  Buffers are reused, so their content is undefined. A new buffer is
+       *  only default constructed when none are available and the capacity
+       *  has not been reached.
+       */
+      std::shared_ptr<BufferType> acquire();
+
+      /// Set the maximum number of buffers
+      void setCapacity(size_t capacity_);
+  };
+
+  template<class BufferType>
+  void StagingPool<BufferType>::release(BufferType *buffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    available.emplace_back(buffer);
+    returned.notify_one();
+  }
+
+  template<class BufferType>
+  std::shared_ptr<BufferType> StagingPool<BufferType>::acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    returned.wait(lock, [this] { return !available.empty() || created < capacity; });
+
+    BufferType *buffer;
+    if (available.empty()) {
+      buffer = new BufferType();
+      ++created;
+    } else {
+      buffer = available.back().release();
+      available.pop_back();
+    }
+    return std::shared_ptr<BufferType>(buffer, [this](BufferType *b) { release(b); });
+  }
+
+  template<class BufferType>
+  void StagingPool<BufferType>::setCapacity(size_t capacity_) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = capacity_;
+  }
+
+}  // namespace schnek
+
+#endif  // SCHNEK_ASYNCOUTPUT_HPP_
@@ -26,22 +26,70 @@
 
 #include "diagnostic.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <set>
 #include <sstream>
 
+#include "../config.hpp"
 #include "../util/logger.hpp"
+#include "asyncoutput.hpp"
+
+#ifdef SCHNEK_HAVE_MPI
+#include <mpi.h>
+#endif
 
 #undef LOGLEVEL
 #define LOGLEVEL 0
 
 using namespace schnek;
 
-DiagnosticInterface::DiagnosticInterface() : fname(""), append(false) {}
+namespace {
+  /// The wall time in seconds from an arbitrary starting point
+  double wallTime() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+#ifdef SCHNEK_HAVE_MPI
+  /// A duplicate of MPI_COMM_WORLD for the reduction of the I/O fraction, created at the first call
+  MPI_Comm budgetCommunicator() {
+    static MPI_Comm comm = MPI_COMM_NULL;
+    if (comm == MPI_COMM_NULL) MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+    return comm;
+  }
+#endif
+}  // namespace
+
+DiagnosticInterface::DiagnosticInterface()
+    : fname(""),
+      append(false),
+      outputTime(0.0),
+      priority(1),
+      deferred(false),
+      averageCost(0.0),
+      totalCost(0.0),
+      outputCount(0),
+      skippedCount(0) {}
 
 void DiagnosticInterface::initParameters(BlockParameters &blockPars) {
   Block::initParameters(blockPars);
 
   blockPars.addParameter("file", &fname);
   blockPars.addParameter("append", &append, 0);
+  blockPars.addParameter("priority", &priority, 1);
+}
+
+void DiagnosticInterface::output(const std::string &fileName) {
+  double start = wallTime();
+  if (!appending()) open(fileName);
+  write();
+  if (!appending()) close();
+  double cost = wallTime() - start;
+
+  averageCost = (outputCount == 0) ? cost : 0.75 * averageCost + 0.25 * cost;
+  totalCost += cost;
+  ++outputCount;
 }
 
 bool DiagnosticInterface::appending() {
@@ -95,11 +143,15 @@ void IntervalDiagnostic::execute(bool master, int rank, int timeCounter) {
   SCHNEK_TRACE_LOG(2, "IntervalDiagnostic::execute" << fname << " " << rank)
   if (singleOut() && !master) return;
 
+  outputTime = timeCounter;
   if ((0 == timeCounter) && appending()) open(fname);
   if ((timeCounter < 0) || ((timeCounter % interval) == 0)) {
-    if (!appending()) open(parsedFileName(rank, timeCounter));
-    write();
-    if (!appending()) close();
+    // the final output is never skipped
+    if (deferred && (timeCounter >= 0)) {
+      skipOutput();
+      return;
+    }
+    output(parsedFileName(rank, timeCounter));
   }
 }
 
@@ -112,7 +164,7 @@ int IntervalDiagnostic::getInterval() {
   return interval;
 }
 
-DeltaTimeDiagnostic::DeltaTimeDiagnostic() : deltaTime(1.0), nextOutput(0.0), count(0) {
+DeltaTimeDiagnostic::DeltaTimeDiagnostic() : deltaTime(1.0), nextOutput(0.0), count(0), postponed(false) {
   DiagnosticManager::instance().addDeltaTimeDiagnostic(this);
 }
 
@@ -120,14 +172,30 @@ void DeltaTimeDiagnostic::execute(bool master, int rank, double physicalTime) {
   SCHNEK_TRACE_LOG(2, "DeltaTimeDiagnostic::execute" << fname << " " << rank)
   if (singleOut() && !master) return;
 
+  outputTime = physicalTime;
   if ((0.0 == physicalTime) && appending()) open(fname);
 
   if (physicalTime >= nextOutput) {
-    if (!appending()) open(parsedFileName(rank, count));
-    write();
-    if (!appending()) close();
+    // the output is written at the first call after the deferral has ended
+    if (deferred) {
+      if (!postponed) skipOutput();
+      postponed = true;
+      return;
+    }
+
+    output(parsedFileName(rank, count));
     nextOutput += deltaTime;
     ++count;
+
+    // skip the outputs that have passed while the output was deferred
+    if (postponed && (deltaTime > 0.0)) {
+      while (nextOutput <= physicalTime) {
+        nextOutput += deltaTime;
+        ++count;
+        skipOutput();
+      }
+    }
+    postponed = false;
   }
 }
 
@@ -139,6 +207,14 @@ double DeltaTimeDiagnostic::getDeltaTime() {
   return deltaTime;
 }
 
+void DeltaTimeDiagnostic::resumeAt(double physicalTime) {
+  if (deltaTime <= 0.0) return;
+  while (nextOutput < physicalTime) {
+    nextOutput += deltaTime;
+    ++count;
+  }
+}
+
 void DeltaTimeDiagnostic::initParameters(BlockParameters &blockPars) {
   DiagnosticInterface::initParameters(blockPars);
   blockPars.addParameter("deltaTime", &deltaTime, 1.0);
@@ -146,7 +222,16 @@ void DeltaTimeDiagnostic::initParameters(BlockParameters &blockPars) {
 }
 
 DiagnosticManager::DiagnosticManager()
-    : timecounter(0), physicalTime(0), usePhysicalTime(false), master(true), rank(0) {}
+    : timecounter(0),
+      physicalTime(0),
+      usePhysicalTime(false),
+      master(true),
+      rank(0),
+      ioBudget(0.0),
+      ioTime(0.0),
+      startTime(-1.0),
+      ioFraction(0.0),
+      deferredLevels(0) {}
 
 void DiagnosticManager::setTimeCounter(int *timecounter_) {
   timecounter = timecounter_;
@@ -166,6 +251,22 @@ void DiagnosticManager::setRank(int rank_) {
   rank = rank_;
 }
 
+int DiagnosticManager::getTimeCounter() const {
+  return timecounter ? *timecounter : 0;
+}
+
+double DiagnosticManager::getPhysicalTime() const {
+  return physicalTime ? *physicalTime : 0.0;
+}
+
+void DiagnosticManager::restoreTime(int timeCounter_, double physicalTime_) {
+  if (timecounter) *timecounter = timeCounter_;
+  if (physicalTime) *physicalTime = physicalTime_;
+  for (DeltaTimeDiagnostic *diag : deltaTimeDiags) {
+    diag->resumeAt(physicalTime_);
+  }
+}
+
 void DiagnosticManager::addIntervalDiagnostic(IntervalDiagnostic *diag) {
   intervalDiags.push_back(diag);
 }
@@ -186,6 +287,9 @@ void DiagnosticManager::execute() {
         "In DiagnosticManager: A time counter or physical time must be specified!"
     );
 
+  updateBudget();
+  double start = wallTime();
+
   for (IntervalDiagnostic *diag : intervalDiags) {
     diag->execute(master, rank, *timecounter);
   }
@@ -193,15 +297,65 @@ void DiagnosticManager::execute() {
   for (DeltaTimeDiagnostic *diag : deltaTimeDiags) {
     diag->execute(master, rank, *physicalTime);
   }
+
+  // asynchronous output is added once it has been written, without the time execute has waited for it
+  ioTime += wallTime() - start + AsyncOutputQueue::instance().collectTaskTime();
+}
+
+void DiagnosticManager::setIoBudget(double percent) {
+  ioBudget = percent;
+  if (ioBudget > 0.0) return;
+
+  deferredLevels = 0;
+  for (IntervalDiagnostic *diag : intervalDiags) diag->setDeferred(false);
+  for (DeltaTimeDiagnostic *diag : deltaTimeDiags) diag->setDeferred(false);
+}
+
+void DiagnosticManager::updateBudget() {
+  double now = wallTime();
+  if (startTime < 0.0) startTime = now;
+  double elapsed = now - startTime;
+  ioFraction = (elapsed > 0.0) ? 100.0 * ioTime / elapsed : 0.0;
+
+  if (ioBudget <= 0.0) return;
+
+#ifdef SCHNEK_HAVE_MPI
+  int initialised = 0, finalised = 0;
+  MPI_Initialized(&initialised);
+  MPI_Finalized(&finalised);
+  if (initialised && !finalised) MPI_Allreduce(MPI_IN_PLACE, &ioFraction, 1, MPI_DOUBLE, MPI_MAX, budgetCommunicator());
+#endif
+
+  std::set<int> priorities;
+  for (IntervalDiagnostic *diag : intervalDiags) priorities.insert(diag->getPriority());
+  for (DeltaTimeDiagnostic *diag : deltaTimeDiags) priorities.insert(diag->getPriority());
+  if (priorities.empty()) return;
+
+  // the highest priority is never deferred
+  size_t maxLevels = priorities.size() - 1;
+  if (ioFraction > ioBudget)
+    deferredLevels = std::min(deferredLevels + 1, maxLevels);
+  else if ((ioFraction < 0.8 * ioBudget) && (deferredLevels > 0))
+    --deferredLevels;
+  deferredLevels = std::min(deferredLevels, maxLevels);
+
+  int threshold = *std::next(priorities.begin(), deferredLevels);
+  for (IntervalDiagnostic *diag : intervalDiags) diag->setDeferred(diag->getPriority() < threshold);
+  for (DeltaTimeDiagnostic *diag : deltaTimeDiags) diag->setDeferred(diag->getPriority() < threshold);
 }
 
 double DiagnosticManager::adjustDeltaT(double deltaT) {
   double adjustedDt = deltaT;
 
   for (DeltaTimeDiagnostic *diag : deltaTimeDiags) {
+    if (diag->isDeferred()) continue;
     double dt = diag->getNextOutput() - *physicalTime;
     if (dt > 0) adjustedDt = std::min(adjustedDt, dt);
   }
 
   return adjustedDt;
 }
+
+void DiagnosticManager::flush() {
+  AsyncOutputQueue::instance().flush();
+}
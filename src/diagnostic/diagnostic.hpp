@@ -50,6 +50,19 @@ namespace schnek {
       std::string fname;
       /// Append data at every write to the same file?
       int append;
+      /// The time of the current output, the time step or the physical time
+      double outputTime;
+      /// Parameter: diagnostics with a low priority are deferred first when the I/O budget is exceeded
+      int priority;
+      /// Set by the DiagnosticManager when outputs should be deferred to keep within the I/O budget
+      bool deferred;
+
+    private:
+      /// The average wall time of an output in seconds, weighting recent outputs more
+      double averageCost;
+      double totalCost;
+      int outputCount;
+      int skippedCount;
 
     public:
       /// Default constructor
@@ -57,6 +70,18 @@ namespace schnek {
       /// Virtual destructor
       virtual ~DiagnosticInterface() {}
 
+      int getPriority() const { return priority; }
+      void setDeferred(bool deferred_) { deferred = deferred_; }
+      bool isDeferred() const { return deferred; }
+      /// The average wall time of an output in seconds, recent outputs have a higher weight
+      double getAverageCost() const { return averageCost; }
+      /// The total wall time spent in outputs in seconds
+      double getTotalCost() const { return totalCost; }
+      /// The number of outputs that have been written
+      int getOutputCount() const { return outputCount; }
+      /// The number of outputs that have been skipped or deferred because of the I/O budget
+      int getSkippedCount() const { return skippedCount; }
+
     protected:
       /// Open the output file
       virtual void open(const std::string &) {}
@@ -68,6 +93,11 @@ namespace schnek {
       virtual bool singleOut() { return false; }
       void initParameters(BlockParameters &);
 
+      /// Open, write and close an output and record its cost
+      void output(const std::string &fileName);
+      /// Count an output that has not been written because of the I/O budget
+      void skipOutput() { ++skippedCount; }
+
       bool appending();
       std::string parsedFileName(int rank, int timeCounter);
       std::string parsedFileName(int rank, double physicalTime);
@@ -94,6 +124,8 @@ namespace schnek {
       double deltaTime;
       double nextOutput;
       int count;
+      /// True if the next output has been deferred because of the I/O budget
+      bool postponed;
 
     public:
       DeltaTimeDiagnostic();
@@ -101,6 +133,8 @@ namespace schnek {
       virtual void execute(bool master, int rank, double physicalTime);
       double getNextOutput();
       double getDeltaTime();
+      /// Skip all outputs before the given physical time, e.g. after a restart
+      void resumeAt(double physicalTime);
 
     protected:
       void initParameters(BlockParameters &);
@@ -109,6 +143,18 @@ namespace schnek {
   typedef std::shared_ptr<DiagnosticInterface> pDiagnosticInterface;
   typedef std::list<pDiagnosticInterface> DiagList;
 
+  /**
+   * Calls the registered diagnostics and keeps track of the time spent in them
+   *
+   * An optional I/O budget limits the fraction of the wall time spent in
+   * diagnostics, including the time the I/O thread spends writing asynchronous
+   * output. While the budget is exceeded, the outputs of diagnostics with
+   * the lowest `priority` are deferred, one priority level more at every call
+   * of execute. Diagnostics with the highest priority are never deferred. When
+   * the fraction has fallen below 80% of the budget, the levels are released
+   * again. With MPI, the largest fraction of all processes is used, so that all
+   * processes take the same decision for collective output.
+   */
   class DiagnosticManager : public Singleton<DiagnosticManager> {
     private:
       std::list<IntervalDiagnostic *> intervalDiags;
@@ -121,6 +167,17 @@ namespace schnek {
       bool master;
       int rank;
 
+      /// The I/O budget in percent of the wall time, zero for no budget
+      double ioBudget;
+      /// The wall time in seconds spent in diagnostics and on the I/O thread since the first execute
+      double ioTime;
+      /// The wall time in seconds of the first execute
+      double startTime;
+      /// The fraction of the wall time spent in diagnostics, in percent
+      double ioFraction;
+      /// The number of priority levels that are deferred
+      size_t deferredLevels;
+
       friend class Singleton<DiagnosticManager>;
       friend class CreateUsingNew<DiagnosticManager>;
 
@@ -134,10 +191,51 @@ namespace schnek {
       void setMaster(bool master);
       void setRank(int rank);
 
+      /// The current time step, zero if no time counter has been set
+      int getTimeCounter() const;
+      /// The current physical time, zero if no physical time has been set
+      double getPhysicalTime() const;
+      bool isMaster() const { return master; }
+      int getRank() const { return rank; }
+
+      /** @brief Set the time counter and the physical time when restarting a simulation
+       *
+       *  The values are written into the variables passed to setTimeCounter and
+       *  setPhysicalTime. Diagnostics based on the physical time skip the outputs
+       *  that lie before the restart time.
+       */
+      void restoreTime(int timeCounter, double physicalTime);
+
+      /** @brief Reduce a time step so that the next output of a DeltaTimeDiagnostic is not missed
+       *
+       *  Diagnostics that are deferred because of the I/O budget are not taken
+       *  into account, so that their outputs do not cause additional steps.
+       */
       double adjustDeltaT(double deltaT);
 
+      /** @brief Limit the time spent in diagnostics to a percentage of the wall time
+       *
+       *  A value of zero or less switches the budget off. The wall time is
+       *  counted from the first call of execute.
+       */
+      void setIoBudget(double percent);
+      double getIoBudget() const { return ioBudget; }
+
+      /// The percentage of the wall time spent in diagnostics
+      double getIoFraction() const { return ioFraction; }
+
+      /** @brief Wait until all asynchronous output has been written
+       *
+       *  This should be called before the end of the simulation and before any
+       *  files written by diagnostics are read back.
+       */
+      void flush();
+
     private:
       DiagnosticManager();
+
+      /// Measure the I/O fraction and decide which diagnostics are deferred
+      void updateBudget();
   };
 
   template<class Type, typename PointerType = std::shared_ptr<Type>, class DiagnosticType = IntervalDiagnostic>
@@ -173,12 +271,24 @@ namespace schnek {
       void setSingleOut(bool single_out_) { single_out = single_out_; }
   };
 
+  /**
+   * Diagnostic writing a field into a text file using the stream operators
+   *
+   * With the `binary` parameter set, the raw values are written instead, see
+   * schnek::writeBinary.
+   */
   template<class Type, typename PointerType = std::shared_ptr<Type>, class DiagnosticType = IntervalDiagnostic>
   class SimpleFileDiagnostic : public SimpleDiagnostic<Type, PointerType, DiagnosticType> {
     private:
       std::ofstream output;
+      /// Parameter: write the raw binary values instead of text
+      int binary;
+
+    public:
+      SimpleFileDiagnostic() : binary(0) {}
 
     protected:
+      void initParameters(BlockParameters &);
       void open(const std::string &);
       void write();
       void close();
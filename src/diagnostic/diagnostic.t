@@ -24,6 +24,7 @@
  *
  */
 
+#include "../datastream.hpp"
 #include "../util/logger.hpp"
 
 #undef LOGLEVEL
@@ -48,15 +49,24 @@ namespace schnek {
     SCHNEK_TRACE_LOG(2, "got field " << field);
   }
 
+  template<class Type, typename PointerType, class DiagnosticType>
+  void SimpleFileDiagnostic<Type, PointerType, DiagnosticType>::initParameters(BlockParameters &blockPars) {
+    SimpleDiagnostic<Type, PointerType, DiagnosticType>::initParameters(blockPars);
+    blockPars.addParameter("binary", &binary, 0);
+  }
+
   template<class Type, typename PointerType, class DiagnosticType>
   void SimpleFileDiagnostic<Type, PointerType, DiagnosticType>::open(const std::string &fname) {
-    output.open(fname.c_str());
+    output.open(fname.c_str(), binary ? std::ios::out | std::ios::binary : std::ios::out);
     //  output.precision(14);
   }
 
   template<class Type, typename PointerType, class DiagnosticType>
   void SimpleFileDiagnostic<Type, PointerType, DiagnosticType>::write() {
-    output << *(this->field);
+    if (binary)
+      writeBinary(output, *(this->field));
+    else
+      output << *(this->field);
   }
 
   template<class Type, typename PointerType, class DiagnosticType>
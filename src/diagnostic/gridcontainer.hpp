@@ -0,0 +1,121 @@
+/*
+ * gridcontainer.hpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHNEK_DIAGNOSTIC_GRIDCONTAINER_HPP_
+#define SCHNEK_DIAGNOSTIC_GRIDCONTAINER_HPP_
+
+#include "../grid/field.hpp"
+
+namespace schnek {
+
+  /**
+   * A container type for grids that are being passed to the grid diagnostics
+   */
+  template<typename FieldType>
+  struct GridContainer {
+      /// The pointer to the grid
+      FieldType grid;
+
+      /// The global minimum coordinate
+      typename FieldType::IndexType global_min;
+
+      /// The global maximum coordinate
+      typename FieldType::IndexType global_max;
+
+      /// The local minimum coordinate
+      typename FieldType::IndexType local_min;
+
+      /// The local maximum coordinate
+      typename FieldType::IndexType local_max;
+
+      /// Only every stride-th cell, counted from global_min, is written
+      typename FieldType::IndexType stride;
+
+      /**
+       * True if only the strided cells of the inner region that lie between
+       * global_min and global_max are written.
+       *
+       * Without parallel HDF5, every process writes its whole grid including
+       * the ghost cells unless this is set.
+       */
+      bool subset;
+
+      /// Dimensions of extent one that are dropped from the dataset
+      Array<bool, FieldType::Rank> squeeze;
+
+      GridContainer()
+          : stride(FieldType::IndexType::Ones()), subset(false), squeeze(Array<bool, FieldType::Rank>::Zero()) {}
+  };
+
+  /**
+   * Fill a GridContainer with a grid and its local extent
+   *
+   * For fields only the inner region without the ghost cells is selected.
+   */
+  template<typename InnerType>
+  struct CopyToContainer {
+      static void copy(InnerType field, GridContainer<InnerType> &container);
+  };
+
+  template<
+      typename T,
+      size_t rank,
+      template<size_t>
+      class CheckingPolicy,
+      template<typename, size_t>
+      class StoragePolicy>
+  struct CopyToContainer<Field<T, rank, CheckingPolicy, StoragePolicy> > {
+      static void copy(
+          Field<T, rank, CheckingPolicy, StoragePolicy> field,
+          GridContainer<Field<T, rank, CheckingPolicy, StoragePolicy> > &container
+      );
+  };
+
+  template<
+      typename T,
+      size_t rank,
+      template<size_t>
+      class CheckingPolicy,
+      template<typename, size_t>
+      class StoragePolicy>
+  inline void CopyToContainer<Field<T, rank, CheckingPolicy, StoragePolicy> >::copy(
+      Field<T, rank, CheckingPolicy, StoragePolicy> field,
+      GridContainer<Field<T, rank, CheckingPolicy, StoragePolicy> > &container
+  ) {
+    container.grid = field;
+    container.local_min = field.getInnerLo();
+    container.local_max = field.getInnerHi();
+  }
+
+  template<typename InnerType>
+  inline void CopyToContainer<InnerType>::copy(InnerType field, GridContainer<InnerType> &container) {
+    container.grid = field;
+    container.local_min = field.getLo();
+    container.local_max = field.getHi();
+  }
+
+}  // namespace schnek
+
+#endif  // SCHNEK_DIAGNOSTIC_GRIDCONTAINER_HPP_
@@ -31,15 +31,40 @@
 #include "../util/logger.hpp"
 #include "hdfdiagnostic.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+
 #undef LOGLEVEL
 #define LOGLEVEL 0
 
 using namespace schnek;
 
-#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+#if defined(SCHNEK_HAVE_MPI) || (defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
 #include <mpi.h>
 #endif
 
+std::shared_ptr<HdfAttributes> HdfAttributes::snapshot() const {
+  std::shared_ptr<HdfAttributes> copy = std::make_shared<HdfAttributes>();
+  for (const std::pair<const std::string, pInfo>& p : attributes) {
+    const Info& info = *(p.second);
+    pInfo copyInfo(new Info);
+    copyInfo->type = info.type;
+    copyInfo->size = info.size;
+    copyInfo->dims = info.dims;
+    copyInfo->storage = std::make_shared<std::vector<char> >(info.size * info.dims);
+    std::memcpy(copyInfo->storage->data(), info.buffer, copyInfo->storage->size());
+    copyInfo->buffer = copyInfo->storage->data();
+    copy->attributes[p.first] = copyInfo;
+  }
+  return copy;
+}
+
+// ----------------------------------------------------------------------
+
 HdfStream::HdfStream()
     : file_id(-1),
       status(0),
@@ -47,13 +72,9 @@ HdfStream::HdfStream()
       attributes(std::make_shared<HdfAttributes>()),
       sets_count(0),
       active(true),
-      activeModified(false)
-#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
-      ,
-      commSet(false)
-#endif
-{
-}
+      activeModified(false),
+      activeChanged(false),
+      accessHintsChanged(false) {}
 
 HdfStream::HdfStream(const HdfStream& hdf)
     : file_id(hdf.file_id),
@@ -62,13 +83,10 @@ HdfStream::HdfStream(const HdfStream& hdf)
       attributes(hdf.attributes),
       sets_count(hdf.sets_count),
       active(true),
-      activeModified(false)
-#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
-      ,
-      commSet(false)
-#endif
-{
-}
+      activeModified(false),
+      activeChanged(false),
+      accessHints(hdf.accessHints),
+      accessHintsChanged(false) {}
 
 HdfStream& HdfStream::operator=(const HdfStream& hdf) {
   file_id = hdf.file_id;
@@ -78,9 +96,12 @@ HdfStream& HdfStream::operator=(const HdfStream& hdf) {
   attributes = hdf.attributes;
   active = hdf.active;
   activeModified = hdf.activeModified;
+  activeChanged = hdf.activeChanged;
+  accessHints = hdf.accessHints;
+  accessHintsChanged = true;
 #if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+  baseComm = hdf.baseComm;
   mpiComm = hdf.mpiComm;
-  commSet = hdf.commSet;
 #endif
   return *this;
 }
@@ -126,46 +147,82 @@ std::string HdfStream::getNextBlockName() {
 }
 
 #if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
-void HdfStream::makeMPIGroup() {
-  if (!activeModified) {
-    if (!commSet) {
-      mpiComm = MPI_COMM_WORLD;
-      commSet = true;
-    }
-    return;
+namespace {
+  /// Deleter for the communicators held by HdfStream
+  void freeCommunicator(MPI_Comm* comm) {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized && (*comm != MPI_COMM_WORLD) && (*comm != MPI_COMM_NULL)) MPI_Comm_free(comm);
+    delete comm;
   }
+}  // namespace
 
-  int rank, size;
-  MPI_Group worldGroup, activeGroup;
+void HdfStream::makeMPIGroup() {
+  if (!baseComm) baseComm = std::shared_ptr<MPI_Comm>(new MPI_Comm(MPI_COMM_WORLD), freeCommunicator);
+  if (!mpiComm) mpiComm = baseComm;
 
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-  MPI_Comm_group(MPI_COMM_WORLD, &worldGroup);
+  if (!activeModified) return;
+  activeModified = false;
 
-  int* inputArr = new int[size];
-  int* activeArr = new int[size];
+  int changed = activeChanged ? 1 : 0;
+  int anyChanged;
+  MPI_Allreduce(&changed, &anyChanged, 1, MPI_INT, MPI_LOR, *baseComm);
+  activeChanged = false;
 
-  for (int i = 0; i < size; ++i) inputArr[i] = 0;
-  if (active) inputArr[rank] = 1;
+  if (!anyChanged) return;
 
-  MPI_Allreduce(inputArr, activeArr, size, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  int rank;
+  MPI_Comm_rank(*baseComm, &rank);
 
-  int count = 0;
-  for (int i = 0; i < size; ++i) {
-    if (activeArr[i] > 0) {
-      inputArr[count] = i;
-      ++count;
-    }
-  }
+  MPI_Comm comm;
+  MPI_Comm_split(*baseComm, active ? 0 : MPI_UNDEFINED, rank, &comm);
+  mpiComm = std::shared_ptr<MPI_Comm>(new MPI_Comm(comm), freeCommunicator);
+}
+#endif
 
-  MPI_Group_incl(worldGroup, count, inputArr, &activeGroup);
-  MPI_Comm_create(MPI_COMM_WORLD, activeGroup, &mpiComm);
+void HdfStream::useOwnCommunicator() {
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+  if (baseComm && (*baseComm != MPI_COMM_WORLD)) return;
 
-  delete[] activeArr;
-  delete[] inputArr;
+  MPI_Comm comm;
+  MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+  baseComm = std::shared_ptr<MPI_Comm>(new MPI_Comm(comm), freeCommunicator);
 
-  activeModified = false;
+  // the group of active processes is split again from the duplicate
+  mpiComm.reset();
+  activeModified = true;
+  activeChanged = true;
+#endif
 }
+
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+
+namespace {
+  /// Create a file access property list for collective access through comm
+  hid_t createFileAccess(const HdfAccessHints& hints, MPI_Comm comm) {
+    hid_t plist_id = H5Pcreate(H5P_FILE_ACCESS);
+
+    H5Pset_sieve_buf_size(plist_id, hints.sieveBufSize);
+    H5Pset_alignment(plist_id, hints.alignThreshold, hints.alignment);
+
+    MPI_Info mpi_info;
+    MPI_Info_create(&mpi_info);
+
+    std::string cbBlockSize = std::to_string(hints.cbBlockSize);
+    std::string cbBufferSize = std::to_string(hints.cbBufferSize);
+
+    MPI_Info_set(mpi_info, "access_style", "write_once");
+    MPI_Info_set(mpi_info, "collective_buffering", "true");
+    MPI_Info_set(mpi_info, "cb_block_size", cbBlockSize.c_str());
+    MPI_Info_set(mpi_info, "cb_buffer_size", cbBufferSize.c_str());
+
+    /* set Parallel access with communicator, HDF5 keeps its own copy of the info */
+    H5Pset_fapl_mpio(plist_id, comm, mpi_info);
+    MPI_Info_free(&mpi_info);
+
+    return plist_id;
+  }
+}  // namespace
 #endif
 
 // ----------------------------------------------------------------------
@@ -182,45 +239,15 @@ int HdfIStream::open(const char* fname) {
   close();
 
 #if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
-  const int sieve_buf_size = 262144;
-  const int align_threshold = 1;  // 524288;
-  const int alignment = 1;        // 262144;
-
-  MPI_Info mpi_info;
-
   makeMPIGroup();
   if (active) {
     /* setup file access template */
-    hid_t plist_id = H5Pcreate(H5P_FILE_ACCESS);
-
-    H5Pset_sieve_buf_size(plist_id, sieve_buf_size);
-    H5Pset_alignment(plist_id, align_threshold, alignment);
-
-    MPI_Info_create(&mpi_info);
-
-    // MPI
-    const char access_style[] = "access_style";
-    const char write_once[] = "write_once";
-    const char collective_buffering[] = "collective_buffering";
-    const char strue[] = "true";
-    const char cb_block_size[] = "cb_block_size";
-    const char n1048576[] = "1048576";
-    const char cb_buffer_size[] = "cb_buffer_size";
-    const char n4194304[] = "4194304";
-
-    MPI_Info_set(mpi_info, access_style, write_once);
-    MPI_Info_set(mpi_info, collective_buffering, strue);
-    MPI_Info_set(mpi_info, cb_block_size, n1048576);
-    MPI_Info_set(mpi_info, cb_buffer_size, n4194304);
-
-    /* set Parallel access with communicator */
-    H5Pset_fapl_mpio(plist_id, mpiComm, mpi_info);
+    hid_t plist_id = createFileAccess(accessHints, *mpiComm);
 
     /* open the file collectively */
     file_id = H5Fopen(fname, H5F_ACC_RDONLY, plist_id);
 
     /* Release file-access template */
-    MPI_Info_free(&mpi_info);
     H5Pclose(plist_id);
 
     dxpl_id = H5Pcreate(H5P_DATASET_XFER);
@@ -236,62 +263,126 @@ int HdfIStream::open(const char* fname) {
   return 1;
 }
 
+bool HdfIStream::exists(const std::string& name) {
+  return active && (H5Lexists(file_id, name.c_str(), H5P_DEFAULT) > 0);
+}
+
+namespace {
+  /// Read an integer array attribute with the given number of values
+  bool readIntAttribute(hid_t object, const char* name, int* values, int count) {
+    if (H5Aexists(object, name) <= 0) return false;
+
+    hid_t attribute = H5Aopen(object, name, H5P_DEFAULT);
+    hid_t space = H5Aget_space(attribute);
+    bool match = (H5Sget_simple_extent_npoints(space) == count);
+    H5Sclose(space);
+
+    if (match) match = (H5Aread(attribute, H5T_NATIVE_INT, values) >= 0);
+    H5Aclose(attribute);
+    return match;
+  }
+}  // namespace
+
+bool HdfIStream::readPlacement(hid_t dataset, int rank, int* offset, int* innerMin, int* innerMax) {
+  hid_t space = H5Dget_space(dataset);
+  if (H5Sget_simple_extent_ndims(space) != rank) {
+    H5Sclose(space);
+    return false;
+  }
+  std::vector<hsize_t> dims(rank);
+  H5Sget_simple_extent_dims(space, dims.data(), NULL);
+  H5Sclose(space);
+
+  if (!readIntAttribute(dataset, "offset", offset, rank)) return false;
+
+  // without the inner region all the cells have been owned by the writing process
+  if (readIntAttribute(dataset, "inner_min", innerMin, rank) && readIntAttribute(dataset, "inner_max", innerMax, rank))
+    return true;
+
+  for (int i = 0; i < rank; ++i) {
+    innerMin[i] = offset[i];
+    innerMax[i] = offset[i] + int(dims[i]) - 1;
+  }
+  return true;
+}
+
 // ----------------------------------------------------------------------
 
-HdfOStream::HdfOStream() : HdfStream(), initialised(false) {}
+HdfOStream::HdfOStream() : HdfStream(), initialised(false), subfileSize(0) {}
 
-HdfOStream::HdfOStream(const HdfOStream& hdf) : HdfStream(hdf), initialised(hdf.initialised) {}
+HdfOStream::HdfOStream(const HdfOStream& hdf)
+    : HdfStream(hdf), initialised(hdf.initialised), subfileSize(hdf.subfileSize) {}
 
-HdfOStream::HdfOStream(const char* fname) : HdfStream(), initialised(false) {
+HdfOStream::HdfOStream(const char* fname) : HdfStream(), initialised(false), subfileSize(0) {
   open(fname);
 }
 
-int HdfOStream::open(const char* fname) {
-  sets_count = 0;
+HdfOStream::~HdfOStream() {
+  close();
+}
 
 #if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+namespace {
+  /// Insert the index of a subfile before the extension of the file name
+  std::string subfileName(const std::string& fname, int index) {
+    size_t slash = fname.find_last_of('/');
+    size_t dot = fname.find_last_of('.');
+    if ((dot == std::string::npos) || ((slash != std::string::npos) && (dot < slash))) dot = fname.length();
+    return fname.substr(0, dot) + "_" + std::to_string(index) + fname.substr(dot);
+  }
+}  // namespace
+#endif
 
-  const int sieve_buf_size = 262144;
-  const int align_threshold = 1;  // 524288;
-  const int alignment = 1;        // 262144;
+int HdfOStream::open(const char* fname) {
+  sets_count = 0;
 
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
   makeMPIGroup();
   if (active) {
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    std::shared_ptr<MPI_Comm> fileComm = mpiComm;
+    std::string fileName = fname;
+    mainFileName.clear();
+
+#if H5_VERSION_GE(1, 10, 0)
+    if (subfileSize > 0) {
+      // consecutive active processes write into the same subfile
+      if (!subfileComm || (subfileParent != mpiComm)) {
+        int rank;
+        MPI_Comm_rank(*mpiComm, &rank);
+        subfileIndex = rank / subfileSize;
+
+        MPI_Comm comm;
+        MPI_Comm_split(*mpiComm, subfileIndex, rank, &comm);
+        subfileComm = std::shared_ptr<MPI_Comm>(new MPI_Comm(comm), freeCommunicator);
+        subfileParent = mpiComm;
+      }
+      fileComm = subfileComm;
+      mainFileName = fname;
+      fileName = subfileName(mainFileName, subfileIndex);
+    }
+#else
+    static bool warned = false;
+    if ((subfileSize > 0) && !warned) {
+      std::cerr << "WARNING: HDF5 subfiling needs virtual datasets from HDF5 1.10 and is switched off\n";
+      warned = true;
+    }
+#endif
+
+    if (initialised && ((plistComm != fileComm) || accessHintsChanged)) {
+      H5Pclose(plist_id);
+      H5Pclose(dxpl_id);
+      initialised = false;
+    }
 
     if (!initialised) {
       /* setup file access template */
-
-      plist_id = H5Pcreate(H5P_FILE_ACCESS);
-
-      H5Pset_sieve_buf_size(plist_id, sieve_buf_size);
-      H5Pset_alignment(plist_id, align_threshold, alignment);
-
-      MPI_Info_create(&mpi_info);
-
-      // MPI
-      const char access_style[] = "access_style";
-      const char write_once[] = "write_once";
-      const char collective_buffering[] = "collective_buffering";
-      const char strue[] = "true";
-      const char cb_block_size[] = "cb_block_size";
-      const char n1048576[] = "1048576";
-      const char cb_buffer_size[] = "cb_buffer_size";
-      const char n4194304[] = "4194304";
-
-      MPI_Info_set(mpi_info, access_style, write_once);
-      MPI_Info_set(mpi_info, collective_buffering, strue);
-      MPI_Info_set(mpi_info, cb_block_size, n1048576);
-      MPI_Info_set(mpi_info, cb_buffer_size, n4194304);
-
-      /* set Parallel access with communicator */
-      H5Pset_fapl_mpio(plist_id, mpiComm, mpi_info);
+      plist_id = createFileAccess(accessHints, *fileComm);
+      plistComm = fileComm;
+      accessHintsChanged = false;
     }
 
     /* open the file collectively */
-    // H5Pset_fapl_mpiposix(plist_id, mpiComm, 0);
-    file_id = H5Fcreate(fname, H5F_ACC_TRUNC, H5P_DEFAULT, plist_id);
+    file_id = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id);
 
     if (!initialised) {
       dxpl_id = H5Pcreate(H5P_DATASET_XFER);
@@ -313,6 +404,526 @@ int HdfOStream::open(const char* fname) {
   return file_id;
 }
 
+namespace {
+  /// HDF5 does not allow chunks of 4GB or more, chunks are kept below 2GB to stay clear of the limit
+  const hsize_t maxChunkBytes = hsize_t(1) << 31;
+}  // namespace
+
+bool HdfDatasetOptions::chunked() const {
+  for (hsize_t c : chunk)
+    if (c > 0) return true;
+  return (deflate > 0) || shuffle || (scaleOffset >= 0);
+}
+
+hid_t HdfOStream::createDatasetProperties(
+    int rank, const hsize_t* dims, const hsize_t* locdims, hid_t type, bool series
+) {
+  // extendible datasets must be chunked
+  if (!series && !datasetOptions.chunked()) return H5P_DEFAULT;
+
+  // the time dimension of a series is not part of the chunk options
+  int offset = series ? 1 : 0;
+  std::vector<hsize_t> chunk(rank, 0);
+  bool automatic = false;
+  for (int i = offset; i < rank; ++i) {
+    if (size_t(i - offset) < datasetOptions.chunk.size()) chunk[i] = datasetOptions.chunk[i - offset];
+    if (chunk[i] == 0) automatic = true;
+  }
+  if (series) chunk[0] = 1;
+
+  if (automatic) {
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+    // Align the chunks with the process domains, so that most chunks are
+    // written by a single process
+    std::vector<unsigned long long> local(locdims, locdims + rank);
+    std::vector<unsigned long long> maxLocal(rank);
+    MPI_Allreduce(local.data(), maxLocal.data(), rank, MPI_UNSIGNED_LONG_LONG, MPI_MAX, *mpiComm);
+    for (int i = 0; i < rank; ++i)
+      if (chunk[i] == 0) chunk[i] = maxLocal[i];
+#else
+    for (int i = 0; i < rank; ++i)
+      if (chunk[i] == 0) chunk[i] = locdims[i];
+#endif
+  }
+
+  hsize_t chunkBytes = H5Tget_size(type);
+  for (int i = 0; i < rank; ++i) {
+    chunk[i] = std::max(hsize_t(1), std::min(chunk[i], dims[i]));
+    chunkBytes *= chunk[i];
+  }
+
+  while (chunkBytes >= maxChunkBytes) {
+    int largest = std::max_element(chunk.begin(), chunk.end()) - chunk.begin();
+    chunkBytes = chunkBytes / chunk[largest] * ((chunk[largest] + 1) / 2);
+    chunk[largest] = (chunk[largest] + 1) / 2;
+  }
+
+  hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(dcpl, rank, chunk.data());
+
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL) && !H5_VERSION_GE(1, 10, 2)
+  // Filters with parallel writes are only supported from HDF5 1.10.2
+  static bool warned = false;
+  if (!warned && ((datasetOptions.deflate > 0) || datasetOptions.shuffle || (datasetOptions.scaleOffset >= 0))) {
+    std::cerr << "WARNING: HDF5 filters need HDF5 1.10.2 or later for parallel output and are switched off\n";
+    warned = true;
+  }
+#else
+  if (datasetOptions.scaleOffset >= 0) {
+    if (H5Tget_class(type) == H5T_FLOAT)
+      H5Pset_scaleoffset(dcpl, H5Z_SO_FLOAT_DSCALE, datasetOptions.scaleOffset);
+    else
+      H5Pset_scaleoffset(dcpl, H5Z_SO_INT, H5Z_SO_INT_MINBITS_DEFAULT);
+  }
+
+  if (datasetOptions.shuffle) H5Pset_shuffle(dcpl);
+
+  if (datasetOptions.deflate > 0) {
+    if (H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0) {
+      H5Pset_deflate(dcpl, std::min(datasetOptions.deflate, 9));
+    } else {
+      static bool warned = false;
+      if (!warned) std::cerr << "WARNING: The HDF5 deflate filter is not available, writing uncompressed data\n";
+      warned = true;
+    }
+  }
+#endif
+
+  return dcpl;
+}
+
+void HdfOStream::writeAttributes(hid_t dataset) {
+  int mpi_rank = 0;
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+  MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+#endif
+
+  if (mpi_rank == 0) writeAttributes(dataset, *attributes);
+}
+
+const HdfAttributes& HdfOStream::fortranOrderAttributes() {
+  static const int fortranOrder = 1;
+  static const pHdfAttributes layout = []() {
+    HdfAttributes attributes;
+    attributes.set("fortran_order", fortranOrder);
+    return attributes.snapshot();
+  }();
+  return *layout;
+}
+
+void HdfOStream::writeAttributes(hid_t dataset, const HdfAttributes& attributes) {
+  /* Create the data space for the attribute. */
+  typedef std::pair<std::string, HdfAttributes::pInfo> attPair;
+  for (attPair p : attributes.attributes) {
+    HdfAttributes::Info& info = *(p.second);
+
+    const hid_t dataspace_id = H5Screate_simple(1, &info.dims, NULL);
+    /* Create a dataset attribute. */
+    const hid_t attribute_id = H5Acreate2(dataset, p.first.c_str(), info.type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+
+    /* Write the attribute data. */
+    herr_t ret = H5Awrite(attribute_id, info.type, info.buffer);
+    assert(ret != -1);
+
+    /* Close the attribute. */
+    H5Aclose(attribute_id);
+
+    /* Close the dataspace. */
+    H5Sclose(dataspace_id);
+  }
+}
+
+void HdfOStream::writeFileAttributes(const HdfAttributes& attributes, const std::string& group) {
+  if (!active) return;
+
+  if (group.empty()) {
+    writeAttributes(file_id, attributes);
+    return;
+  }
+
+  hid_t group_id = H5Gcreate2(file_id, group.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  assert(group_id != -1);
+  writeAttributes(group_id, attributes);
+  H5Gclose(group_id);
+}
+
+void HdfOStream::finishGridDataset(DatasetWrite& w) {
+  if (w.memSpace != H5S_ALL) H5Sclose(w.memSpace);
+  if (w.fileSpace != H5S_ALL) H5Sclose(w.fileSpace);
+
+  /* now write the attributes */
+  writeAttributes(w.dataset);
+  // the data cannot be decoded without these, all processes writing the file create them collectively
+  if (w.scaling) writeAttributes(w.dataset, *w.scaling);
+  if (w.reversed) writeAttributes(w.dataset, fortranOrderAttributes());
+  if (w.xfer != dxpl_id) H5Pclose(w.xfer);
+
+  /* close dataset collectively */
+  herr_t ret = H5Dclose(w.dataset);
+  assert(ret != -1);
+
+  /* release all IDs created */
+  H5Sclose(w.sid);
+}
+
+void HdfOStream::appendTime(double time) {
+  if (!active) return;
+
+  const char* name = "time";
+  hsize_t current = 0;
+  hsize_t one = 1;
+  hid_t dataset;
+  herr_t ret;
+
+  if (H5Lexists(file_id, name, H5P_DEFAULT) > 0) {
+    dataset = H5Dopen2(file_id, name, H5P_DEFAULT);
+    hid_t space = H5Dget_space(dataset);
+    H5Sget_simple_extent_dims(space, &current, NULL);
+    H5Sclose(space);
+
+    hsize_t newSize = current + 1;
+    ret = H5Dset_extent(dataset, &newSize);
+    assert(ret != -1);
+  } else {
+    hsize_t maxdims = H5S_UNLIMITED;
+    hsize_t chunk = 1024;
+    hid_t space = H5Screate_simple(1, &one, &maxdims);
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 1, &chunk);
+    dataset = H5Dcreate2(file_id, name, H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+  }
+  assert(dataset > -1);
+
+  hid_t file_dataspace = H5Dget_space(dataset);
+  hid_t mem_dataspace = H5Screate_simple(1, &one, NULL);
+
+  bool writer = true;
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+  // the write is collective but only one process contributes the value
+  int rank;
+  MPI_Comm_rank(*mpiComm, &rank);
+  writer = (rank == 0);
+#endif
+
+  if (writer) {
+    H5Sselect_hyperslab(file_dataspace, H5S_SELECT_SET, &current, NULL, &one, NULL);
+  } else {
+    H5Sselect_none(file_dataspace);
+    H5Sselect_none(mem_dataspace);
+  }
+
+  ret = H5Dwrite(dataset, H5T_NATIVE_DOUBLE, mem_dataspace, file_dataspace, dxpl_id, &time);
+  assert(ret != -1);
+
+  H5Sclose(mem_dataspace);
+  H5Sclose(file_dataspace);
+  H5Dclose(dataset);
+}
+
+void HdfOStream::flush() {
+  if (file_id >= 0) H5Fflush(file_id, H5F_SCOPE_LOCAL);
+}
+
+void HdfOStream::setSubfiling(int size) {
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+  if (size != subfileSize) subfileComm.reset();
+#endif
+  subfileSize = size;
+}
+
+void HdfOStream::close() {
+  HdfStream::close();
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+  if (!virtualDatasets.empty()) {
+    writeVirtualDatasets();
+    virtualDatasets.clear();
+  }
+#endif
+}
+
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+void HdfOStream::selectSubfile(
+    int rank,
+    hsize_t* dims,
+    const hsize_t* count,
+    hsize_t* start,
+    bool hasData,
+    const std::string& name,
+    hid_t type,
+    const HdfAttributes* datasetAttributes
+) {
+  // The bounding box of the subfile, the upper corner is negated so that a
+  // single minimum reduction finds both corners
+  std::vector<long long> local(2 * rank), box(2 * rank);
+  for (int i = 0; i < rank; ++i) {
+    local[i] = hasData ? (long long)start[i] : std::numeric_limits<long long>::max();
+    local[rank + i] = hasData ? -(long long)(start[i] + count[i] - 1) : std::numeric_limits<long long>::max();
+  }
+  MPI_Allreduce(local.data(), box.data(), 2 * rank, MPI_LONG_LONG, MPI_MIN, *subfileComm);
+
+  bool empty = (box[0] == std::numeric_limits<long long>::max());
+
+  // Collect the boxes of all subfiles on the first process
+  std::vector<long long> entry(2 * rank + 1);
+  entry[0] = empty ? -1 : subfileIndex;
+  for (int i = 0; i < rank; ++i) {
+    entry[1 + i] = empty ? 0 : box[i];
+    entry[1 + rank + i] = empty ? 0 : -box[rank + i] - box[i] + 1;
+  }
+
+  int procRank, procCount;
+  MPI_Comm_rank(*mpiComm, &procRank);
+  MPI_Comm_size(*mpiComm, &procCount);
+  std::vector<long long> entries((procRank == 0) ? procCount * (2 * rank + 1) : 0);
+  MPI_Gather(entry.data(), 2 * rank + 1, MPI_LONG_LONG, entries.data(), 2 * rank + 1, MPI_LONG_LONG, 0, *mpiComm);
+
+  if (procRank == 0) {
+    VirtualDataset vds;
+    vds.name = name;
+    vds.type = type;
+    vds.dims.assign(dims, dims + rank);
+    vds.attributes = attributes ? attributes->snapshot() : std::make_shared<HdfAttributes>();
+    if (datasetAttributes) {
+      pHdfAttributes extra = datasetAttributes->snapshot();
+      vds.attributes->attributes.insert(extra->attributes.begin(), extra->attributes.end());
+    }
+
+    int lastIndex = -1;
+    for (int p = 0; p < procCount; ++p) {
+      const long long* e = &entries[p * (2 * rank + 1)];
+      // the processes of a subfile are consecutive
+      if ((e[0] < 0) || (e[0] == lastIndex)) continue;
+      lastIndex = e[0];
+      vds.subfiles.push_back(subfileName(mainFileName, e[0]));
+      for (int i = 0; i < 2 * rank; ++i) vds.boxes.push_back(e[1 + i]);
+    }
+    virtualDatasets.push_back(vds);
+  }
+
+  for (int i = 0; i < rank; ++i) {
+    dims[i] = empty ? 0 : -box[rank + i] - box[i] + 1;
+    if (hasData) start[i] -= box[i];
+  }
+}
+
+void HdfOStream::writeVirtualDatasets() {
+#if H5_VERSION_GE(1, 10, 0)
+  hid_t file = H5Fcreate(mainFileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  assert(file > -1);
+
+  for (VirtualDataset& vds : virtualDatasets) {
+    int rank = vds.dims.size();
+    hid_t vspace = H5Screate_simple(rank, vds.dims.data(), NULL);
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+
+    for (size_t k = 0; k < vds.subfiles.size(); ++k) {
+      const hsize_t* offset = &vds.boxes[2 * rank * k];
+      const hsize_t* size = offset + rank;
+      H5Sselect_hyperslab(vspace, H5S_SELECT_SET, offset, NULL, size, NULL);
+
+      // the subfiles are found relative to the directory of the main file
+      std::string source = vds.subfiles[k].substr(vds.subfiles[k].find_last_of('/') + 1);
+      hid_t sspace = H5Screate_simple(rank, size, NULL);
+      H5Pset_virtual(dcpl, vspace, source.c_str(), vds.name.c_str(), sspace);
+      H5Sclose(sspace);
+    }
+    H5Sselect_all(vspace);
+
+    hid_t dataset = H5Dcreate2(file, vds.name.c_str(), vds.type, vspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    assert(dataset > -1);
+    if (vds.attributes) writeAttributes(dataset, *vds.attributes);
+
+    H5Dclose(dataset);
+    H5Pclose(dcpl);
+    H5Sclose(vspace);
+  }
+
+  H5Fclose(file);
+#endif
+}
+#endif
+
+// ----------------------------------------------------------------------
+
+std::string HdfPieceIndex::fileName(const std::string& pattern, int file) {
+  std::string name = pattern;
+  size_t pos = name.find("#p");
+  if (pos != std::string::npos) name.replace(pos, 2, std::to_string(file));
+  return name;
+}
+
+void HdfPieceIndex::scanFiles(int files, const std::vector<std::string>& datasets) {
+  rank = 0;
+  pieces.clear();
+
+  for (int p = 0; p < files; ++p) {
+    std::string name = fileName(pattern, p);
+    if (!std::ifstream(name.c_str()).good()) continue;
+
+    hid_t file = H5Fopen(name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file < 0) continue;
+
+    std::vector<int> lo, hi;
+    for (const std::string& dset : datasets) {
+      if (H5Lexists(file, dset.c_str(), H5P_DEFAULT) <= 0) continue;
+
+      hid_t dataset = H5Dopen2(file, dset.c_str(), H5P_DEFAULT);
+      hid_t space = H5Dget_space(dataset);
+      int dsRank = H5Sget_simple_extent_ndims(space);
+      H5Sclose(space);
+
+      std::vector<int> offset(dsRank), innerMin(dsRank), innerMax(dsRank);
+      bool placed = (dsRank > 0) && ((rank == 0) || (rank == dsRank))
+          && HdfIStream::readPlacement(dataset, dsRank, offset.data(), innerMin.data(), innerMax.data());
+      H5Dclose(dataset);
+      if (!placed) continue;
+
+      rank = dsRank;
+      if (lo.empty()) {
+        lo = innerMin;
+        hi = innerMax;
+      } else {
+        for (int i = 0; i < rank; ++i) {
+          lo[i] = std::min(lo[i], innerMin[i]);
+          hi[i] = std::max(hi[i], innerMax[i]);
+        }
+      }
+    }
+    H5Fclose(file);
+
+    if (lo.empty()) continue;
+    pieces.push_back(p);
+    pieces.insert(pieces.end(), lo.begin(), lo.end());
+    pieces.insert(pieces.end(), hi.begin(), hi.end());
+  }
+}
+
+void HdfPieceIndex::scan(const std::string& pattern_, int files, const std::vector<std::string>& datasets) {
+  pattern = pattern_;
+#ifdef SCHNEK_HAVE_MPI
+  int mpiRank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
+  if (mpiRank == 0) scanFiles(files, datasets);
+
+  int header[2] = {rank, int(pieces.size())};
+  MPI_Bcast(header, 2, MPI_INT, 0, MPI_COMM_WORLD);
+  rank = header[0];
+  pieces.resize(header[1]);
+  MPI_Bcast(pieces.data(), header[1], MPI_INT, 0, MPI_COMM_WORLD);
+#else
+  scanFiles(files, datasets);
+#endif
+}
+
+std::vector<std::string> HdfPieceIndex::overlapping(const std::vector<int>& lo, const std::vector<int>& hi) const {
+  std::vector<std::string> names;
+  if ((rank == 0) || (int(lo.size()) != rank) || (int(hi.size()) != rank)) return names;
+
+  for (size_t k = 0; k < pieces.size(); k += 2 * rank + 1) {
+    const int* pieceLo = &pieces[k + 1];
+    const int* pieceHi = pieceLo + rank;
+    bool overlap = true;
+    for (int i = 0; i < rank; ++i) {
+      if ((pieceLo[i] > hi[i]) || (pieceHi[i] < lo[i]) || (pieceLo[i] > pieceHi[i])) overlap = false;
+    }
+    if (overlap) names.push_back(fileName(pattern, pieces[k]));
+  }
+  return names;
+}
+
+// ----------------------------------------------------------------------
+
+void HdfParameterValues::collect(pBlockVariables vars, pBlockVariables skip, const std::string& prefix) {
+  for (const std::pair<const std::string, pVariable>& entry : vars->getVariables()) {
+    Variable& var = *entry.second;
+    if (!var.isInitialised() || !var.isConstant() || var.isReadOnly()) continue;
+
+    if (var.getType() == Variable::int_type)
+      intValues[prefix + entry.first] = boost::get<int>(var.getValue());
+    else if (var.getType() == Variable::float_type)
+      floatValues[prefix + entry.first] = boost::get<double>(var.getValue());
+  }
+
+  for (pBlockVariables child : vars->getChildren()) {
+    if (child != skip) collect(child, skip, prefix + child->getBlockName() + ".");
+  }
+}
+
+void HdfParameterValues::setAttributes(HdfAttributes& attributes) const {
+  for (const std::pair<const std::string, int>& entry : intValues) attributes.set(entry.first, entry.second);
+  for (const std::pair<const std::string, double>& entry : floatValues) attributes.set(entry.first, entry.second);
+}
+
+std::vector<std::string> HdfParameterValues::compare(HdfIStream& input, const std::string& group) const {
+  std::vector<std::string> differing;
+  bool stored = input.exists(group);
+
+  for (const std::pair<const std::string, int>& entry : intValues) {
+    int value;
+    if (!stored || !input.readAttribute(group, entry.first, value) || (value != entry.second))
+      differing.push_back(entry.first);
+  }
+
+  for (const std::pair<const std::string, double>& entry : floatValues) {
+    double value;
+    if (!stored || !input.readAttribute(group, entry.first, value) || (value != entry.second))
+      differing.push_back(entry.first);
+  }
+
+  return differing;
+}
+
+#if defined(SCHNEK_HAVE_MPI) && !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+HdfAggregator::~HdfAggregator() {
+  int finalized;
+  MPI_Finalized(&finalized);
+  if (!finalized && (comm != MPI_COMM_NULL)) MPI_Comm_free(&comm);
+}
+
+void HdfAggregator::init(int size) {
+  if (comm != MPI_COMM_NULL) MPI_Comm_free(&comm);
+
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_split(MPI_COMM_WORLD, rank / size, rank, &comm);
+  MPI_Comm_rank(comm, &groupRank);
+  MPI_Comm_size(comm, &groupSize);
+}
+
+void HdfAggregator::gather(const int* send, int count, std::vector<int>& recv) {
+  recv.resize(isAggregator() ? count * groupSize : 0);
+  MPI_Gather(const_cast<int*>(send), count, MPI_INT, recv.data(), count, MPI_INT, 0, comm);
+}
+
+void HdfAggregator::gatherData(const void* send, int bytes, const std::vector<int>& sizes, std::vector<char>& recv) {
+  std::vector<int> displs;
+  if (isAggregator()) {
+    displs.resize(groupSize);
+    int total = 0;
+    for (int p = 0; p < groupSize; ++p) {
+      displs[p] = total;
+      total += sizes[p];
+    }
+    recv.resize(total);
+  }
+  MPI_Gatherv(
+      const_cast<void*>(send), bytes, MPI_BYTE, recv.data(), const_cast<int*>(sizes.data()), displs.data(), MPI_BYTE,
+      0, comm
+  );
+}
+#endif
+
+// ----------------------------------------------------------------------
+
+HdfDiskType schnek::parseHdfDiskType(const std::string& name) {
+  if (name == "native") return HdfDiskType::Native;
+  if (name == "float") return HdfDiskType::Float;
+  SCHNEK_ASSERT(name == "uint16", "Unknown HDF5 disk type " << name << ", expected native, float or uint16");
+  return HdfDiskType::ScaledUInt16;
+}
+
 // ----------------------------------------------------------------------
 
 template<>
@@ -324,4 +935,16 @@ const hid_t H5DataType<float>::type = H5T_NATIVE_FLOAT;
 template<>
 const hid_t H5DataType<double>::type = H5T_NATIVE_DOUBLE;
 
+template<>
+const hid_t H5DataType<std::uint8_t>::type = H5T_NATIVE_UINT8;
+
+template<>
+const hid_t H5DataType<std::uint16_t>::type = H5T_NATIVE_UINT16;
+
+template<>
+const hid_t H5DataType<std::uint32_t>::type = H5T_NATIVE_UINT32;
+
+template<>
+const hid_t H5DataType<std::uint64_t>::type = H5T_NATIVE_UINT64;
+
 #endif
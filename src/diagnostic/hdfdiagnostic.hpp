@@ -31,16 +31,20 @@
 
 #include <hdf5.h>
 
+#include <cstdint>
 #include <memory>
 
 #include "../grid/grid.hpp"
+#include "asyncoutput.hpp"
 #include "diagnostic.hpp"
+#include "gridcontainer.hpp"
 
-#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+#if defined(SCHNEK_HAVE_MPI) || (defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
 #include <mpi.h>
 #endif
 
 #include <map>
+#include <vector>
 
 namespace schnek {
 
@@ -49,27 +53,42 @@ namespace schnek {
       static const hid_t type;
   };
 
-  /**
-   * A container type for grids that are being passed to the HDFGridDiagnostic
-   */
-  template<typename FieldType>
-  struct GridContainer {
-      /// The pointer to the grid
-      FieldType grid;
+  /// The unsigned integer type with the given size in bytes
+  template<size_t size>
+  struct HdfUnsigned;
 
-      /// The global minimum coordinate
-      typename FieldType::IndexType global_min;
+  template<>
+  struct HdfUnsigned<1> {
+      typedef std::uint8_t type;
+  };
 
-      /// The global maximum coordinate
-      typename FieldType::IndexType global_max;
+  template<>
+  struct HdfUnsigned<2> {
+      typedef std::uint16_t type;
+  };
 
-      /// The local minimum coordinate
-      typename FieldType::IndexType local_min;
+  template<>
+  struct HdfUnsigned<4> {
+      typedef std::uint32_t type;
+  };
 
-      /// The local maximum coordinate
-      typename FieldType::IndexType local_max;
+  template<>
+  struct HdfUnsigned<8> {
+      typedef std::uint64_t type;
   };
 
+  /**
+   * True if the grid of a field type stores its first index fastest in memory
+   *
+   * HDF5 describes memory in C order. Such grids are written with their
+   * dimensions in reverse order, which stores the data transposed, and the
+   * dataset is marked with the attribute `fortran_order`.
+   */
+  template<typename FieldType>
+  constexpr bool hdfFortranOrder() {
+    return (FieldType::Rank > 1) && GridStorageOrder<typename FieldType::StoragePolicyType>::fortranOrder;
+  }
+
   /**
    * HDF5 attributes to a data set
    *
@@ -81,8 +100,12 @@ namespace schnek {
     private:
       struct Info {
           hid_t type;
+          /// The size of a single value in bytes, so that copies need no HDF5 calls
+          size_t size;
           hsize_t dims;
           const void *buffer;
+          /// Holds a copy of the data if the attribute owns its values
+          std::shared_ptr<std::vector<char> > storage;
       };
       typedef std::shared_ptr<Info> pInfo;
 
@@ -106,10 +129,94 @@ namespace schnek {
        */
       template<typename T>
       void set(std::string name, const T &value, hsize_t dims = 1);
+
+      /**
+       * Create a copy of the attributes that holds copies of all the values
+       *
+       * Attributes normally refer to values owned by someone else. The copy
+       * can be written later, even if the original values have changed. No
+       * HDF5 functions are called, so the snapshot can be taken while the I/O
+       * thread is writing.
+       */
+      std::shared_ptr<HdfAttributes> snapshot() const;
   };
 
   typedef std::shared_ptr<HdfAttributes> pHdfAttributes;
 
+  /// The type in which floating point data is stored on disk
+  enum class HdfDiskType {
+    /// The type of the data in memory
+    Native,
+    /// Single precision floating point
+    Float,
+    /// 16-bit unsigned integers scaled to the range of the data
+    ScaledUInt16
+  };
+
+  /**
+   * Get the disk type from its name in a setup file
+   *
+   * The names are `native`, `float` and `uint16` for HdfDiskType::Native,
+   * HdfDiskType::Float and HdfDiskType::ScaledUInt16.
+   */
+  HdfDiskType parseHdfDiskType(const std::string &name);
+
+  /** @brief Options for creating datasets in an HdfOStream
+   *
+   * By default datasets are stored contiguously and uncompressed. Chunked storage
+   * is used as soon as a chunk size is given or any of the filters is switched on.
+   */
+  struct HdfDatasetOptions {
+      /// The chunk size in each dimension, zero entries are chosen automatically
+      std::vector<hsize_t> chunk;
+      /// The deflate (gzip) compression level from 1 to 9, zero switches deflate off
+      int deflate;
+      /// Apply the shuffle filter before deflate
+      bool shuffle;
+      /**
+       * The number of decimal digits kept by the lossy scale-offset filter for
+       * floating point data, a negative value switches the filter off. Integer
+       * data is always stored losslessly by the filter.
+       */
+      int scaleOffset;
+      /**
+       * The type in which floating point data is stored. The data is converted
+       * by HDF5 while it is written, in pieces the size of the type conversion
+       * buffer. Scaled integers hold the attributes `scale_factor` and
+       * `add_offset`, so that the value is `stored*scale_factor + add_offset`.
+       * Time series store scaled data as single precision floating point,
+       * because the scale would change from step to step.
+       */
+      HdfDiskType diskType;
+
+      HdfDatasetOptions() : deflate(0), shuffle(false), scaleOffset(-1), diskType(HdfDiskType::Native) {}
+
+      /// Return true if the datasets should be stored in chunks
+      bool chunked() const;
+  };
+
+  /** @brief Tuning parameters for parallel file access
+   *
+   * The values are passed to HDF5 and to MPI-IO when a file is opened. They
+   * only have an effect with parallel HDF5. The best values depend strongly on
+   * the parallel file system.
+   */
+  struct HdfAccessHints {
+      /// The size of the HDF5 data sieve buffer in bytes
+      int sieveBufSize;
+      /// Objects of at least this size in bytes are aligned in the file
+      int alignThreshold;
+      /// The alignment of objects in the file in bytes
+      int alignment;
+      /// The MPI-IO collective buffering block size in bytes
+      int cbBlockSize;
+      /// The MPI-IO collective buffering buffer size in bytes
+      int cbBufferSize;
+
+      HdfAccessHints()
+          : sieveBufSize(262144), alignThreshold(1), alignment(1), cbBlockSize(1048576), cbBufferSize(4194304) {}
+  };
+
   /** @brief IO class for handling HDF files
    *
    * This is the abstract base class for HDF-IO- classes.
@@ -134,7 +241,15 @@ namespace schnek {
 
       /// Specifies if the stream is active in this process (in case of parallel execution)
       bool active;
+      /// Set when setActive has been called since the communicator was last checked
       bool activeModified;
+      /// Set when setActive has changed the active state of this process
+      bool activeChanged;
+
+      /// The tuning parameters for parallel file access
+      HdfAccessHints accessHints;
+      /// Set when the access hints have been changed since the last file was opened
+      bool accessHintsChanged;
 
     public:
       /// constructor
@@ -162,19 +277,51 @@ namespace schnek {
       /// assign
       HdfStream &operator=(const HdfStream &);
 
+      /** @brief Set whether this process takes part in the output
+       *
+       *  In parallel builds, setActive must be called on all processes or on none
+       *  before opening a file. The communicator of the active processes is
+       *  only rebuilt if the active state has changed on at least one process.
+       */
       void setActive(bool active_) {
+        activeChanged = activeChanged || (active != active_);
         active = active_;
         activeModified = true;
       }
 
+      /** @brief Let the stream communicate through its own duplicate of MPI_COMM_WORLD
+       *
+       *  This is a collective operation and has to be called on the main thread
+       *  before the stream is handed to the output thread. All collective
+       *  operations of the stream then use communicators derived from the
+       *  duplicate and cannot interfere with the communication of the
+       *  simulation. Does nothing unless parallel HDF5 is used.
+       */
+      void useOwnCommunicator();
+
+      /// Set the tuning parameters for parallel file access, used when the next file is opened
+      void setAccessHints(const HdfAccessHints &hints) {
+        accessHints = hints;
+        accessHintsChanged = true;
+      }
+
     protected:
       std::string getNextBlockName();
 
 #if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+      /** @brief Make sure that mpiComm contains exactly the active processes
+       *
+       *  The communicator is cached. If setActive has been called, a single
+       *  integer reduction decides whether any process has changed its state.
+       *  Only then is the communicator rebuilt with MPI_Comm_split.
+       */
       void makeMPIGroup();
 
-      MPI_Comm mpiComm;
-      bool commSet;
+      /// The communicator that the active processes are split from, MPI_COMM_WORLD or a duplicate
+      std::shared_ptr<MPI_Comm> baseComm;
+
+      /// The communicator of the active processes, shared between copies of the stream
+      std::shared_ptr<MPI_Comm> mpiComm;
 #endif
   };
 
@@ -196,20 +343,266 @@ namespace schnek {
       /// opens HDF file "fname", selects first dataset
       int open(const char *);
 
-      /// stream input operator for a schnek::Matrix
+      /**
+       * stream input operator for a schnek::Matrix
+       *
+       * With parallel HDF5 the inner region of the grid is read from the
+       * global dataset. Otherwise, if the dataset holds the placement written by
+       * HdfOStream::writePlacement, the cells of the inner region that were
+       * owned by the writing process are read and the other cells are left
+       * untouched. Datasets without placement are read into the whole grid.
+       *
+       * Datasets written from grids in Fortran order can be read into grids of
+       * either storage order.
+       */
       template<typename FieldType>
       void readGrid(GridContainer<FieldType> &g);
+
+    private:
+      /**
+       * Read a box of a dataset into a grid
+       *
+       * The box is given in the index order of the grid. If the dataset has
+       * been written from a grid with the other storage order, the box is read
+       * into a buffer and transposed.
+       *
+       * @param fileFortran  true if the dataset is stored in Fortran order
+       * @param fileStart    the first element of the box in the dataset
+       * @param count        the size of the box
+       * @param memDims      the dimensions of the grid in memory
+       * @param memStart     the offset of the box in memory
+       */
+      template<typename FieldType>
+      void readBox(
+          hid_t dataset,
+          GridContainer<FieldType> &g,
+          bool fileFortran,
+          const hsize_t *fileStart,
+          const hsize_t *count,
+          const hsize_t *memDims,
+          const hsize_t *memStart
+      );
+
+    public:
+
+      /**
+       * Read the placement of a dataset that holds a piece of a global dataset
+       *
+       * The positions are lattice coordinates relative to the global minimum.
+       *
+       * @param dataset   the open dataset
+       * @param rank      the rank of the dataset
+       * @param offset    receives the position of the first element of the dataset
+       * @param innerMin  receives the first element owned by the writing process
+       * @param innerMax  receives the last element owned by the writing process
+       * @return          false if the dataset holds no placement of the given rank
+       */
+      static bool readPlacement(hid_t dataset, int rank, int *offset, int *innerMin, int *innerMax);
+
+      /// true if the file contains a dataset or group with the given name
+      bool exists(const std::string &name);
+
+      /**
+       * Read a scalar attribute
+       *
+       * @param object  the name of the dataset or group holding the attribute, `/` for the file
+       * @param name    the name of the attribute
+       * @param value   receives the value
+       * @return        false if the attribute does not exist
+       */
+      template<typename T>
+      bool readAttribute(const std::string &object, const std::string &name, T &value);
   };
 
   /** @brief output stream for HDF files */
   class HdfOStream : public HdfStream {
     private:
       hid_t dxpl_id;
-#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
-      MPI_Info mpi_info;
-#endif
       hid_t plist_id;
       bool initialised;
+      /// The options for creating new datasets
+      HdfDatasetOptions datasetOptions;
+      /// The number of processes writing into each subfile, zero to write a single file
+      int subfileSize;
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+      /// The communicator the file access property list has been created for
+      std::shared_ptr<MPI_Comm> plistComm;
+      /// The communicator of the processes writing into the same subfile
+      std::shared_ptr<MPI_Comm> subfileComm;
+      /// The communicator of the active processes that subfileComm has been split from
+      std::shared_ptr<MPI_Comm> subfileParent;
+      /// The index of the subfile written by this process
+      int subfileIndex;
+      /// The name of the file holding the virtual datasets, empty if no subfile is being written
+      std::string mainFileName;
+
+      /// A virtual dataset that maps the datasets of the subfiles into one
+      struct VirtualDataset {
+          std::string name;
+          hid_t type;
+          /// The dimensions of the virtual dataset
+          std::vector<hsize_t> dims;
+          /// The names of the subfiles holding data
+          std::vector<std::string> subfiles;
+          /// The offset and size of the box in each subfile
+          std::vector<hsize_t> boxes;
+          pHdfAttributes attributes;
+      };
+
+      /// The virtual datasets to create when the subfiles are closed, only used on the first process
+      std::vector<VirtualDataset> virtualDatasets;
+
+      /**
+       * Restrict a selection to the bounding box of the subfile
+       *
+       * Collective on the active processes. The dimensions and the start of the
+       * selection are changed in place. The box of each subfile is recorded for
+       * the virtual dataset together with the additional dataset attributes.
+       */
+      void selectSubfile(
+          int rank,
+          hsize_t *dims,
+          const hsize_t *count,
+          hsize_t *start,
+          bool hasData,
+          const std::string &name,
+          hid_t type,
+          const HdfAttributes *datasetAttributes = nullptr
+      );
+
+      /// Create the file with the virtual datasets of the subfiles
+      void writeVirtualDatasets();
+#endif
+
+      /**
+       * Create the dataset creation property list from the dataset options
+       *
+       * In parallel builds this is a collective operation when chunk sizes need
+       * to be chosen automatically.
+       *
+       * @param rank     the rank of the dataset
+       * @param dims     the global dimensions of the dataset
+       * @param locdims  the dimensions of the part written by this process
+       * @param type     the HDF5 type of the data
+       * @param series   if true, the first dimension is an extendible time dimension
+       *                 and the other dimensions correspond to the chunk options
+       * @return  the property list or H5P_DEFAULT for contiguous datasets
+       */
+      hid_t createDatasetProperties(
+          int rank, const hsize_t *dims, const hsize_t *locdims, hid_t type, bool series = false
+      );
+
+      /// Write the attributes to a dataset
+      void writeAttributes(hid_t dataset);
+
+      /** @brief Write the attributes to a dataset on the calling process
+       *
+       *  With parallel HDF5 this is collective, all processes writing the file
+       *  have to call it with the same attributes.
+       */
+      void writeAttributes(hid_t dataset, const HdfAttributes &attributes);
+
+      /// The attribute that marks datasets stored in Fortran order
+      static const HdfAttributes &fortranOrderAttributes();
+
+      /**
+       * Compute the part of a grid that is written by this process
+       *
+       * @param dims       the dimensions of the dataset
+       * @param count      the number of cells written in each dimension
+       * @param fileStart  the offset of the written cells in the dataset
+       * @param memDims    the dimensions of the grid in memory
+       * @param memStart   the offset of the first written cell in memory
+       * @param memStride  the distance between written cells in memory
+       * @return  false if this process does not write any cells
+       */
+      template<typename FieldType>
+      bool selectGrid(
+          GridContainer<FieldType> &g,
+          hsize_t *dims,
+          hsize_t *count,
+          hsize_t *fileStart,
+          hsize_t *memDims,
+          hsize_t *memStart,
+          hsize_t *memStride
+      );
+
+#if !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+      /**
+       * Record where the data written by this process lies in the global dataset
+       *
+       * The attribute `offset` holds the position of the first element of the
+       * dataset and `global_dims` the size of the global dataset, in lattice
+       * coordinates relative to the global minimum. If the whole grid including
+       * ghost cells is written, `inner_min` and `inner_max` hold the inner
+       * region owned by this process. This allows reading the data with a
+       * different decomposition.
+       *
+       * @param dims  the size of the written box before squeezing dimensions
+       */
+      template<typename FieldType>
+      void writePlacement(hid_t dataset, GridContainer<FieldType> &g, const hsize_t *dims);
+#endif
+
+      /**
+       * Remove the squeezed dimensions from a selection
+       *
+       * @return  the rank of the dataset
+       */
+      template<typename FieldType>
+      int squeezeSelection(
+          GridContainer<FieldType> &g,
+          const hsize_t *dims,
+          const hsize_t *count,
+          const hsize_t *start,
+          hsize_t *fileDims,
+          hsize_t *fileCount,
+          hsize_t *fileStart
+      );
+
+      /// The identifiers needed to write the data of a grid into a new dataset
+      struct DatasetWrite {
+          hid_t dataset;
+          hid_t type;
+          hid_t memSpace;
+          hid_t fileSpace;
+          hid_t sid;
+          const void *data;
+          /// The transfer property list, differs from dxpl_id for scaled data
+          hid_t xfer;
+          /// The attributes of scaled data
+          pHdfAttributes scaling;
+          /// True if the dimensions are reversed for a grid in Fortran order
+          bool reversed;
+      };
+
+      /// The type in which data of type T is stored in the file
+      template<typename T>
+      hid_t diskDataType(bool series = false) const;
+
+      /**
+       * Set up the conversion of the selected data into scaled integers
+       *
+       * Collective on the active processes with parallel HDF5, where the range
+       * of the data is reduced over all of them. The transfer property list of
+       * the write applies the scaling as a data transform.
+       */
+      template<typename FieldType>
+      void selectScaling(
+          GridContainer<FieldType> &g,
+          bool hasData,
+          const hsize_t *memStart,
+          const hsize_t *memStride,
+          const hsize_t *count,
+          DatasetWrite &w
+      );
+
+      /// Create the dataset for a grid and select the region written by this process
+      template<typename FieldType>
+      DatasetWrite createGridDataset(GridContainer<FieldType> &g, const std::string &dset_name);
+
+      /// Write the attributes and release all identifiers after the data has been written
+      void finishGridDataset(DatasetWrite &w);
 
     public:
       /// constructor
@@ -221,25 +614,240 @@ namespace schnek {
       /// constructor, opens HDF file "fname"
       HdfOStream(const char *fname);
 
+      /// destructor, closes the file
+      ~HdfOStream();
+
       /// open file
       int open(const char *);
 
+      /// close file and create the virtual datasets of the subfiles
+      void close();
+
       /// stream output operator for a matrix
       template<typename FieldType>
       void writeGrid(GridContainer<FieldType> &g);
+
+      /**
+       * Write several grids into datasets of the same file
+       *
+       * Where the HDF5 version supports it, all the data is written with a
+       * single call to H5Dwrite_multi.
+       *
+       * @param grids  the grids to write
+       * @param names  the dataset names, one for each grid
+       */
+      template<typename FieldType>
+      void writeGrids(const std::vector<GridContainer<FieldType> *> &grids, const std::vector<std::string> &names);
+
+      /**
+       * Write a grid, skipping all chunks of the dataset that would only hold zeros
+       *
+       * Chunks that are not written are not stored in the file and read back as
+       * zero. This only has an effect if the dataset options lead to a chunked
+       * dataset that has the rank of the grid.
+       */
+      template<typename FieldType>
+      void writeSparseGrid(GridContainer<FieldType> &g);
+
+      /**
+       * Append a grid as the next time step to an extendible dataset
+       *
+       * The dataset is named after the block name and has one more dimension
+       * than the grid. The first dimension counts the time steps. It is created
+       * together with its attributes the first time the grid is appended.
+       */
+      template<typename FieldType>
+      void appendGrid(GridContainer<FieldType> &g);
+
+      /**
+       * Append a value to the one-dimensional `time` dataset
+       *
+       * Used with appendGrid to record the time of each step.
+       */
+      void appendTime(double time);
+
+      /// Flush all buffered data to the file
+      void flush();
+
+      /**
+       * Write attributes that are not attached to a dataset
+       *
+       * @param attributes  the attributes to write
+       * @param group       the name of a new group holding the attributes, empty
+       *                    to attach them to the file itself
+       */
+      void writeFileAttributes(const HdfAttributes &attributes, const std::string &group = "");
+
+      /// set the options for creating new datasets
+      void setDatasetOptions(const HdfDatasetOptions &options) { datasetOptions = options; }
+
+      /**
+       * Write the data into several files, used when the next file is opened
+       *
+       * With parallel HDF5, consecutive groups of active processes write into
+       * their own file. The file name is extended by the index of the group.
+       * Each subfile holds the bounding box of its processes. The file with
+       * the requested name holds virtual datasets that combine the subfiles
+       * into the global datasets. The subfiles are looked up in the directory
+       * of this file. Datasets written with appendGrid are not combined.
+       *
+       * @param size  the number of processes writing into each file, zero to
+       *              write a single file
+       */
+      void setSubfiling(int size);
   };
+#if defined(SCHNEK_HAVE_MPI) && !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+  /** @brief Groups of processes that send their output to a single process
+   *
+   * Used when HDF5 can not write files in parallel. Consecutive ranks of
+   * MPI_COMM_WORLD form a group and the first process of each group, the
+   * aggregator, writes the data of the whole group into one file.
+   */
+  class HdfAggregator {
+    private:
+      /// The communicator of the group
+      MPI_Comm comm;
+      /// The rank within the group
+      int groupRank;
+      /// The number of processes in the group
+      int groupSize;
+
+    public:
+      HdfAggregator() : comm(MPI_COMM_NULL), groupRank(0), groupSize(1) {}
+      HdfAggregator(const HdfAggregator &) = delete;
+      HdfAggregator &operator=(const HdfAggregator &) = delete;
+      ~HdfAggregator();
+
+      /**
+       * Split MPI_COMM_WORLD into groups of consecutive ranks
+       *
+       * This is a collective operation on MPI_COMM_WORLD.
+       *
+       * @param size  the number of processes in each group
+       */
+      void init(int size);
+
+      /// Return true if this process writes the data of the group
+      bool isAggregator() const { return groupRank == 0; }
+
+      /// Return the number of processes in the group
+      int getGroupSize() const { return groupSize; }
+
+      /// Gather count integers from each process of the group on the aggregator
+      void gather(const int *send, int count, std::vector<int> &recv);
+
+      /**
+       * Gather data of varying size from each process of the group on the aggregator
+       *
+       * @param send   the data to send
+       * @param bytes  the number of bytes to send
+       * @param sizes  the number of bytes sent by each process, only used on the aggregator
+       * @param recv   receives the data of all processes in the order of their rank
+       */
+      void gatherData(const void *send, int bytes, const std::vector<int> &sizes, std::vector<char> &recv);
+  };
+#endif
+
+  /** @brief The block parameters for the chunk size and the filters of the written datasets
+   *
+   * The parameters `chunk`, `deflate` and `shuffle` are shared by all HDF5
+   * diagnostics. Diagnostics that allow lossy output also register
+   * `scaleOffset` and `diskType`.
+   */
+  template<size_t rank>
+  class HdfDatasetParameters {
+    private:
+      /// Parameter: the chunk size in each dimension, zero to choose automatically
+      Array<int, rank> chunkSize;
+      /// Parameter: the deflate compression level, zero for no compression
+      int deflate;
+      /// Parameter: apply the shuffle filter before compression
+      int shuffle;
+      /// Parameter: decimal digits kept by the lossy scale-offset filter, negative for none
+      int scaleOffset;
+      /// Parameter: the type of floating point data on disk, `native`, `float` or `uint16`
+      std::string diskType;
+
+    public:
+      HdfDatasetParameters() : deflate(0), shuffle(0), scaleOffset(-1), diskType("native") {}
+
+      /// Register the parameters with the block, `scaleOffset` and `diskType` only if lossy is set
+      void initParameters(BlockParameters &blockPars, bool lossy);
+
+      /// The dataset options given by the parameters, chunk sizes of zero are replaced by defaultChunk
+      HdfDatasetOptions getOptions(hsize_t defaultChunk = 0) const;
+  };
+
   /**
    * Abstract diagnostic class for writing Grids into HDF5 data files
+   *
+   * Without parallel HDF5 every process writes its own file. The position of
+   * the data in the global dataset is stored in attributes, see
+   * HdfOStream::writePlacement. With the `aggregate` parameter set to K,
+   * groups of K processes send their inner regions to the first process of
+   * the group, which writes the bounding box of the group into a single file.
+   *
+   * With parallel HDF5, the parameters `sieveBufSize`, `alignThreshold`,
+   * `alignment`, `cbBlockSize` and `cbBufferSize` tune the file access. With
+   * `subfiles` set to K, groups of K processes write into separate files that
+   * are combined by virtual datasets, see HdfOStream::setSubfiling.
+   *
+   * The parameters `lox`, `hix`, ... restrict the output to a box in global
+   * index coordinates and `stridex`, ... write only every n-th cell. The
+   * dataset then has the size of the strided box. Processes that do not hold
+   * any cells of the box do not take part in the output.
+   *
+   * With the `timeSeries` parameter set, the file is opened at the first output
+   * and stays open until the diagnostic is destroyed. Every output is appended as
+   * a new time step to an extendible dataset and the output time is appended to
+   * the `time` dataset. The file name of the first output is used, so it should
+   * not contain the time step placeholder.
    */
   template<typename Type, class DiagnosticType = IntervalDiagnostic>
   class HDFGridDiagnostic : public SimpleDiagnostic<Type, Type, DiagnosticType> {
     public:
       typedef typename Type::IndexType IndexType;
+      /// The grid type holding a snapshot of the inner region for asynchronous output
+      typedef Grid<typename Type::value_type, Type::Rank> StagingGrid;
+      typedef GridContainer<StagingGrid> StagingContainer;
 
     protected:
       HdfOStream output;
       GridContainer<Type> container;
 
+      /// Parameter: write the data on the background I/O thread
+      int async;
+      /// Parameters: the chunk size and the filters
+      HdfDatasetParameters<Type::Rank> datasetParameters;
+      /// Parameter: append all outputs as time steps to a single file
+      int timeSeries;
+      /// Parameter: the lower corner of the output region in global index coordinates
+      Array<int, Type::Rank> regionLo;
+      /// Parameter: the upper corner of the output region in global index coordinates
+      Array<int, Type::Rank> regionHi;
+      /// Parameter: write only every stride-th cell in each dimension
+      Array<int, Type::Rank> stride;
+      /// Parameter: the number of processes sending their data to one writing process
+      int aggregate;
+      /// Parameter: the number of processes writing into one subfile with parallel HDF5
+      int subfiles;
+      /// Parameters: the tuning parameters for parallel file access
+      HdfAccessHints accessHints;
+      /// True while the time series file is open
+      bool seriesOpen;
+      /// True if asynchronous output has been requested and is supported
+      bool asyncActive;
+      /// Staging buffers for the snapshots that are waiting to be written
+      StagingPool<StagingContainer> stagingPool;
+#if defined(SCHNEK_HAVE_MPI) && !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+      /// The group of processes writing into the same file
+      HdfAggregator aggregator;
+      /// The data of the group, only used on the aggregator
+      StagingContainer aggregated;
+      /// Gather the data of the group and write it on the aggregator
+      void writeAggregated();
+#endif
+
     protected:
       /// Open the output file
       void open(const std::string &);
@@ -250,11 +858,22 @@ namespace schnek {
 
       /// Block inititialisation
       void init();
+      /// Block callback to initialise the parameters
+      void initParameters(BlockParameters &blockPars);
       /// Get the global minimum of the simulation bounds
       virtual IndexType getGlobalMin() = 0;
       /// Get the global maximum of the simulation bounds
       virtual IndexType getGlobalMax() = 0;
 
+      /**
+       * Restrict the container to the output region and stride
+       *
+       * Processes that do not hold any cells of the region are excluded from
+       * the output. Classes with derived fields have to call this after setting
+       * up the container.
+       */
+      void selectRegion();
+
       /**
        * Get the name of the data set in the HDF file
        *
@@ -272,13 +891,293 @@ namespace schnek {
       virtual pHdfAttributes getAttributes() { return std::make_shared<HdfAttributes>(); };
 
     public:
-      virtual ~HDFGridDiagnostic() {}
+      /// Default constructor
+      HDFGridDiagnostic()
+          : async(0),
+            timeSeries(0),
+            aggregate(0),
+            subfiles(0),
+            seriesOpen(false),
+            asyncActive(false) {}
+      /// Waits for any pending asynchronous output
+      virtual ~HDFGridDiagnostic();
+  };
+
+  /**
+   * Abstract diagnostic class for writing several grids into one HDF5 file
+   *
+   * The `fields` parameter holds a comma separated list of the fields to write.
+   * At every output, all the fields are written as datasets of the same file in
+   * a single open and close cycle. With HDF5 1.14 or newer the datasets are
+   * written using a single multi-dataset write.
+   *
+   * All the fields must be defined on the same global domain.
+   */
+  template<typename Type, class DiagnosticType = IntervalDiagnostic>
+  class HDFMultiGridDiagnostic : public DiagnosticType {
+    public:
+      typedef typename Type::IndexType IndexType;
+
+    protected:
+      HdfOStream output;
+      /// The names of the fields to write
+      std::vector<std::string> fieldNames;
+      std::vector<GridContainer<Type> > containers;
+
+      /// Parameter: the comma separated list of fields
+      std::string fields;
+      /// Parameters: the chunk size and the filters
+      HdfDatasetParameters<Type::Rank> datasetParameters;
+
+    protected:
+      /// Open the output file
+      void open(const std::string &);
+      /// Write all fields into the output file
+      void write();
+      /// Close the output file
+      void close();
+
+      /// Block inititialisation
+      void init();
+      /// Block callback to initialise the parameters
+      void initParameters(BlockParameters &blockPars);
+      /// Get the global minimum of the simulation bounds
+      virtual IndexType getGlobalMin() = 0;
+      /// Get the global maximum of the simulation bounds
+      virtual IndexType getGlobalMax() = 0;
+
+      /**
+       * Get the name of the data set of a field in the HDF file
+       *
+       * @return  the field name
+       */
+      virtual std::string getDatasetName(const std::string &fieldName) { return fieldName; }
+
+      /**
+       * Get the attributes to be stored with each dataset.
+       *
+       * @return  an empty attributes set
+       */
+      virtual pHdfAttributes getAttributes() { return std::make_shared<HdfAttributes>(); };
+
+    public:
+      /// Default constructor
+      HDFMultiGridDiagnostic() {}
+      virtual ~HDFMultiGridDiagnostic() {}
+  };
+
+  /**
+   * Abstract diagnostic class for writing planes or lines through a grid
+   *
+   * The parameters `slicex`, `slicey`, ... fix the global index of the slice
+   * in the given dimensions. These dimensions are removed from the dataset, so
+   * that a plane through a 3D grid is written as a 2D dataset. Only the
+   * processes that hold a part of the slice take part in the output. The slice
+   * is always written as a time series.
+   */
+  template<typename Type, class DiagnosticType = IntervalDiagnostic>
+  class HDFSliceDiagnostic : public HDFGridDiagnostic<Type, DiagnosticType> {
+    public:
+      typedef typename Type::IndexType IndexType;
+
+    protected:
+      /// Parameter: the global index of the slice, unset dimensions are not fixed
+      Array<int, Type::Rank> slice;
+
+      /// Block inititialisation
+      void init();
+      /// Block callback to initialise the parameters
+      void initParameters(BlockParameters &blockPars);
+  };
+
+  /**
+   * Wait for the background I/O thread before calling HDF5 from the main thread.
+   *
+   * The HDF5 library is only safe to call from several threads if it has been
+   * built with thread safety enabled.
+   */
+  inline void waitForAsyncHdfOutput() {
+#ifndef H5_HAVE_THREADSAFE
+    AsyncOutputQueue::instance().flush();
+#endif
+  }
+
+  /**
+   * Index of the pieces of global datasets that were written with one file per process
+   *
+   * The files are found by replacing `#p` in the file name by the process
+   * numbers up to the number of processes that wrote the data. Missing files
+   * are skipped, so that aggregated output can be indexed as well. The first
+   * process scans the placement attributes of all the files and shares the
+   * index with the others, so scan() has to be called on all processes.
+   */
+  class HdfPieceIndex {
+    private:
+      int rank;
+      /// For every file, its number followed by the lowest and highest owned cell
+      std::vector<int> pieces;
+      std::string pattern;
+
+      /// Read the placement of the given datasets from all files
+      void scanFiles(int files, const std::vector<std::string> &datasets);
+
+    public:
+      HdfPieceIndex() : rank(0) {}
+
+      /// The file name of a process, the placeholder `#p` is replaced by the process number
+      static std::string fileName(const std::string &pattern, int file);
+
+      /**
+       * Build the index
+       *
+       * @param pattern   the file name containing the placeholder `#p`
+       * @param files     the number of processes that wrote the files
+       * @param datasets  the datasets whose owned cells are combined for each file
+       */
+      void scan(const std::string &pattern, int files, const std::vector<std::string> &datasets);
+
+      /// The names of all the files holding owned cells in the box given in lattice coordinates
+      std::vector<std::string> overlapping(const std::vector<int> &lo, const std::vector<int> &hi) const;
+  };
+
+  /**
+   * The constant numerical values of the variables in the setup file
+   *
+   * The values are keyed by the names of the enclosing blocks and the name of
+   * the variable, separated by dots.
+   */
+  struct HdfParameterValues {
+      std::map<std::string, int> intValues;
+      std::map<std::string, double> floatValues;
+
+      /// Collect the values of the variables of a block and all its children except skip
+      void collect(pBlockVariables vars, pBlockVariables skip = pBlockVariables(), const std::string &prefix = "");
+      /// Set the values as attributes, the attributes refer to the values stored here
+      void setAttributes(HdfAttributes &attributes) const;
+      /// The names of all values that differ from the attributes of a group in the input file
+      std::vector<std::string> compare(HdfIStream &input, const std::string &group) const;
+  };
+
+  /**
+   * Checkpoint of all the fields of one type registered with Block::addData
+   *
+   * At every output, all fields of type `Type` that have been registered by any
+   * block of the simulation are written into a single file. Each field is
+   * stored in a dataset named by its key relative to the root block, e.g.
+   * `Ex` or `species.density`. The file also holds the time counter and the
+   * physical time of the DiagnosticManager and, in the group `parameters`, the
+   * constant numerical variables of the setup file outside the checkpoint block.
+   *
+   * When the `restart` parameter names a checkpoint file, restart() reads all
+   * the fields and the time back. It should be called after the simulation has
+   * been initialised and the time has been passed to the DiagnosticManager.
+   * Only the inner cells are read with parallel HDF5, the ghost cells have to
+   * be exchanged afterwards. Parameters that differ from the checkpoint are
+   * reported on the master process.
+   *
+   * Without parallel HDF5 every process writes its own checkpoint file. Setting
+   * `restartRanks` to the number of processes that wrote the checkpoint allows
+   * restarting with a different number of processes or decomposition. Each
+   * process then reads the cells it owns from all the files that hold them.
+   *
+   * With `incremental` set to N, only every (N+1)-th checkpoint is a full base
+   * checkpoint. The others store the bitwise XOR of the fields with the base.
+   * Chunks of the difference that are zero are not written at all and the
+   * others are compressed. A copy of the base is kept in memory. To restart
+   * from an incremental checkpoint, `restartBase` has to name the base
+   * checkpoint it was written against.
+   */
+  template<typename Type, class DiagnosticType = IntervalDiagnostic>
+  class HDFCheckpoint : public DiagnosticType {
+    public:
+      typedef typename Type::IndexType IndexType;
+      typedef typename Type::value_type value_type;
+      /// The unsigned type holding the bits of a field value
+      typedef typename HdfUnsigned<sizeof(value_type)>::type Word;
+      /// The grid holding the bits of a field, its memory layout may differ from the field
+      typedef Grid<Word, Type::Rank> WordGrid;
+
+    protected:
+      HdfOStream output;
+      /// All the fields of the simulation, keyed by their name
+      std::map<std::string, Type *> fields;
+      /// The bits of the fields at the last base checkpoint
+      std::map<std::string, WordGrid> base;
+      /// The time counter of the last base checkpoint
+      int baseTimeCounter;
+      /// The number of incremental checkpoints since the last base checkpoint
+      int deltaCount;
+      /// The dataset options of base checkpoints
+      HdfDatasetOptions baseOptions;
+      /// The dataset options of incremental checkpoints
+      HdfDatasetOptions deltaOptions;
+
+      /// Parameter: the name of the checkpoint file to restart from
+      std::string restartFile;
+      /// Parameter: the base checkpoint when restarting from an incremental checkpoint
+      std::string restartBase;
+      /// Parameter: the number of processes that wrote the checkpoint, zero for the current decomposition
+      int restartRanks;
+      /// Parameter: the number of incremental checkpoints between two base checkpoints
+      int incremental;
+      /// Parameters: the chunk size and the lossless filters
+      HdfDatasetParameters<Type::Rank> datasetParameters;
+
+    protected:
+      /// Open the output file
+      void open(const std::string &);
+      /// Write all fields, the time and the parameters into the output file
+      void write();
+      /// Close the output file
+      void close();
+
+      /// Block inititialisation, collects the fields
+      void init();
+      /// Block callback to initialise the parameters
+      void initParameters(BlockParameters &blockPars);
+      /// Get the global minimum of the simulation bounds
+      virtual IndexType getGlobalMin() = 0;
+      /// Get the global maximum of the simulation bounds
+      virtual IndexType getGlobalMax() = 0;
+
+      /// The container for writing or reading a field
+      GridContainer<Type> getContainer(Type &field);
+      /// Write the bitwise difference of the fields to the base checkpoint
+      void writeDelta();
+      /// The files of a checkpoint that hold the data of this process
+      std::vector<std::string> checkpointFiles(const std::string &fileName);
+      /// Read the fields, or combine them with the differences of an incremental checkpoint
+      void readFields(const std::vector<std::string> &files, bool delta);
+
+    public:
+      /// Default constructor
+      HDFCheckpoint() : baseTimeCounter(0), deltaCount(0), restartRanks(0), incremental(0) {}
+      virtual ~HDFCheckpoint() {}
+
+      /// Copy the bits of the field into a grid of the same extent
+      static void getBits(const Type &field, WordGrid &bits);
+      /// The bitwise difference between the field and the bits of the base checkpoint
+      static void getDifference(const Type &field, const WordGrid &base, WordGrid &delta);
+      /// Flip the bits of the field that are set in the difference
+      static void applyDifference(Type &field, const WordGrid &delta);
+
+      /**
+       * Restore the fields and the time from the file given by the `restart` parameter
+       *
+       * @return  false if no restart file has been given
+       */
+      bool restart();
   };
 
   /**
    * Reader for HDF grid data
    *
-   * An interface that
+   * An interface that reads a field from a dataset. With parallel HDF5 the
+   * inner region of every process is selected from the global dataset, so the
+   * data can be read with any decomposition. Without parallel HDF5, `#p` in
+   * the file name is replaced by the process number. Setting `inputRanks` to
+   * the number of processes that wrote the files reads the owned cells of the
+   * inner region from all the files that hold them instead.
    */
   template<typename Type>
   class HDFGridReader : public Block {
@@ -296,6 +1195,8 @@ namespace schnek {
       std::string fieldName;
       /// The name of the file to read the data from
       std::string fileName;
+      /// The number of processes that wrote one file each, zero to read a single file
+      int inputRanks;
 
     public:
       /// Default constructor
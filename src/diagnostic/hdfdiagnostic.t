@@ -24,7 +24,17 @@
  *
  */
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
 #include "../grid/field.hpp"
+#include "../util/exceptions.hpp"
 #include "../util/logger.hpp"
 
 #undef LOGLEVEL
@@ -36,6 +46,7 @@ namespace schnek {
   void HdfAttributes::set(std::string name, const T *value, hsize_t dims) {
     pInfo info(new Info);
     info->type = H5DataType<T>::type;
+    info->size = sizeof(T);
     info->buffer = value;
     info->dims = dims;
     this->attributes[name] = info;
@@ -45,6 +56,7 @@ namespace schnek {
   void HdfAttributes::set(std::string name, const T &value, hsize_t dims) {
     pInfo info(new Info);
     info->type = H5DataType<T>::type;
+    info->size = sizeof(T);
     info->buffer = &value;
     info->dims = dims;
     this->attributes[name] = info;
@@ -55,7 +67,6 @@ namespace schnek {
     std::string dset_name = getNextBlockName();
 
     typedef typename FieldType::IndexType IndexType;
-    typedef typename FieldType::value_type T;
 
     IndexType mdims = g.grid.getDims();
     IndexType mlo = g.grid.getLo();
@@ -91,9 +102,11 @@ namespace schnek {
       }
     }
 
-    T *data = g.grid.getRawData();
     hid_t ret;
 
+    int fileFortran = 0;
+    readAttribute(dset_name, "fortran_order", fileFortran);
+
     /* open the dataset collectively */
 #if H5Dopen_vers == 2
     hid_t dataset = H5Dopen(file_id, dset_name.c_str(), H5P_DEFAULT);
@@ -104,30 +117,38 @@ namespace schnek {
     assert(dataset != -1);
 
 #if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
-    /* create a file dataspace independently */
-    hid_t file_dataspace = H5Dget_space(dataset);
-    assert(file_dataspace != -1);
-
-    ret = H5Sselect_hyperslab(file_dataspace, H5S_SELECT_SET, locstart, NULL, locdims, NULL);
-    assert(ret != -1);
-
-    /* create a memory dataspace independently */
-    hid_t mem_dataspace = H5Screate_simple(FieldType::Rank, memdims, NULL);
-    assert(mem_dataspace != -1);
-    ret = H5Sselect_hyperslab(mem_dataspace, H5S_SELECT_SET, memstart, NULL, locdims, NULL);
-    assert(ret != -1);
-
     /* read the data independently */
-    ret = H5Dread(dataset, H5DataType<T>::type, mem_dataspace, file_dataspace, H5P_DEFAULT, data);
-    assert(ret != -1);
-
-    /* release all IDs created */
-    H5Sclose(mem_dataspace);
-    H5Sclose(file_dataspace);
+    readBox(dataset, g, fileFortran, locstart, locdims, memdims, memstart);
 #else
-    /* read the data on single processor */
-    ret = H5Dread(dataset, H5DataType<T>::type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
-    assert(ret != -1);
+    int offset[FieldType::Rank];
+    int innerMin[FieldType::Rank];
+    int innerMax[FieldType::Rank];
+
+    if (readPlacement(dataset, FieldType::Rank, offset, innerMin, innerMax)) {
+      /* read the owned cells that lie in the local inner region */
+      bool empty = false;
+      for (int i = 0; i < FieldType::Rank; ++i) {
+        int gmin = g.global_min[i];
+        int lo = std::max(int(llo[i]) - gmin, innerMin[i]);
+        int hi = std::min(int(lhi[i]) - gmin, innerMax[i]);
+        if (lo > hi) empty = true;
+        locstart[i] = lo - offset[i];
+        locdims[i] = hi - lo + 1;
+        memstart[i] = lo + gmin - mlo[i];
+      }
+
+      if (!empty) readBox(dataset, g, fileFortran, locstart, locdims, memdims, memstart);
+    } else if (bool(fileFortran) != hdfFortranOrder<FieldType>()) {
+      /* read the whole grid and transpose it */
+      hsize_t zero[FieldType::Rank] = {};
+      readBox(dataset, g, fileFortran, zero, memdims, memdims, zero);
+    } else {
+      /* read the data on single processor */
+      ret = H5Dread(
+          dataset, H5DataType<typename FieldType::value_type>::type, H5S_ALL, H5S_ALL, H5P_DEFAULT, g.grid.getRawData()
+      );
+      assert(ret != -1);
+    }
 #endif
 
     /* close dataset collectively */
@@ -136,186 +157,635 @@ namespace schnek {
   }
 
   template<typename FieldType>
-  void HdfOStream::writeGrid(GridContainer<FieldType> &g) {
-    if (!active) {
-      return;
+  void HdfIStream::readBox(
+      hid_t dataset,
+      GridContainer<FieldType> &g,
+      bool fileFortran,
+      const hsize_t *fileStart,
+      const hsize_t *count,
+      const hsize_t *memDims,
+      const hsize_t *memStart
+  ) {
+    typedef typename FieldType::IndexType IndexType;
+    typedef typename FieldType::value_type T;
+    const int rank = FieldType::Rank;
+    const bool gridFortran = hdfFortranOrder<FieldType>();
+
+    // the selection in the order of the dimensions of the dataset
+    hsize_t start[rank], fileCount[rank];
+    for (int i = 0; i < rank; ++i) {
+      int d = fileFortran ? rank - 1 - i : i;
+      start[i] = fileStart[d];
+      fileCount[i] = count[d];
     }
 
-    std::string dset_name = getNextBlockName();
+    hid_t file_dataspace = H5Dget_space(dataset);
+    assert(file_dataspace != -1);
+    herr_t ret = H5Sselect_hyperslab(file_dataspace, H5S_SELECT_SET, start, NULL, fileCount, NULL);
+    assert(ret != -1);
+
+    if (fileFortran == gridFortran) {
+      hsize_t dims[rank], offset[rank];
+      for (int i = 0; i < rank; ++i) {
+        int d = gridFortran ? rank - 1 - i : i;
+        dims[i] = memDims[d];
+        offset[i] = memStart[d];
+      }
+
+      hid_t mem_dataspace = H5Screate_simple(rank, dims, NULL);
+      assert(mem_dataspace != -1);
+      ret = H5Sselect_hyperslab(mem_dataspace, H5S_SELECT_SET, offset, NULL, fileCount, NULL);
+      assert(ret != -1);
+
+      ret = H5Dread(dataset, H5DataType<T>::type, mem_dataspace, file_dataspace, H5P_DEFAULT, g.grid.getRawData());
+      assert(ret != -1);
+      H5Sclose(mem_dataspace);
+    } else {
+      // HDF5 cannot transpose the data, read the box into a buffer in the order of the dataset
+      size_t size = 1;
+      for (int i = 0; i < rank; ++i) size *= count[i];
+      std::vector<T> buffer(size);
+
+      hid_t mem_dataspace = H5Screate_simple(rank, fileCount, NULL);
+      assert(mem_dataspace != -1);
+      ret = H5Dread(dataset, H5DataType<T>::type, mem_dataspace, file_dataspace, H5P_DEFAULT, buffer.data());
+      assert(ret != -1);
+      H5Sclose(mem_dataspace);
+
+      IndexType gridLo = g.grid.getLo();
+      IndexType cellHi;
+      for (int i = 0; i < rank; ++i) cellHi[i] = count[i] - 1;
+
+      Range<int, FieldType::Rank> cells(IndexType::Zero(), cellHi);
+      for (const IndexType &cell : cells) {
+        size_t index = 0;
+        for (int i = 0; i < rank; ++i) {
+          int d = fileFortran ? rank - 1 - i : i;
+          index = index * count[d] + cell[d];
+        }
+        IndexType pos;
+        for (int i = 0; i < rank; ++i) pos[i] = gridLo[i] + memStart[i] + cell[i];
+        g.grid[pos] = buffer[index];
+      }
+    }
+
+    H5Sclose(file_dataspace);
+  }
 
+  template<typename T>
+  bool HdfIStream::readAttribute(const std::string &object, const std::string &name, T &value) {
+    if (!active || (H5Aexists_by_name(file_id, object.c_str(), name.c_str(), H5P_DEFAULT) <= 0)) return false;
+
+    hid_t attribute = H5Aopen_by_name(file_id, object.c_str(), name.c_str(), H5P_DEFAULT, H5P_DEFAULT);
+    herr_t ret = H5Aread(attribute, H5DataType<T>::type, &value);
+    H5Aclose(attribute);
+    return ret >= 0;
+  }
+
+  template<typename FieldType>
+  bool HdfOStream::selectGrid(
+      GridContainer<FieldType> &g,
+      hsize_t *dims,
+      hsize_t *count,
+      hsize_t *fileStart,
+      hsize_t *memDims,
+      hsize_t *memStart,
+      hsize_t *memStride
+  ) {
     typedef typename FieldType::IndexType IndexType;
-    typedef typename FieldType::value_type T;
 
-    IndexType mdims = g.grid.getDims();
     IndexType mlo = g.grid.getLo();
     IndexType mhi = g.grid.getHi();
 
-    IndexType llo = g.local_min;
-    IndexType lhi = g.local_max;
+    bool empty = false;
+    for (int i = 0; i < FieldType::Rank; ++i) {
+      memDims[i] = mhi[i] - mlo[i] + 1;
+
+#if !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+      if (!g.subset) {
+        // without parallel HDF5 every process writes its whole grid
+        dims[i] = memDims[i];
+        count[i] = memDims[i];
+        fileStart[i] = 0;
+        memStart[i] = 0;
+        memStride[i] = 1;
+        continue;
+      }
+#endif
 
-    hsize_t dims[FieldType::Rank];
+      int gmin = g.global_min[i];
+      int gmax = g.global_max[i];
+      int stride = g.stride[i];
+      SCHNEK_ASSERT(stride > 0, "HdfOStream: the stride must be positive");
 
-    hsize_t locdims[FieldType::Rank];
-    hsize_t memdims[FieldType::Rank];
-    hsize_t locstart[FieldType::Rank];
-    hsize_t memstart[FieldType::Rank];
+      // the first cell of the inner region that lies on the strided lattice
+      int lo = std::max(int(g.local_min[i]), gmin);
+      int hi = std::min(int(g.local_max[i]), gmax);
+      int first = gmin + ((lo - gmin + stride - 1) / stride) * stride;
+      int n = (first <= hi) ? (hi - first) / stride + 1 : 0;
+
+      SCHNEK_TRACE_LOG(
+          2, "HdfOStream::selectGrid(" << i << ") " << gmin << " " << gmax << " " << first << " " << n << " " << stride
+      )
+
+      count[i] = n;
+      memStart[i] = (n > 0) ? first - mlo[i] : 0;
+      memStride[i] = stride;
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+      dims[i] = (gmax - gmin) / stride + 1;
+      fileStart[i] = (n > 0) ? (first - gmin) / stride : 0;
+#else
+      // every process writes its own file
+      dims[i] = n;
+      fileStart[i] = 0;
+#endif
+      if (n == 0) empty = true;
+    }
+    return !empty;
+  }
+
+#if !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+  template<typename FieldType>
+  void HdfOStream::writePlacement(hid_t dataset, GridContainer<FieldType> &g, const hsize_t *dims) {
+    std::vector<int> offset, globalDims, innerMin, innerMax;
 
     for (int i = 0; i < FieldType::Rank; ++i) {
-      // maybe use [FieldType::Rank-1-i] as index on the LHS
+      if (g.squeeze[i] && (dims[i] == 1)) continue;
+
       int gmin = g.global_min[i];
-      dims[i] = 1 + g.global_max[i] - gmin;
-      locdims[i] = lhi[i] - llo[i] + 1;
-      locstart[i] = llo[i] - gmin;
-      memdims[i] = mhi[i] - mlo[i] + 1;
-      memstart[i] = llo[i] - mlo[i];
+      int stride = g.subset ? g.stride[i] : 1;
+      globalDims.push_back((g.global_max[i] - gmin) / stride + 1);
+      if (g.subset) {
+        // only the owned cells on the strided lattice have been written
+        int lo = std::max(int(g.local_min[i]), gmin);
+        offset.push_back((lo - gmin + stride - 1) / stride);
+      } else {
+        offset.push_back(g.grid.getLo()[i] - gmin);
+        innerMin.push_back(g.local_min[i] - gmin);
+        innerMax.push_back(g.local_max[i] - gmin);
+      }
+    }
 
-      SCHNEK_TRACE_LOG(
-          2, "HdfOStream::writeGrid(" << i << ") " << gmin << " " << g.global_max[i] << " " << llo[i] << " " << lhi[i]
-      )
+    if (offset.empty()) return;
 
-      // if (locdims[FieldType::Rank-1-i]<=0) empty = true;
+    HdfAttributes placement;
+    placement.set<int>("offset", offset.data(), offset.size());
+    placement.set<int>("global_dims", globalDims.data(), globalDims.size());
+    if (!g.subset) {
+      placement.set<int>("inner_min", innerMin.data(), innerMin.size());
+      placement.set<int>("inner_max", innerMax.data(), innerMax.size());
+    }
+    writeAttributes(dataset, placement);
+  }
+#endif
 
-      if (dims[i] < (locstart[i] + locdims[i])) {
-        std::cerr << "FATAL ERROR!\n"
-                  << "  in HdfOStream::writeGrid\n"
-                  << "Dimension " << i << ":\n  global size: " << dims[i] << "\n  global min: " << gmin
-                  << "\n  global max: " << g.global_max[i] << "\n  local start: " << locstart[i]
-                  << "\n  mlo: " << mlo[i] << "\n  mhi: " << mhi[i] << "\n  llo: " << llo[i] << "\n  lhi: " << lhi[i]
-                  << "\n  local size: " << locdims[i] << "\n  global min: " << gmin << "\n";
-        exit(-1);
+  template<typename FieldType>
+  int HdfOStream::squeezeSelection(
+      GridContainer<FieldType> &g,
+      const hsize_t *dims,
+      const hsize_t *count,
+      const hsize_t *start,
+      hsize_t *fileDims,
+      hsize_t *fileCount,
+      hsize_t *fileStart
+  ) {
+    int fileRank = 0;
+    for (int i = 0; i < FieldType::Rank; ++i) {
+      if (g.squeeze[i] && (dims[i] == 1)) continue;
+      fileDims[fileRank] = dims[i];
+      fileCount[fileRank] = count[i];
+      fileStart[fileRank] = start[i];
+      ++fileRank;
+    }
+    return fileRank;
+  }
+
+  template<typename T>
+  hid_t HdfOStream::diskDataType(bool series) const {
+    if (!std::is_floating_point<T>::value) return H5DataType<T>::type;
+    switch (datasetOptions.diskType) {
+      case HdfDiskType::Float:
+        return H5T_NATIVE_FLOAT;
+      case HdfDiskType::ScaledUInt16:
+        return series ? H5T_NATIVE_FLOAT : H5T_NATIVE_UINT16;
+      default:
+        return H5DataType<T>::type;
+    }
+  }
+
+  template<typename FieldType>
+  void HdfOStream::selectScaling(
+      GridContainer<FieldType> &g,
+      bool hasData,
+      const hsize_t *memStart,
+      const hsize_t *memStride,
+      const hsize_t *count,
+      DatasetWrite &w
+  ) {
+    typedef typename FieldType::IndexType IndexType;
+    const int rank = FieldType::Rank;
+
+    // the maximum and the negative minimum of the written cells
+    double range[2] = {-std::numeric_limits<double>::max(), -std::numeric_limits<double>::max()};
+    if (hasData) {
+      IndexType gridLo = g.grid.getLo();
+      IndexType cellHi;
+      for (int i = 0; i < rank; ++i) cellHi[i] = count[i] - 1;
+
+      Range<int, FieldType::Rank> cells(IndexType::Zero(), cellHi);
+      for (const IndexType &cell : cells) {
+        IndexType pos;
+        for (int i = 0; i < rank; ++i) pos[i] = gridLo[i] + memStart[i] + cell[i] * memStride[i];
+        double value = g.grid[pos];
+        range[0] = std::max(range[0], value);
+        range[1] = std::max(range[1], -value);
       }
     }
 
-    const T *data = g.grid.getRawData();
-    hid_t ret;
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+    MPI_Allreduce(MPI_IN_PLACE, range, 2, MPI_DOUBLE, MPI_MAX, *mpiComm);
+#endif
+
+    double offset = (range[0] >= -range[1]) ? -range[1] : 0.0;
+    double scale = (range[0] > offset) ? (range[0] - offset) / 65535.0 : 1.0;
+
+    // the transform is applied before the conversion, which truncates
+    std::ostringstream transform;
+    transform.precision(17);
+    transform << "(x-(" << offset << "))*" << (1.0 / scale) << "+0.5";
+
+    w.xfer = (dxpl_id == H5P_DEFAULT) ? H5Pcreate(H5P_DATASET_XFER) : H5Pcopy(dxpl_id);
+    herr_t ret = H5Pset_data_transform(w.xfer, transform.str().c_str());
+    assert(ret != -1);
+
+    w.scaling = std::make_shared<HdfAttributes>();
+    w.scaling->set("scale_factor", scale);
+    w.scaling->set("add_offset", offset);
+    w.scaling = w.scaling->snapshot();
+  }
+
+  template<typename FieldType>
+  HdfOStream::DatasetWrite HdfOStream::createGridDataset(GridContainer<FieldType> &g, const std::string &dset_name) {
+    typedef typename FieldType::value_type T;
+
+    hsize_t dims[FieldType::Rank];
+    hsize_t count[FieldType::Rank];
+    hsize_t fileStart[FieldType::Rank];
+    hsize_t memDims[FieldType::Rank];
+    hsize_t memStart[FieldType::Rank];
+    hsize_t memStride[FieldType::Rank];
+
+    bool hasData = selectGrid(g, dims, count, fileStart, memDims, memStart, memStride);
+
+    hsize_t fileDims[FieldType::Rank];
+    hsize_t fileCount[FieldType::Rank];
+    hsize_t fileOffset[FieldType::Rank];
+    int fileRank = squeezeSelection(g, dims, count, fileStart, fileDims, fileCount, fileOffset);
+
+    // a grid in Fortran order is described to HDF5 with reversed dimensions and stored transposed
+    const bool reversed = hdfFortranOrder<FieldType>();
+    if (reversed) {
+      std::reverse(fileDims, fileDims + fileRank);
+      std::reverse(fileCount, fileCount + fileRank);
+      std::reverse(fileOffset, fileOffset + fileRank);
+    }
+
+    hid_t fileType = diskDataType<T>();
 
-    /* setup dimensionality object */
 #if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
-    hid_t sid = H5Screate_simple(FieldType::Rank, dims, NULL);
-#else
-    hid_t sid = H5Screate_simple(FieldType::Rank, memdims, NULL);
+    if (!mainFileName.empty())
+      selectSubfile(
+          fileRank,
+          fileDims,
+          fileCount,
+          fileOffset,
+          hasData,
+          dset_name,
+          fileType,
+          reversed ? &fortranOrderAttributes() : nullptr
+      );
 #endif
 
+    DatasetWrite w;
+    w.type = H5DataType<T>::type;
+    w.data = g.grid.getRawData();
+    w.xfer = dxpl_id;
+    w.reversed = reversed;
+    if (fileType == H5T_NATIVE_UINT16 && std::is_floating_point<T>::value)
+      selectScaling(g, hasData, memStart, memStride, count, w);
+    herr_t ret;
+
+    if (reversed) {
+      std::reverse(memDims, memDims + FieldType::Rank);
+      std::reverse(memStart, memStart + FieldType::Rank);
+      std::reverse(memStride, memStride + FieldType::Rank);
+      std::reverse(count, count + FieldType::Rank);
+    }
+
+    /* setup dimensionality object */
+    hid_t sid = H5Screate_simple(fileRank, fileDims, NULL);
     assert(sid > -1);
 
     /* create a dataset */
+    hid_t dcpl = createDatasetProperties(fileRank, fileDims, fileCount, fileType);
+
 #if H5Dcreate_vers == 2
-    hid_t dataset =
-        H5Dcreate(file_id, dset_name.c_str(), H5DataType<T>::type, sid, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    hid_t dataset = H5Dcreate(file_id, dset_name.c_str(), fileType, sid, H5P_DEFAULT, dcpl, H5P_DEFAULT);
 #else
-    hid_t dataset = H5Dcreate(file_id, dset_name.c_str(), H5DataType<T>::type, sid, H5P_DEFAULT);
+    hid_t dataset = H5Dcreate(file_id, dset_name.c_str(), fileType, sid, dcpl);
 #endif
 
     assert(dataset > -1);
+    if (dcpl != H5P_DEFAULT) H5Pclose(dcpl);
 
-#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
-    /* create a file dataspace independently */
-    hid_t file_dataspace = H5Dget_space(dataset);
-    assert(file_dataspace > -1);
+#if !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+    writePlacement(dataset, g, dims);
+#endif
 
-    ret = H5Sselect_hyperslab(file_dataspace, H5S_SELECT_SET, locstart, NULL, locdims, NULL);
-    assert(ret != -1);
+    /* create a file dataspace independently */
+    w.fileSpace = H5Dget_space(dataset);
+    assert(w.fileSpace > -1);
 
     /* create a memory dataspace independently */
-    hid_t mem_dataspace = H5Screate_simple(FieldType::Rank, memdims, NULL);
-    assert(mem_dataspace > -1);
+    w.memSpace = H5Screate_simple(FieldType::Rank, memDims, NULL);
+    assert(w.memSpace > -1);
+
+    if (hasData) {
+      ret = H5Sselect_hyperslab(w.fileSpace, H5S_SELECT_SET, fileOffset, NULL, fileCount, NULL);
+      assert(ret != -1);
+      ret = H5Sselect_hyperslab(w.memSpace, H5S_SELECT_SET, memStart, memStride, count, NULL);
+      assert(ret != -1);
+    } else {
+      H5Sselect_none(w.fileSpace);
+      H5Sselect_none(w.memSpace);
+    }
 
-    ret = H5Sselect_hyperslab(mem_dataspace, H5S_SELECT_SET, memstart, NULL, locdims, NULL);
-    assert(ret != -1);
-    //  hid_t mem_dataspace = H5Dget_space(dataset);
+    w.dataset = dataset;
+    w.sid = sid;
+    return w;
+  }
 
-    /* write data independently */
-    ret = H5Dwrite(dataset, H5DataType<T>::type, mem_dataspace, file_dataspace, dxpl_id, data);
+  template<typename FieldType>
+  void HdfOStream::writeGrid(GridContainer<FieldType> &g) {
+    if (!active) {
+      return;
+    }
 
-    assert(ret != -1);
+    DatasetWrite w = createGridDataset(g, getNextBlockName());
 
-    /* release dataspace ID */
-    H5Sclose(mem_dataspace);
-    H5Sclose(file_dataspace);
-#else
-    /* write data on single processor */
-    ret = H5Dwrite(dataset, H5DataType<T>::type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+    hid_t ret = H5Dwrite(w.dataset, w.type, w.memSpace, w.fileSpace, w.xfer, w.data);
     assert(ret != -1);
-#endif
 
-    /* now write the attributes */
+    finishGridDataset(w);
+  }
 
-    int mpi_rank = 0;
-#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
-    MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+  template<typename FieldType>
+  void HdfOStream::writeGrids(
+      const std::vector<GridContainer<FieldType> *> &grids, const std::vector<std::string> &names
+  ) {
+    if (!active) {
+      return;
+    }
+
+    size_t count = grids.size();
+    std::vector<DatasetWrite> writes;
+    for (size_t i = 0; i < count; ++i) writes.push_back(createGridDataset(*grids[i], names[i]));
+
+    bool written = false;
+#if H5_VERSION_GE(1, 14, 0)
+    // scaled data needs a transfer property list for each dataset
+    bool commonTransfer = true;
+    for (DatasetWrite &w : writes) commonTransfer = commonTransfer && (w.xfer == dxpl_id);
+
+    if (commonTransfer) {
+      // a single collective write for all the datasets
+      std::vector<hid_t> datasets(count), types(count), memSpaces(count), fileSpaces(count);
+      std::vector<const void *> buffers(count);
+      for (size_t i = 0; i < count; ++i) {
+        datasets[i] = writes[i].dataset;
+        types[i] = writes[i].type;
+        memSpaces[i] = writes[i].memSpace;
+        fileSpaces[i] = writes[i].fileSpace;
+        buffers[i] = writes[i].data;
+      }
+      herr_t ret = H5Dwrite_multi(
+          count, datasets.data(), types.data(), memSpaces.data(), fileSpaces.data(), dxpl_id, buffers.data()
+      );
+      assert(ret != -1);
+      written = true;
+    }
 #endif
+    if (!written) {
+      for (DatasetWrite &w : writes) {
+        hid_t ret = H5Dwrite(w.dataset, w.type, w.memSpace, w.fileSpace, w.xfer, w.data);
+        assert(ret != -1);
+      }
+    }
 
-    if (mpi_rank == 0) {
-      /* Create the data space for the attribute. */
-      typedef std::pair<std::string, HdfAttributes::pInfo> attPair;
-      for (attPair p : attributes->attributes) {
-        HdfAttributes::Info &info = *(p.second);
+    for (DatasetWrite &w : writes) finishGridDataset(w);
+  }
 
-        const hid_t dataspace_id = H5Screate_simple(1, &info.dims, NULL);
-        /* Create a dataset attribute. */
-        const hid_t attribute_id =
-            H5Acreate2(dataset, p.first.c_str(), info.type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+  template<typename FieldType>
+  void HdfOStream::writeSparseGrid(GridContainer<FieldType> &g) {
+    if (!active) {
+      return;
+    }
 
-        /* Write the attribute data. */
-        ret = H5Awrite(attribute_id, info.type, info.buffer);
-        assert(ret != -1);
+    typedef typename FieldType::IndexType IndexType;
+    typedef typename FieldType::value_type T;
+    const int rank = FieldType::Rank;
+
+    DatasetWrite w = createGridDataset(g, getNextBlockName());
+
+    hsize_t chunk[rank];
+    hid_t dcpl = H5Dget_create_plist(w.dataset);
+    bool chunked = (H5Pget_layout(dcpl) == H5D_CHUNKED) && (H5Pget_chunk(dcpl, rank, chunk) == rank);
+    H5Pclose(dcpl);
 
-        /* Close the attribute. */
-        H5Aclose(attribute_id);
+    if (chunked && (H5Sget_select_npoints(w.fileSpace) > 0)) {
+      hsize_t fileLo[rank], fileHi[rank], memLo[rank], memHi[rank], memStride[rank];
+      H5Sget_select_bounds(w.fileSpace, fileLo, fileHi);
+      H5Sget_select_bounds(w.memSpace, memLo, memHi);
 
-        /* Close the dataspace. */
-        H5Sclose(dataspace_id);
+      IndexType tileLo, tileHi;
+      for (int i = 0; i < rank; ++i) {
+        memStride[i] = (fileHi[i] > fileLo[i]) ? (memHi[i] - memLo[i]) / (fileHi[i] - fileLo[i]) : 1;
+        tileLo[i] = fileLo[i] / chunk[i];
+        tileHi[i] = fileHi[i] / chunk[i];
+      }
+
+      // select the parts of all the chunks that hold a non-zero value, the
+      // selection is in the order of the dataset which is reversed for grids in Fortran order
+      H5Sselect_none(w.fileSpace);
+      H5Sselect_none(w.memSpace);
+
+      IndexType gridLo = g.grid.getLo();
+      Range<int, FieldType::Rank> tiles(tileLo, tileHi);
+      for (const IndexType &tile : tiles) {
+        hsize_t start[rank], count[rank], memStart[rank];
+        IndexType cellHi;
+        for (int i = 0; i < rank; ++i) {
+          start[i] = std::max(fileLo[i], tile[i] * chunk[i]);
+          count[i] = std::min(fileHi[i], (tile[i] + 1) * chunk[i] - 1) - start[i] + 1;
+          memStart[i] = memLo[i] + (start[i] - fileLo[i]) * memStride[i];
+          cellHi[i] = count[i] - 1;
+        }
+
+        bool zero = true;
+        Range<int, FieldType::Rank> cells(IndexType::Zero(), cellHi);
+        for (const IndexType &cell : cells) {
+          IndexType pos;
+          for (int i = 0; i < rank; ++i) {
+            int d = w.reversed ? rank - 1 - i : i;
+            pos[d] = gridLo[d] + memStart[i] + cell[i] * memStride[i];
+          }
+          if (g.grid[pos] != T(0)) {
+            zero = false;
+            break;
+          }
+        }
+        if (zero) continue;
+
+        herr_t ret = H5Sselect_hyperslab(w.fileSpace, H5S_SELECT_OR, start, NULL, count, NULL);
+        assert(ret != -1);
+        ret = H5Sselect_hyperslab(w.memSpace, H5S_SELECT_OR, memStart, memStride, count, NULL);
+        assert(ret != -1);
       }
     }
 
-    /* close dataset collectively */
+    hid_t ret = H5Dwrite(w.dataset, w.type, w.memSpace, w.fileSpace, w.xfer, w.data);
+    assert(ret != -1);
+
+    finishGridDataset(w);
+  }
+
+  template<typename FieldType>
+  void HdfOStream::appendGrid(GridContainer<FieldType> &g) {
+    if (!active) {
+      return;
+    }
+
+    typedef typename FieldType::value_type T;
+
+    hsize_t griddims[FieldType::Rank];
+    hsize_t gridcount[FieldType::Rank];
+    hsize_t gridstart[FieldType::Rank];
+    hsize_t memdims[FieldType::Rank];
+    hsize_t memstart[FieldType::Rank];
+    hsize_t memstride[FieldType::Rank];
+
+    bool hasData = selectGrid(g, griddims, gridcount, gridstart, memdims, memstart, memstride);
+
+    // The first dimension counts the time steps
+    hsize_t dims[FieldType::Rank + 1];
+    hsize_t maxdims[FieldType::Rank + 1];
+    hsize_t locdims[FieldType::Rank + 1];
+    hsize_t locstart[FieldType::Rank + 1];
+
+    dims[0] = 1;
+    maxdims[0] = H5S_UNLIMITED;
+    locdims[0] = 1;
+    locstart[0] = 0;
+
+    int rank = 1 + squeezeSelection(g, griddims, gridcount, gridstart, dims + 1, locdims + 1, locstart + 1);
+
+    // a grid in Fortran order is stored transposed, the time remains the slowest dimension
+    const bool reversed = hdfFortranOrder<FieldType>();
+    if (reversed) {
+      std::reverse(dims + 1, dims + rank);
+      std::reverse(locdims + 1, locdims + rank);
+      std::reverse(locstart + 1, locstart + rank);
+      std::reverse(memdims, memdims + FieldType::Rank);
+      std::reverse(memstart, memstart + FieldType::Rank);
+      std::reverse(memstride, memstride + FieldType::Rank);
+      std::reverse(gridcount, gridcount + FieldType::Rank);
+    }
+    for (int i = 1; i < rank; ++i) maxdims[i] = dims[i];
+
+    const T *data = g.grid.getRawData();
+    hid_t ret;
+    hid_t dataset;
+
+    if (H5Lexists(file_id, blockname.c_str(), H5P_DEFAULT) > 0) {
+      dataset = H5Dopen2(file_id, blockname.c_str(), H5P_DEFAULT);
+      assert(dataset > -1);
+
+      hid_t file_dataspace = H5Dget_space(dataset);
+      hsize_t current[FieldType::Rank + 1];
+      H5Sget_simple_extent_dims(file_dataspace, current, NULL);
+      H5Sclose(file_dataspace);
+
+      locstart[0] = current[0];
+      dims[0] = current[0] + 1;
+      ret = H5Dset_extent(dataset, dims);
+      assert(ret != -1);
+    } else {
+      hid_t sid = H5Screate_simple(rank, dims, maxdims);
+      assert(sid > -1);
+
+      hid_t fileType = diskDataType<T>(true);
+      hid_t dcpl = createDatasetProperties(rank, dims, locdims, fileType, true);
+      dataset = H5Dcreate2(file_id, blockname.c_str(), fileType, sid, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+      assert(dataset > -1);
+
+      H5Pclose(dcpl);
+      H5Sclose(sid);
+
+      writeAttributes(dataset);
+      if (reversed) writeAttributes(dataset, fortranOrderAttributes());
+#if !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+      writePlacement(dataset, g, griddims);
+#endif
+    }
+
+    hid_t file_dataspace = H5Dget_space(dataset);
+    assert(file_dataspace > -1);
+    hid_t mem_dataspace = H5Screate_simple(FieldType::Rank, memdims, NULL);
+    assert(mem_dataspace > -1);
+
+    if (hasData) {
+      ret = H5Sselect_hyperslab(file_dataspace, H5S_SELECT_SET, locstart, NULL, locdims, NULL);
+      assert(ret != -1);
+      ret = H5Sselect_hyperslab(mem_dataspace, H5S_SELECT_SET, memstart, memstride, gridcount, NULL);
+      assert(ret != -1);
+    } else {
+      H5Sselect_none(file_dataspace);
+      H5Sselect_none(mem_dataspace);
+    }
+
+    ret = H5Dwrite(dataset, H5DataType<T>::type, mem_dataspace, file_dataspace, dxpl_id, data);
+    assert(ret != -1);
+
+    H5Sclose(mem_dataspace);
+    H5Sclose(file_dataspace);
+
     ret = H5Dclose(dataset);
     assert(ret != -1);
+  }
 
-    /* release all IDs created */
-    H5Sclose(sid);
-  }
-
-  template<typename InnerType>
-  struct CopyToContainer {
-      static void copy(InnerType field, GridContainer<InnerType> &container);
-  };
-
-  template<
-      typename T,
-      size_t rank,
-      template<size_t>
-      class CheckingPolicy,
-      template<typename, size_t>
-      class StoragePolicy>
-  struct CopyToContainer<Field<T, rank, CheckingPolicy, StoragePolicy> > {
-      static void copy(
-          Field<T, rank, CheckingPolicy, StoragePolicy> field,
-          GridContainer<Field<T, rank, CheckingPolicy, StoragePolicy> > &container
-      );
-  };
-
-  template<
-      typename T,
-      size_t rank,
-      template<size_t>
-      class CheckingPolicy,
-      template<typename, size_t>
-      class StoragePolicy>
-  inline void CopyToContainer<Field<T, rank, CheckingPolicy, StoragePolicy> >::copy(
-      Field<T, rank, CheckingPolicy, StoragePolicy> field,
-      GridContainer<Field<T, rank, CheckingPolicy, StoragePolicy> > &container
-  ) {
-    container.grid = field;
-    container.local_min = field.getInnerLo();
-    container.local_max = field.getInnerHi();
+  //------------------------------------------------------------------------------
+  // HdfDatasetParameters
+  //------------------------------------------------------------------------------
+
+  template<size_t rank>
+  void HdfDatasetParameters<rank>::initParameters(BlockParameters &blockPars, bool lossy) {
+    blockPars.addArrayParameter("chunk", chunkSize, 0);
+    blockPars.addParameter("deflate", &deflate, 0);
+    blockPars.addParameter("shuffle", &shuffle, 0);
+    if (!lossy) return;
+    blockPars.addParameter("scaleOffset", &scaleOffset, -1);
+    blockPars.addParameter("diskType", &diskType, std::string("native"));
   }
 
-  template<typename InnerType>
-  inline void CopyToContainer<InnerType>::copy(InnerType field, GridContainer<InnerType> &container) {
-    container.grid = field;
-    container.local_min = field.getLo();
-    container.local_max = field.getHi();
+  template<size_t rank>
+  HdfDatasetOptions HdfDatasetParameters<rank>::getOptions(hsize_t defaultChunk) const {
+    HdfDatasetOptions options;
+    for (size_t i = 0; i < rank; ++i) options.chunk.push_back(chunkSize[i] > 0 ? chunkSize[i] : defaultChunk);
+    options.deflate = deflate;
+    options.shuffle = bool(shuffle);
+    options.scaleOffset = scaleOffset;
+    options.diskType = parseHdfDiskType(diskType);
+    return options;
   }
 
   //------------------------------------------------------------------------------
@@ -327,21 +797,111 @@ namespace schnek {
     return "data";
   }
 
+  template<typename Type, class DiagnosticType>
+  HDFGridDiagnostic<Type, DiagnosticType>::~HDFGridDiagnostic() {
+    // pending tasks refer to the output stream and the staging pool
+    if (asyncActive)
+      AsyncOutputQueue::instance().flush();
+    else
+      waitForAsyncHdfOutput();
+  }
+
   template<typename Type, class DiagnosticType>
   void HDFGridDiagnostic<Type, DiagnosticType>::open(const std::string &fname) {
-    output.open(fname.c_str());
+    if (timeSeries) {
+      // only the first output opens the file
+      if (seriesOpen) return;
+      seriesOpen = true;
+    }
+
+    if (asyncActive) {
+      // collective operations on the output thread must not share a communicator with the simulation
+      output.useOwnCommunicator();
+      AsyncOutputQueue::instance().enqueue([this, fname]() { output.open(fname.c_str()); });
+    } else {
+      waitForAsyncHdfOutput();
+      output.open(fname.c_str());
+    }
   }
 
   template<typename Type, class DiagnosticType>
   void HDFGridDiagnostic<Type, DiagnosticType>::write() {
-    output.setBlockName(this->getDatasetName());
-    output.setAttributes(this->getAttributes());
-    output.writeGrid(container);
+#if defined(SCHNEK_HAVE_MPI) && !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+    if (aggregate > 1) {
+      writeAggregated();
+      return;
+    }
+#endif
+
+    if (!asyncActive) {
+      waitForAsyncHdfOutput();
+      output.setBlockName(this->getDatasetName());
+      output.setAttributes(this->getAttributes());
+      if (timeSeries) {
+        output.appendGrid(container);
+        output.appendTime(this->outputTime);
+      } else {
+        output.writeGrid(container);
+      }
+      return;
+    }
+
+    // Take a snapshot of the data and attributes, the simulation can continue
+    // while the snapshot is written
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+    // only the inner region is written
+    Range<int, Type::Rank> region(container.local_min, container.local_max);
+#else
+    // the whole grid is written
+    Range<int, Type::Rank> region(container.grid.getLo(), container.grid.getHi());
+#endif
+
+    std::shared_ptr<StagingContainer> staging = stagingPool.acquire();
+    staging->grid.resize(region.getLo(), region.getHi());
+    staging->global_min = container.global_min;
+    staging->global_max = container.global_max;
+    staging->local_min = container.local_min;
+    staging->local_max = container.local_max;
+    staging->stride = container.stride;
+    staging->subset = container.subset;
+    staging->squeeze = container.squeeze;
+
+    for (const typename Range<int, Type::Rank>::LimitType &pos : region) staging->grid[pos] = container.grid[pos];
+
+    std::string blockName = this->getDatasetName();
+    pHdfAttributes attributes = this->getAttributes()->snapshot();
+
+    bool series = bool(timeSeries);
+    double time = this->outputTime;
+
+    AsyncOutputQueue::instance().enqueue([this, staging, blockName, attributes, series, time]() {
+      output.setBlockName(blockName);
+      output.setAttributes(attributes);
+      if (series) {
+        output.appendGrid(*staging);
+        output.appendTime(time);
+      } else {
+        output.writeGrid(*staging);
+      }
+    });
   }
 
   template<typename Type, class DiagnosticType>
   void HDFGridDiagnostic<Type, DiagnosticType>::close() {
-    output.close();
+    // A time series file stays open, but the data is flushed so that it
+    // survives a crash
+    if (asyncActive) {
+      if (timeSeries)
+        AsyncOutputQueue::instance().enqueue([this]() { output.flush(); });
+      else
+        AsyncOutputQueue::instance().enqueue([this]() { output.close(); });
+    } else {
+      waitForAsyncHdfOutput();
+      if (timeSeries)
+        output.flush();
+      else
+        output.close();
+    }
   }
 
   template<typename Type, class DiagnosticType>
@@ -352,13 +912,568 @@ namespace schnek {
       CopyToContainer<Type>::copy(this->field, container);
       container.global_min = this->getGlobalMin();
       container.global_max = this->getGlobalMax();
+      selectRegion();
+    }
+
+    output.setDatasetOptions(datasetParameters.getOptions());
+    output.setAccessHints(accessHints);
+    // virtual datasets are not extendible
+    output.setSubfiling(timeSeries ? 0 : subfiles);
+
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+    // Parallel HDF5 calls MPI collectives from the I/O thread
+    int provided;
+    MPI_Query_thread(&provided);
+    asyncActive = bool(async) && (provided == MPI_THREAD_MULTIPLE);
+#else
+    asyncActive = bool(async);
+#endif
+
+#if defined(SCHNEK_HAVE_MPI) && !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+    if (aggregate > 1) {
+      aggregator.init(aggregate);
+      // only the aggregators open files
+      output.setActive(aggregator.isAggregator());
+      asyncActive = false;
     }
+#endif
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFGridDiagnostic<Type, DiagnosticType>::initParameters(BlockParameters &blockPars) {
+    SimpleDiagnostic<Type, Type, DiagnosticType>::initParameters(blockPars);
+    blockPars.addParameter("async", &async, 0);
+    datasetParameters.initParameters(blockPars, true);
+    blockPars.addParameter("timeSeries", &timeSeries, 0);
+    blockPars.addArrayParameter("lo", regionLo, std::numeric_limits<int>::min());
+    blockPars.addArrayParameter("hi", regionHi, std::numeric_limits<int>::max());
+    blockPars.addArrayParameter("stride", stride, 1);
+    blockPars.addParameter("aggregate", &aggregate, 0);
+    blockPars.addParameter("subfiles", &subfiles, 0);
+
+    HdfAccessHints defaults;
+    blockPars.addParameter("sieveBufSize", &accessHints.sieveBufSize, defaults.sieveBufSize);
+    blockPars.addParameter("alignThreshold", &accessHints.alignThreshold, defaults.alignThreshold);
+    blockPars.addParameter("alignment", &accessHints.alignment, defaults.alignment);
+    blockPars.addParameter("cbBlockSize", &accessHints.cbBlockSize, defaults.cbBlockSize);
+    blockPars.addParameter("cbBufferSize", &accessHints.cbBufferSize, defaults.cbBufferSize);
+  }
+
+#if defined(SCHNEK_HAVE_MPI) && !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+  template<typename Type, class DiagnosticType>
+  void HDFGridDiagnostic<Type, DiagnosticType>::writeAggregated() {
+    typedef typename Type::value_type T;
+    typedef typename Range<int, Type::Rank>::LimitType LimitType;
+    const int rank = Type::Rank;
+
+    // The strided cells of the inner region in the index space of the dataset
+    std::vector<int> box(2 * rank);
+    bool hasData = true;
+    for (int i = 0; i < rank; ++i) {
+      int gmin = container.global_min[i];
+      int lo = std::max(int(container.local_min[i]), gmin);
+      int hi = std::min(int(container.local_max[i]), int(container.global_max[i]));
+      box[i] = (lo - gmin + container.stride[i] - 1) / container.stride[i];
+      box[rank + i] = (hi >= gmin) ? (hi - gmin) / container.stride[i] : -1;
+      if (box[i] > box[rank + i]) hasData = false;
+    }
+
+    std::vector<T> send;
+    if (hasData) {
+      LimitType boxLo, boxHi;
+      for (int i = 0; i < rank; ++i) {
+        boxLo[i] = box[i];
+        boxHi[i] = box[rank + i];
+      }
+      Range<int, rank> local(boxLo, boxHi);
+      for (const LimitType &pos : local) {
+        LimitType cell;
+        for (int i = 0; i < rank; ++i) cell[i] = container.global_min[i] + container.stride[i] * pos[i];
+        send.push_back(container.grid[cell]);
+      }
+    }
+
+    std::vector<int> boxes;
+    aggregator.gather(box.data(), 2 * rank, boxes);
+
+    int groupSize = aggregator.getGroupSize();
+    std::vector<int> sizes;
+    bool empty = true;
+    LimitType lo, hi;
+    if (aggregator.isAggregator()) {
+      for (int p = 0; p < groupSize; ++p) {
+        const int *pbox = &boxes[2 * rank * p];
+        long count = 1;
+        for (int i = 0; i < rank; ++i) count *= std::max(0, pbox[rank + i] - pbox[i] + 1);
+        sizes.push_back(count * sizeof(T));
+        if (count == 0) continue;
+
+        for (int i = 0; i < rank; ++i) {
+          lo[i] = empty ? pbox[i] : std::min(lo[i], pbox[i]);
+          hi[i] = empty ? pbox[rank + i] : std::max(hi[i], pbox[rank + i]);
+        }
+        empty = false;
+      }
+    }
+
+    std::vector<char> recv;
+    aggregator.gatherData(send.data(), send.size() * sizeof(T), sizes, recv);
+
+    if (!aggregator.isAggregator() || empty) return;
+
+    // Cells of the bounding box that are not held by any process of the group are zero
+    aggregated.grid.resize(lo, hi);
+    aggregated.grid = T(0);
+
+    const T *data = reinterpret_cast<const T *>(recv.data());
+    for (int p = 0; p < groupSize; ++p) {
+      if (sizes[p] == 0) continue;
+      LimitType boxLo, boxHi;
+      for (int i = 0; i < rank; ++i) {
+        boxLo[i] = boxes[2 * rank * p + i];
+        boxHi[i] = boxes[2 * rank * p + rank + i];
+      }
+      Range<int, rank> pRange(boxLo, boxHi);
+      for (const LimitType &pos : pRange) aggregated.grid[pos] = *(data++);
+    }
+
+    // the box is given in lattice coordinates, so that the placement of the
+    // written data refers to the global dataset
+    for (int i = 0; i < rank; ++i) {
+      aggregated.global_min[i] = 0;
+      aggregated.global_max[i] = (container.global_max[i] - container.global_min[i]) / container.stride[i];
+    }
+    aggregated.local_min = lo;
+    aggregated.local_max = hi;
+    aggregated.subset = true;
+    aggregated.squeeze = container.squeeze;
+
+    output.setBlockName(this->getDatasetName());
+    output.setAttributes(this->getAttributes());
+    if (timeSeries) {
+      output.appendGrid(aggregated);
+      output.appendTime(this->outputTime);
+    } else {
+      output.writeGrid(aggregated);
+    }
+  }
+#endif
+
+  template<typename Type, class DiagnosticType>
+  void HDFGridDiagnostic<Type, DiagnosticType>::selectRegion() {
+    bool subset = false;
+    bool hasData = true;
+
+    for (size_t i = 0; i < Type::Rank; ++i) {
+      int gmin = container.global_min[i];
+      int gmax = container.global_max[i];
+      int lo = std::max(gmin, regionLo[i]);
+      int hi = std::min(gmax, regionHi[i]);
+
+      SCHNEK_ASSERT(lo <= hi, "HDFGridDiagnostic: the output region is empty in dimension " << i);
+      SCHNEK_ASSERT(stride[i] > 0, "HDFGridDiagnostic: the stride must be positive in dimension " << i);
+
+      if ((lo != gmin) || (hi != gmax) || (stride[i] != 1)) subset = true;
+
+      container.global_min[i] = lo;
+      container.global_max[i] = hi;
+      container.stride[i] = stride[i];
+
+      // the first cell of the inner region on the strided lattice
+      int llo = std::max(int(container.local_min[i]), lo);
+      int first = lo + ((llo - lo + stride[i] - 1) / stride[i]) * stride[i];
+      if (first > std::min(int(container.local_max[i]), hi)) hasData = false;
+    }
+
+    container.subset = subset;
+    // all processes see the same parameters, so either all or none call setActive
+    if (subset) output.setActive(hasData);
+  }
+
+  //------------------------------------------------------------------------------
+  // HDFSliceDiagnostic
+  //------------------------------------------------------------------------------
+
+  template<typename Type, class DiagnosticType>
+  void HDFSliceDiagnostic<Type, DiagnosticType>::init() {
+    bool sliced = false;
+    for (size_t i = 0; i < Type::Rank; ++i) {
+      if (slice[i] == std::numeric_limits<int>::min()) continue;
+      this->regionLo[i] = slice[i];
+      this->regionHi[i] = slice[i];
+      sliced = true;
+    }
+    SCHNEK_ASSERT(sliced, "HDFSliceDiagnostic needs the slice position in at least one dimension");
+
+    this->timeSeries = 1;
+    HDFGridDiagnostic<Type, DiagnosticType>::init();
+
+    for (size_t i = 0; i < Type::Rank; ++i)
+      this->container.squeeze[i] = (slice[i] != std::numeric_limits<int>::min());
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFSliceDiagnostic<Type, DiagnosticType>::initParameters(BlockParameters &blockPars) {
+    HDFGridDiagnostic<Type, DiagnosticType>::initParameters(blockPars);
+    blockPars.addArrayParameter("slice", slice, std::numeric_limits<int>::min());
+  }
+
+  //------------------------------------------------------------------------------
+  // HDFMultiGridDiagnostic
+  //------------------------------------------------------------------------------
+
+  template<typename Type, class DiagnosticType>
+  void HDFMultiGridDiagnostic<Type, DiagnosticType>::open(const std::string &fname) {
+    waitForAsyncHdfOutput();
+    output.open(fname.c_str());
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFMultiGridDiagnostic<Type, DiagnosticType>::write() {
+    waitForAsyncHdfOutput();
+    std::vector<GridContainer<Type> *> grids;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < containers.size(); ++i) {
+      grids.push_back(&containers[i]);
+      names.push_back(this->getDatasetName(fieldNames[i]));
+    }
+    output.setAttributes(this->getAttributes());
+    output.writeGrids(grids, names);
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFMultiGridDiagnostic<Type, DiagnosticType>::close() {
+    output.close();
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFMultiGridDiagnostic<Type, DiagnosticType>::init() {
+    DiagnosticType::init();
+
+    fieldNames.clear();
+    boost::split(fieldNames, fields, boost::is_any_of(","));
+    for (std::string &name : fieldNames) boost::trim(name);
+    fieldNames.erase(std::remove(fieldNames.begin(), fieldNames.end(), std::string()), fieldNames.end());
+    SCHNEK_ASSERT(!fieldNames.empty(), "HDFMultiGridDiagnostic needs at least one field");
+
+    containers.resize(fieldNames.size());
+    for (size_t i = 0; i < fieldNames.size(); ++i) {
+      Type field;
+      this->retrieveData(fieldNames[i], field);
+      CopyToContainer<Type>::copy(field, containers[i]);
+      containers[i].global_min = this->getGlobalMin();
+      containers[i].global_max = this->getGlobalMax();
+    }
+
+    output.setDatasetOptions(datasetParameters.getOptions());
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFMultiGridDiagnostic<Type, DiagnosticType>::initParameters(BlockParameters &blockPars) {
+    DiagnosticType::initParameters(blockPars);
+    blockPars.addParameter("fields", &fields);
+    datasetParameters.initParameters(blockPars, true);
+  }
+
+  //------------------------------------------------------------------------------
+  // HDFCheckpoint
+  //------------------------------------------------------------------------------
+
+  template<typename Type, class DiagnosticType>
+  GridContainer<Type> HDFCheckpoint<Type, DiagnosticType>::getContainer(Type &field) {
+    GridContainer<Type> container;
+    CopyToContainer<Type>::copy(field, container);
+    container.global_min = this->getGlobalMin();
+    container.global_max = this->getGlobalMax();
+    return container;
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::open(const std::string &fname) {
+    waitForAsyncHdfOutput();
+    output.open(fname.c_str());
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::write() {
+    waitForAsyncHdfOutput();
+
+    DiagnosticManager &manager = DiagnosticManager::instance();
+    int timeCounter = manager.getTimeCounter();
+    double physicalTime = manager.getPhysicalTime();
+    HdfAttributes time;
+    time.set("timeCounter", timeCounter);
+    time.set("physicalTime", physicalTime);
+
+    output.setAttributes(std::make_shared<HdfAttributes>());
+
+    if ((incremental > 0) && !base.empty() && (deltaCount < incremental)) {
+      ++deltaCount;
+      writeDelta();
+      time.set("baseTimeCounter", baseTimeCounter);
+    } else {
+      // the map keeps the same order of the fields on all processes
+      std::vector<GridContainer<Type> > containers;
+      std::vector<std::string> names;
+      containers.reserve(fields.size());
+      for (std::pair<const std::string, Type *> &entry : fields) {
+        containers.push_back(getContainer(*entry.second));
+        names.push_back(entry.first);
+      }
+      std::vector<GridContainer<Type> *> grids;
+      for (GridContainer<Type> &container : containers) grids.push_back(&container);
+
+      output.setDatasetOptions(baseOptions);
+      output.writeGrids(grids, names);
+
+      if (incremental > 0) {
+        // keep the bits of the fields for the following incremental checkpoints
+        for (std::pair<const std::string, Type *> &entry : fields) {
+          Type &field = *entry.second;
+          getBits(field, base[entry.first]);
+        }
+        baseTimeCounter = timeCounter;
+        deltaCount = 0;
+      }
+    }
+
+    output.writeFileAttributes(time);
+
+    HdfParameterValues values;
+    values.collect(this->getVariables(), this->getLocalVariables());
+    HdfAttributes parameters;
+    values.setAttributes(parameters);
+    output.writeFileAttributes(parameters, "parameters");
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::writeDelta() {
+    output.setDatasetOptions(deltaOptions);
+
+    for (std::pair<const std::string, Type *> &entry : fields) {
+      Type &field = *entry.second;
+      WordGrid &bits = base[entry.first];
+      SCHNEK_ASSERT(
+          (bits.getLo() == field.getLo()) && (bits.getHi() == field.getHi()),
+          "HDFCheckpoint: the field " << entry.first << " has been resized since the base checkpoint"
+      );
+
+      GridContainer<Type> source = getContainer(field);
+      GridContainer<WordGrid> container;
+      container.global_min = source.global_min;
+      container.global_max = source.global_max;
+      container.local_min = source.local_min;
+      container.local_max = source.local_max;
+
+      getDifference(field, bits, container.grid);
+
+      output.setBlockName(entry.first);
+      output.writeSparseGrid(container);
+    }
+  }
+
+  // The bits are copied cell by cell, because the field and the WordGrid may
+  // store their data in a different order
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::getBits(const Type &field, WordGrid &bits) {
+    bits.resize(field.getLo(), field.getHi());
+    Range<int, Type::Rank> range(field.getLo(), field.getHi());
+    for (const IndexType &pos : range) {
+      value_type value = field[pos];
+      std::memcpy(&bits[pos], &value, sizeof(Word));
+    }
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::getDifference(const Type &field, const WordGrid &base, WordGrid &delta) {
+    delta.resize(field.getLo(), field.getHi());
+    Range<int, Type::Rank> range(field.getLo(), field.getHi());
+    for (const IndexType &pos : range) {
+      value_type value = field[pos];
+      Word word;
+      std::memcpy(&word, &value, sizeof(Word));
+      delta[pos] = word ^ base[pos];
+    }
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::applyDifference(Type &field, const WordGrid &delta) {
+    Range<int, Type::Rank> range(field.getLo(), field.getHi());
+    for (const IndexType &pos : range) {
+      Word word;
+      std::memcpy(&word, &field[pos], sizeof(Word));
+      word ^= delta[pos];
+      std::memcpy(&field[pos], &word, sizeof(Word));
+    }
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::close() {
+    output.close();
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::init() {
+    DiagnosticType::init();
+
+    Block *root = this;
+    while (root->getParent()) root = root->getParent().get();
+    fields.clear();
+    root->collectData(fields);
+
+    baseOptions = datasetParameters.getOptions();
+
+    // Small chunks, so that unchanged regions can be skipped, and the high
+    // bytes of the differences are mostly zero and compress well
+    deltaOptions = datasetParameters.getOptions(32);
+    deltaOptions.deflate = std::max(deltaOptions.deflate, 1);
+    deltaOptions.shuffle = true;
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::initParameters(BlockParameters &blockPars) {
+    DiagnosticType::initParameters(blockPars);
+    blockPars.addParameter("restart", &restartFile, std::string(""));
+    blockPars.addParameter("restartBase", &restartBase, std::string(""));
+    blockPars.addParameter("restartRanks", &restartRanks, 0);
+    blockPars.addParameter("incremental", &incremental, 0);
+    datasetParameters.initParameters(blockPars, false);
+  }
+
+  template<typename Type, class DiagnosticType>
+  std::vector<std::string> HDFCheckpoint<Type, DiagnosticType>::checkpointFiles(const std::string &fileName) {
+    std::vector<std::string> files;
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
+    files.push_back(fileName);
+#else
+    if (restartRanks > 0) {
+      // the files holding any of the owned cells of this process
+      std::vector<std::string> names;
+      std::vector<int> lo(Type::Rank, std::numeric_limits<int>::max());
+      std::vector<int> hi(Type::Rank, std::numeric_limits<int>::min());
+      for (std::pair<const std::string, Type *> &entry : fields) {
+        names.push_back(entry.first);
+        GridContainer<Type> container = getContainer(*entry.second);
+        for (size_t i = 0; i < Type::Rank; ++i) {
+          lo[i] = std::min(lo[i], int(container.local_min[i] - container.global_min[i]));
+          hi[i] = std::max(hi[i], int(container.local_max[i] - container.global_min[i]));
+        }
+      }
+
+      HdfPieceIndex index;
+      index.scan(fileName, restartRanks, names);
+      files = index.overlapping(lo, hi);
+    } else {
+      files.push_back(HdfPieceIndex::fileName(fileName, DiagnosticManager::instance().getRank()));
+    }
+#endif
+    SCHNEK_ASSERT(
+        !files.empty(), "No checkpoint file " << fileName << " holds the data of process "
+                                             << DiagnosticManager::instance().getRank()
+    );
+    return files;
+  }
+
+  template<typename Type, class DiagnosticType>
+  void HDFCheckpoint<Type, DiagnosticType>::readFields(const std::vector<std::string> &files, bool delta) {
+    std::map<std::string, bool> found;
+    for (const std::string &fileName : files) {
+      HdfIStream input;
+      input.open(fileName.c_str());
+      SCHNEK_ASSERT(input.good(), "Could not open checkpoint file " << fileName);
+
+      for (std::pair<const std::string, Type *> &entry : fields) {
+        if (!input.exists(entry.first)) continue;
+        found[entry.first] = true;
+        Type &field = *entry.second;
+        GridContainer<Type> container = getContainer(field);
+        input.setBlockName(entry.first);
+        if (!delta) {
+          input.readGrid(container);
+          continue;
+        }
+
+        // cells that are not read hold no difference
+        GridContainer<WordGrid> differences;
+        differences.grid.resize(field.getLo(), field.getHi());
+        differences.grid = Word(0);
+        differences.global_min = container.global_min;
+        differences.global_max = container.global_max;
+        differences.local_min = container.local_min;
+        differences.local_max = container.local_max;
+        input.readGrid(differences);
+
+        applyDifference(field, differences.grid);
+      }
+
+      input.close();
+    }
+
+    for (std::pair<const std::string, Type *> &entry : fields) {
+      SCHNEK_ASSERT(found[entry.first], "The checkpoint does not contain the field " << entry.first);
+    }
+  }
+
+  template<typename Type, class DiagnosticType>
+  bool HDFCheckpoint<Type, DiagnosticType>::restart() {
+    if (restartFile.empty()) return false;
+    waitForAsyncHdfOutput();
+
+    DiagnosticManager &manager = DiagnosticManager::instance();
+    std::vector<std::string> files = checkpointFiles(restartFile);
+
+    // all files of a checkpoint hold the same time and parameters
+    HdfIStream input;
+    input.open(files[0].c_str());
+    SCHNEK_ASSERT(input.good(), "Could not open checkpoint file " << files[0]);
+
+    int timeCounter = 0;
+    double physicalTime = 0.0;
+    int deltaBase = 0;
+    input.readAttribute("/", "timeCounter", timeCounter);
+    input.readAttribute("/", "physicalTime", physicalTime);
+    bool delta = input.readAttribute("/", "baseTimeCounter", deltaBase);
+
+    HdfParameterValues values;
+    values.collect(this->getVariables(), this->getLocalVariables());
+    std::vector<std::string> differing = values.compare(input, "parameters");
+    input.close();
+
+    if (manager.isMaster()) {
+      for (const std::string &name : differing)
+        std::cerr << "Warning: the parameter " << name << " differs from the checkpoint " << files[0] << std::endl;
+    }
+
+    if (delta) {
+      SCHNEK_ASSERT(!restartBase.empty(), "The checkpoint " << restartFile << " is incremental and needs restartBase");
+      std::vector<std::string> baseFiles = checkpointFiles(restartBase);
+
+      input.open(baseFiles[0].c_str());
+      int baseTime = -1;
+      input.readAttribute("/", "timeCounter", baseTime);
+      input.close();
+      SCHNEK_ASSERT(
+          baseTime == deltaBase,
+          "The checkpoint " << restartFile << " was written against the base at time step " << deltaBase
+                            << " but " << restartBase << " was written at time step " << baseTime
+      );
+
+      readFields(baseFiles, false);
+    }
+    readFields(files, delta);
+
+    manager.restoreTime(timeCounter, physicalTime);
+    return true;
   }
 
   //------------------------------------------------------------------------------
   // HDFGridReader
   //------------------------------------------------------------------------------
 
+  template<typename Type>
+  HDFGridReader<Type>::HDFGridReader() : inputRanks(0) {}
+
   template<typename Type>
   void HDFGridReader<Type>::init() {
     Block::init();
@@ -377,7 +1492,12 @@ namespace schnek {
 
   template<typename Type>
   void HDFGridReader<Type>::open() {
+    waitForAsyncHdfOutput();
+#if defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL)
     input.open(fileName.c_str());
+#else
+    input.open(HdfPieceIndex::fileName(fileName, DiagnosticManager::instance().getRank()).c_str());
+#endif
   }
 
   template<typename Type>
@@ -393,6 +1513,26 @@ namespace schnek {
 
   template<typename Type>
   void HDFGridReader<Type>::execute() {
+#if !(defined(H5_HAVE_PARALLEL) && defined(SCHNEK_USE_HDF_PARALLEL))
+    if (inputRanks > 0) {
+      std::vector<int> lo(Type::Rank), hi(Type::Rank);
+      for (size_t i = 0; i < Type::Rank; ++i) {
+        lo[i] = container.local_min[i] - container.global_min[i];
+        hi[i] = container.local_max[i] - container.global_min[i];
+      }
+
+      HdfPieceIndex index;
+      index.scan(fileName, inputRanks, std::vector<std::string>(1, this->getDatasetName()));
+
+      waitForAsyncHdfOutput();
+      for (const std::string &name : index.overlapping(lo, hi)) {
+        input.open(name.c_str());
+        read();
+        close();
+      }
+      return;
+    }
+#endif
     open();
     read();
     close();
@@ -404,6 +1544,7 @@ namespace schnek {
 
     blockPars.addParameter("file", &fileName);
     blockPars.addParameter("field", &fieldName);
+    blockPars.addParameter("inputRanks", &inputRanks, 0);
   }
 
 #undef LOGLEVEL
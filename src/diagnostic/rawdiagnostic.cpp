@@ -0,0 +1,191 @@
+/*
+ * rawdiagnostic.cpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "rawdiagnostic.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef SCHNEK_HAVE_POSIX_IO
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace schnek;
+
+#ifdef SCHNEK_HAVE_POSIX_IO
+
+RawOStream::RawOStream() : mapped(false), fd(-1), mapping(nullptr), mappingSize(0) {}
+
+RawOStream::~RawOStream() {
+  close();
+}
+
+void RawOStream::open(const std::string &fileName_, size_t fileSize) {
+  close();
+  fileName = fileName_;
+
+  // No O_TRUNC, other processes may already be writing into the file
+  fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) throw std::runtime_error("Could not open raw data file " + fileName);
+
+  // All processes set the same size, so the order does not matter
+  if (::ftruncate(fd, fileSize) != 0) throw std::runtime_error("Could not resize raw data file " + fileName);
+
+  if (mapped && fileSize > 0) {
+    void *ptr = ::mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) throw std::runtime_error("Could not map raw data file " + fileName);
+    mapping = static_cast<char *>(ptr);
+    mappingSize = fileSize;
+  }
+}
+
+void RawOStream::write(size_t offset, const void *data, size_t bytes) {
+  if (mapping) {
+    std::memcpy(mapping + offset, data, bytes);
+    return;
+  }
+
+  const char *ptr = static_cast<const char *>(data);
+  while (bytes > 0) {
+    ssize_t written = ::pwrite(fd, ptr, bytes, offset);
+    if (written <= 0) throw std::runtime_error("Could not write to raw data file " + fileName);
+    ptr += written;
+    offset += written;
+    bytes -= written;
+  }
+}
+
+void RawOStream::close() {
+  if (mapping) {
+    ::munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+  }
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+#else
+
+RawOStream::RawOStream() : mapped(false) {}
+
+RawOStream::~RawOStream() {
+  close();
+}
+
+void RawOStream::open(const std::string &fileName_, size_t fileSize) {
+  close();
+  fileName = fileName_;
+
+  // Create the file without truncating it if it exists
+  stream.open(fileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  if (!stream.is_open()) {
+    stream.clear();
+    stream.open(fileName.c_str(), std::ios::out | std::ios::binary);
+    stream.close();
+    stream.open(fileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  }
+  if (!stream.is_open()) throw std::runtime_error("Could not open raw data file " + fileName);
+
+  // Extend the file by writing its last byte
+  if (fileSize > 0) {
+    stream.seekg(0, std::ios::end);
+    if (size_t(stream.tellg()) < fileSize) {
+      stream.seekp(fileSize - 1);
+      stream.put(0);
+    }
+  }
+}
+
+void RawOStream::write(size_t offset, const void *data, size_t bytes) {
+  stream.seekp(offset);
+  stream.write(static_cast<const char *>(data), bytes);
+  if (!stream) throw std::runtime_error("Could not write to raw data file " + fileName);
+}
+
+void RawOStream::close() {
+  if (stream.is_open()) stream.close();
+}
+
+#endif
+
+void schnek::writeXdmfSidecar(
+    const std::string &xdmfName,
+    const std::string &dataName,
+    const std::string &attributeName,
+    const std::vector<long> &dims,
+    const std::vector<long> &origin,
+    const char *numberType,
+    int precision,
+    double time
+) {
+  // Data of rank one is shown on a mesh with a single row
+  std::vector<long> meshDims(dims), meshOrigin(origin);
+  if (meshDims.size() == 1) {
+    meshDims.insert(meshDims.begin(), 1);
+    meshOrigin.insert(meshOrigin.begin(), 0);
+  }
+  size_t meshRank = meshDims.size();
+  if (meshRank > 3) return;
+
+  std::ofstream xdmf(xdmfName.c_str());
+  if (!xdmf) throw std::runtime_error("Could not write XDMF file " + xdmfName);
+
+  auto list = [](std::ostream &out, const std::vector<long> &values) {
+    for (size_t i = 0; i < values.size(); ++i) out << (i > 0 ? " " : "") << values[i];
+  };
+
+  xdmf.precision(14);
+  xdmf << "<?xml version=\"1.0\" ?>\n"
+       << "<Xdmf Version=\"3.0\">\n"
+       << "  <Domain>\n"
+       << "    <Grid Name=\"" << attributeName << "\" GridType=\"Uniform\">\n"
+       << "      <Time Value=\"" << time << "\"/>\n"
+       << "      <Topology TopologyType=\"" << meshRank << "DCoRectMesh\" Dimensions=\"";
+  list(xdmf, meshDims);
+  xdmf << "\"/>\n"
+       << "      <Geometry GeometryType=\"" << (meshRank == 3 ? "ORIGIN_DXDYDZ" : "ORIGIN_DXDY") << "\">\n"
+       << "        <DataItem Format=\"XML\" Dimensions=\"" << meshRank << "\">";
+  list(xdmf, meshOrigin);
+  xdmf << "</DataItem>\n"
+       << "        <DataItem Format=\"XML\" Dimensions=\"" << meshRank << "\">";
+  list(xdmf, std::vector<long>(meshRank, 1));
+  xdmf << "</DataItem>\n"
+       << "      </Geometry>\n"
+       << "      <Attribute Name=\"" << attributeName << "\" AttributeType=\"Scalar\" Center=\"Node\">\n"
+       << "        <DataItem Format=\"Binary\" NumberType=\"" << numberType << "\" Precision=\"" << precision
+       << "\" Endian=\"Native\" Dimensions=\"";
+  list(xdmf, meshDims);
+  xdmf << "\">" << dataName << "</DataItem>\n"
+       << "      </Attribute>\n"
+       << "    </Grid>\n"
+       << "  </Domain>\n"
+       << "</Xdmf>\n";
+}
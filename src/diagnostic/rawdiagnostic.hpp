@@ -0,0 +1,183 @@
+/*
+ * rawdiagnostic.hpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHNEK_DIAGNOSTIC_RAWDIAGNOSTIC_HPP_
+#define SCHNEK_DIAGNOSTIC_RAWDIAGNOSTIC_HPP_
+
+#include "../config.hpp"
+
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "diagnostic.hpp"
+#include "gridcontainer.hpp"
+
+namespace schnek {
+
+  /**
+   * The XDMF number type and precision of a C++ type
+   */
+  template<typename T>
+  struct XdmfNumberType {
+      static const char *name() {
+        if (std::is_floating_point<T>::value) return "Float";
+        if (sizeof(T) == 1) return std::is_signed<T>::value ? "Char" : "UChar";
+        return std::is_signed<T>::value ? "Int" : "UInt";
+      }
+      static int precision() { return sizeof(T); }
+  };
+
+  /**
+   * @brief Random access output into a binary file shared by several processes
+   *
+   * The file is never truncated when it is opened, so that all processes can
+   * open the same file and write into disjoint parts of it. With POSIX I/O the
+   * data is written with `pwrite` or, if mapping is enabled, copied into a
+   * shared memory mapping of the file. Otherwise a std::fstream is used.
+   */
+  class RawOStream {
+    private:
+      std::string fileName;
+      bool mapped;
+#ifdef SCHNEK_HAVE_POSIX_IO
+      int fd;
+      char *mapping;
+      size_t mappingSize;
+#else
+      std::fstream stream;
+#endif
+
+    public:
+      RawOStream();
+      ~RawOStream();
+
+      /// Write through a memory mapping of the file instead of `pwrite`
+      void setMapped(bool mapped_) { mapped = mapped_; }
+
+      /**
+       * Open the file and make sure it has the given size
+       *
+       * Data already in the file is kept. Throws a std::runtime_error if the
+       * file cannot be opened.
+       */
+      void open(const std::string &fileName, size_t fileSize);
+
+      /// Write a block of bytes at the given offset from the start of the file
+      void write(size_t offset, const void *data, size_t bytes);
+
+      /// Close the file, this also removes the mapping
+      void close();
+  };
+
+  /**
+   * @brief Write an XDMF file describing a raw binary file
+   *
+   * The data is described as an attribute on a uniform rectilinear mesh with
+   * unit spacing. The mesh is two-dimensional for data of rank one and two and
+   * three-dimensional for rank three.
+   *
+   * @param xdmfName       the name of the XDMF file
+   * @param dataName       the name of the binary file as referenced from the XDMF file
+   * @param attributeName  the name of the attribute
+   * @param dims           the dimensions of the data, the slowest varying first
+   * @param origin         the index coordinates of the first cell in the same order
+   * @param numberType     the XDMF number type, see XdmfNumberType
+   * @param precision      the size of a single value in bytes
+   * @param time           the time of the output
+   */
+  void writeXdmfSidecar(
+      const std::string &xdmfName,
+      const std::string &dataName,
+      const std::string &attributeName,
+      const std::vector<long> &dims,
+      const std::vector<long> &origin,
+      const char *numberType,
+      int precision,
+      double time
+  );
+
+  /**
+   * Abstract diagnostic class for writing Grids into raw binary files
+   *
+   * All processes write their inner region into a single file holding the
+   * values between the global minimum and maximum in C order, i.e. the last
+   * index varying fastest. Every process writes directly at the offset of its
+   * data, so no communication is needed. Contiguous runs of values are
+   * collected in a buffer and written with a single call. With the `mmap`
+   * parameter set, the file is memory mapped instead.
+   *
+   * The process holding the global minimum also writes an XDMF file with the
+   * name of the output file and the extension `.xdmf`. It allows reading the
+   * data for ranks up to three with ParaView or VisIt. The coordinates are
+   * index coordinates.
+   *
+   * The values are stored with the native byte order and the value type of the
+   * grid. No HDF5 library is needed.
+   */
+  template<typename Type, class DiagnosticType = IntervalDiagnostic>
+  class RawGridDiagnostic : public SimpleDiagnostic<Type, Type, DiagnosticType> {
+    public:
+      typedef typename Type::IndexType IndexType;
+      typedef typename Type::value_type value_type;
+
+    protected:
+      RawOStream output;
+      GridContainer<Type> container;
+      std::string currentFile;
+
+      /// Parameter: write through a memory mapping of the file
+      int useMmap;
+
+    protected:
+      /// Open the output file
+      void open(const std::string &);
+      /// Write into the output file
+      void write();
+      /// Close the output file
+      void close();
+
+      /// Block inititialisation
+      void init();
+      /// Block callback to initialise the parameters
+      void initParameters(BlockParameters &blockPars);
+      /// Get the global minimum of the simulation bounds
+      virtual IndexType getGlobalMin() = 0;
+      /// Get the global maximum of the simulation bounds
+      virtual IndexType getGlobalMax() = 0;
+
+    private:
+      void writeSidecar();
+
+    public:
+      RawGridDiagnostic() : useMmap(0) {}
+  };
+
+}  // namespace schnek
+
+#include "rawdiagnostic.t"
+
+#endif  // SCHNEK_DIAGNOSTIC_RAWDIAGNOSTIC_HPP_
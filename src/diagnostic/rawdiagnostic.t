@@ -0,0 +1,145 @@
+/*
+ * rawdiagnostic.t
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "../grid/iteration/range-iteration.hpp"
+
+namespace schnek {
+
+  template<typename Type, class DiagnosticType>
+  void RawGridDiagnostic<Type, DiagnosticType>::open(const std::string &fname) {
+    size_t count = 1;
+    for (size_t i = 0; i < Type::Rank; ++i) count *= container.global_max[i] - container.global_min[i] + 1;
+
+    currentFile = fname;
+    output.setMapped(bool(useMmap));
+    output.open(fname, count * sizeof(value_type));
+  }
+
+  template<typename Type, class DiagnosticType>
+  void RawGridDiagnostic<Type, DiagnosticType>::write() {
+    static const size_t rank = Type::Rank;
+    static const size_t maxBuffer = (size_t(1) << 22) / sizeof(value_type);
+
+    IndexType lo, hi;
+    size_t fileStride[rank];
+    size_t stride = 1;
+    bool empty = false;
+    for (int i = rank - 1; i >= 0; --i) {
+      lo[i] = std::max(container.local_min[i], container.global_min[i]);
+      hi[i] = std::min(container.local_max[i], container.global_max[i]);
+      empty = empty || (lo[i] > hi[i]);
+      fileStride[i] = stride;
+      stride *= container.global_max[i] - container.global_min[i] + 1;
+    }
+
+    if (!empty) {
+      std::vector<value_type> buffer;
+      buffer.reserve(std::min(maxBuffer, stride));
+      size_t bufferStart = 0;
+
+      auto flush = [&]() {
+        if (buffer.empty()) return;
+        output.write(bufferStart * sizeof(value_type), buffer.data(), buffer.size() * sizeof(value_type));
+        buffer.clear();
+      };
+
+      // iterate over the lines along the last dimension, which are contiguous in the file
+      IndexType lineHi = hi;
+      lineHi[rank - 1] = lo[rank - 1];
+      typename Type::RangeType lines(lo, lineHi);
+      Type &grid = container.grid;
+
+      RangeCIterationPolicy<rank>::forEach(lines, [&](const IndexType &start) {
+        size_t offset = 0;
+        for (size_t i = 0; i < rank; ++i) offset += (start[i] - container.global_min[i]) * fileStride[i];
+
+        if ((offset != bufferStart + buffer.size()) || (buffer.size() >= maxBuffer)) {
+          flush();
+          bufferStart = offset;
+        }
+
+        IndexType pos = start;
+        for (pos[rank - 1] = lo[rank - 1]; pos[rank - 1] <= hi[rank - 1]; ++pos[rank - 1])
+          buffer.push_back(grid[pos]);
+      });
+      flush();
+    }
+
+    bool holdsOrigin = true;
+    for (size_t i = 0; i < rank; ++i)
+      holdsOrigin = holdsOrigin && (container.local_min[i] <= container.global_min[i])
+                    && (container.global_min[i] <= container.local_max[i]);
+    if (holdsOrigin) writeSidecar();
+  }
+
+  template<typename Type, class DiagnosticType>
+  void RawGridDiagnostic<Type, DiagnosticType>::close() {
+    output.close();
+  }
+
+  template<typename Type, class DiagnosticType>
+  void RawGridDiagnostic<Type, DiagnosticType>::writeSidecar() {
+    std::vector<long> dims, origin;
+    for (size_t i = 0; i < Type::Rank; ++i) {
+      dims.push_back(container.global_max[i] - container.global_min[i] + 1);
+      origin.push_back(container.global_min[i]);
+    }
+
+    std::string::size_type slash = currentFile.find_last_of('/');
+    std::string dataName = (slash == std::string::npos) ? currentFile : currentFile.substr(slash + 1);
+
+    writeXdmfSidecar(
+        currentFile + ".xdmf",
+        dataName,
+        this->getFieldName(),
+        dims,
+        origin,
+        XdmfNumberType<value_type>::name(),
+        XdmfNumberType<value_type>::precision(),
+        this->outputTime
+    );
+  }
+
+  template<typename Type, class DiagnosticType>
+  void RawGridDiagnostic<Type, DiagnosticType>::init() {
+    SimpleDiagnostic<Type, Type, DiagnosticType>::init();
+
+    if (!this->isDerived()) {
+      CopyToContainer<Type>::copy(this->field, container);
+      container.global_min = this->getGlobalMin();
+      container.global_max = this->getGlobalMax();
+    }
+  }
+
+  template<typename Type, class DiagnosticType>
+  void RawGridDiagnostic<Type, DiagnosticType>::initParameters(BlockParameters &blockPars) {
+    SimpleDiagnostic<Type, Type, DiagnosticType>::initParameters(blockPars);
+    blockPars.addParameter("mmap", &useMmap, 0);
+  }
+
+}  // namespace schnek
@@ -0,0 +1,321 @@
+/*
+ * shmdiagnostic.cpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "shmdiagnostic.hpp"
+
+#ifdef SCHNEK_HAVE_POSIX_IO
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "../util/exceptions.hpp"
+
+using namespace schnek;
+
+namespace {
+
+  const uint32_t ringMagic = 0x52484353;  // "SCHR"
+  const uint32_t ringVersion = 1;
+
+  /// The start of the shared memory object
+  struct RingHeader {
+      std::atomic<uint32_t> magic;
+      uint32_t version;
+      uint64_t slotCount;
+      uint64_t slotSize;
+      /// The sequence number of the next snapshot to be published, only changed by the producer
+      std::atomic<uint64_t> head;
+      /// The sequence number of the next snapshot to be read
+      std::atomic<uint64_t> tail;
+      std::atomic<uint64_t> dropped;
+      std::atomic<uint32_t> finished;
+  };
+
+  /// The start of every slot
+  struct SlotHeader {
+      /// Odd while the producer writes into the slot
+      std::atomic<uint64_t> version;
+      std::atomic<uint64_t> sequence;
+      std::atomic<uint64_t> size;
+  };
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory ring buffers need lock free atomics");
+
+  const size_t alignment = 64;
+  const size_t headerBytes = ((sizeof(RingHeader) + alignment - 1) / alignment) * alignment;
+  const size_t slotHeaderBytes = ((sizeof(SlotHeader) + alignment - 1) / alignment) * alignment;
+
+  size_t slotStride(size_t slotSize) {
+    return slotHeaderBytes + ((slotSize + alignment - 1) / alignment) * alignment;
+  }
+
+  std::string shmName(const std::string &name) {
+    return (!name.empty() && name[0] == '/') ? name : "/" + name;
+  }
+
+  RingHeader &ringHeader(char *mapping) {
+    return *reinterpret_cast<RingHeader *>(mapping);
+  }
+
+  SlotHeader &slotHeader(char *mapping, uint64_t sequence) {
+    RingHeader &header = ringHeader(mapping);
+    size_t index = sequence % header.slotCount;
+    return *reinterpret_cast<SlotHeader *>(mapping + headerBytes + index * slotStride(header.slotSize));
+  }
+
+}  // namespace
+
+ShmRingPolicy schnek::parseShmRingPolicy(const std::string &name) {
+  if (name == "drop") return ShmRingPolicy::Drop;
+  if (name == "overwrite") return ShmRingPolicy::Overwrite;
+  SCHNEK_ASSERT(name == "coalesce", "Unknown ring buffer policy " << name << ", expected drop, overwrite or coalesce");
+  return ShmRingPolicy::Coalesce;
+}
+
+// ----------------------------------------------------------------------
+
+ShmRingWriter::ShmRingWriter()
+    : fd(-1),
+      mapping(nullptr),
+      mappingSize(0),
+      slotCount(0),
+      slotSize(0),
+      policy(ShmRingPolicy::Drop),
+      pending(0),
+      pendingSlot(nullptr),
+      coalescing(false) {}
+
+ShmRingWriter::~ShmRingWriter() {
+  close();
+}
+
+void ShmRingWriter::open(const std::string &name_, size_t slotCount_, size_t slotSize_) {
+  close();
+  name = shmName(name_);
+  slotCount = slotCount_;
+  slotSize = slotSize_;
+  mappingSize = headerBytes + slotCount * slotStride(slotSize);
+
+  fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+  if (fd < 0) throw std::runtime_error("Could not create shared memory " + name);
+  if (::ftruncate(fd, mappingSize) != 0) throw std::runtime_error("Could not resize shared memory " + name);
+
+  void *ptr = ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (ptr == MAP_FAILED) throw std::runtime_error("Could not map shared memory " + name);
+  mapping = static_cast<char *>(ptr);
+
+  // Consumers only attach once the magic number has been set
+  RingHeader &header = ringHeader(mapping);
+  header.magic.store(0, std::memory_order_relaxed);
+  header.version = ringVersion;
+  header.slotCount = slotCount;
+  header.slotSize = slotSize;
+  header.head.store(0, std::memory_order_relaxed);
+  header.tail.store(0, std::memory_order_relaxed);
+  header.dropped.store(0, std::memory_order_relaxed);
+  header.finished.store(0, std::memory_order_relaxed);
+  for (size_t i = 0; i < slotCount; ++i) {
+    SlotHeader &slot = slotHeader(mapping, i);
+    slot.version.store(0, std::memory_order_relaxed);
+    slot.sequence.store(0, std::memory_order_relaxed);
+    slot.size.store(0, std::memory_order_relaxed);
+  }
+  header.magic.store(ringMagic, std::memory_order_release);
+}
+
+void *ShmRingWriter::beginWrite(size_t bytes) {
+  if (!mapping) return nullptr;
+  RingHeader &header = ringHeader(mapping);
+
+  if (bytes > slotSize) {
+    header.dropped.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  uint64_t head = header.head.load(std::memory_order_relaxed);
+  uint64_t tail = header.tail.load(std::memory_order_acquire);
+
+  pending = head;
+  coalescing = false;
+  if (head - tail >= slotCount) {
+    switch (policy) {
+      case ShmRingPolicy::Drop:
+        header.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      case ShmRingPolicy::Overwrite: {
+        // the consumer might have moved on in the meantime
+        uint64_t oldest = head - slotCount;
+        header.tail.compare_exchange_strong(oldest, oldest + 1, std::memory_order_acq_rel);
+        break;
+      }
+      case ShmRingPolicy::Coalesce:
+        pending = head - 1;
+        coalescing = true;
+        break;
+    }
+    header.dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  SlotHeader &slot = slotHeader(mapping, pending);
+  slot.version.fetch_add(1, std::memory_order_acq_rel);
+  std::atomic_thread_fence(std::memory_order_release);
+  pendingSlot = reinterpret_cast<char *>(&slot) + slotHeaderBytes;
+  return pendingSlot;
+}
+
+void ShmRingWriter::commit(size_t bytes) {
+  if (!pendingSlot) return;
+  RingHeader &header = ringHeader(mapping);
+  SlotHeader &slot = slotHeader(mapping, pending);
+
+  slot.sequence.store(pending, std::memory_order_relaxed);
+  slot.size.store(bytes, std::memory_order_relaxed);
+  slot.version.fetch_add(1, std::memory_order_release);
+  if (!coalescing) header.head.store(pending + 1, std::memory_order_release);
+  pendingSlot = nullptr;
+}
+
+uint64_t ShmRingWriter::getDropped() const {
+  return mapping ? ringHeader(mapping).dropped.load(std::memory_order_relaxed) : 0;
+}
+
+void ShmRingWriter::close() {
+  if (mapping) {
+    ringHeader(mapping).finished.store(1, std::memory_order_release);
+    ::munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+    // Attached consumers keep their mapping
+    ::shm_unlink(name.c_str());
+  }
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+  pendingSlot = nullptr;
+}
+
+// ----------------------------------------------------------------------
+
+ShmRingReader::ShmRingReader() : fd(-1), mapping(nullptr), mappingSize(0), lastSequence(0) {}
+
+ShmRingReader::~ShmRingReader() {
+  close();
+}
+
+bool ShmRingReader::open(const std::string &name) {
+  close();
+  std::string objectName = shmName(name);
+
+  fd = ::shm_open(objectName.c_str(), O_RDWR, 0);
+  if (fd < 0) return false;
+
+  struct stat info;
+  if ((::fstat(fd, &info) != 0) || (size_t(info.st_size) < headerBytes)) {
+    close();
+    return false;
+  }
+
+  void *ptr = ::mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (ptr == MAP_FAILED) {
+    close();
+    return false;
+  }
+  mapping = static_cast<char *>(ptr);
+  mappingSize = info.st_size;
+
+  RingHeader &header = ringHeader(mapping);
+  if ((header.magic.load(std::memory_order_acquire) != ringMagic) || (header.version != ringVersion)
+      || (headerBytes + header.slotCount * slotStride(header.slotSize) > mappingSize)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool ShmRingReader::next(std::vector<char> &snapshot) {
+  if (!mapping) return false;
+  RingHeader &header = ringHeader(mapping);
+
+  while (true) {
+    uint64_t tail = header.tail.load(std::memory_order_acquire);
+    uint64_t head = header.head.load(std::memory_order_acquire);
+    if (tail >= head) return false;
+
+    SlotHeader &slot = slotHeader(mapping, tail);
+    uint64_t version = slot.version.load(std::memory_order_acquire);
+    if (version & 1) {
+      // the producer is writing into the slot and does not block
+      std::this_thread::yield();
+      continue;
+    }
+
+    // the slot has been overwritten and the producer has moved the tail
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    if (sequence != tail) continue;
+
+    size_t size = std::min<size_t>(slot.size.load(std::memory_order_relaxed), header.slotSize);
+    snapshot.resize(size);
+    std::memcpy(snapshot.data(), reinterpret_cast<char *>(&slot) + slotHeaderBytes, size);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != version) continue;
+
+    // the copy is consistent even if the producer has moved the tail past it
+    header.tail.compare_exchange_strong(tail, sequence + 1, std::memory_order_acq_rel);
+    lastSequence = sequence;
+    return true;
+  }
+}
+
+uint64_t ShmRingReader::getDropped() const {
+  return mapping ? ringHeader(mapping).dropped.load(std::memory_order_relaxed) : 0;
+}
+
+bool ShmRingReader::finished() const {
+  return mapping && ringHeader(mapping).finished.load(std::memory_order_acquire);
+}
+
+void ShmRingReader::close() {
+  if (mapping) {
+    ::munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+  }
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+#endif
@@ -0,0 +1,261 @@
+/*
+ * shmdiagnostic.hpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHNEK_DIAGNOSTIC_SHMDIAGNOSTIC_HPP_
+#define SCHNEK_DIAGNOSTIC_SHMDIAGNOSTIC_HPP_
+
+#include "../config.hpp"
+#ifdef SCHNEK_HAVE_POSIX_IO
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "diagnostic.hpp"
+#include "gridcontainer.hpp"
+
+namespace schnek {
+
+  /// What a ring buffer does with a new snapshot when the consumer has not read the older ones
+  enum class ShmRingPolicy {
+    /// Discard the new snapshot
+    Drop,
+    /// Replace the oldest unread snapshot
+    Overwrite,
+    /// Replace the newest unread snapshot, so that the latest state is always available
+    Coalesce
+  };
+
+  /// Parse the name of a ring buffer policy: drop, overwrite or coalesce
+  ShmRingPolicy parseShmRingPolicy(const std::string &name);
+
+  /**
+   * @brief The producer side of a ring buffer of snapshots in POSIX shared memory
+   *
+   * The ring buffer connects a single producer with a single consumer on the
+   * same node, see ShmRingReader. The producer never waits for the consumer.
+   * When all slots hold unread snapshots, a new snapshot is dropped or replaces
+   * an unread one according to the ShmRingPolicy. The number of lost snapshots
+   * is counted in the shared memory.
+   *
+   * Each slot is protected by a sequence lock. The consumer copies a snapshot
+   * out of the slot and retries if the producer has written into the slot in
+   * the meantime.
+   */
+  class ShmRingWriter {
+    private:
+      std::string name;
+      int fd;
+      char *mapping;
+      size_t mappingSize;
+      size_t slotCount;
+      size_t slotSize;
+      ShmRingPolicy policy;
+      /// The sequence number and the slot of the snapshot being written
+      uint64_t pending;
+      char *pendingSlot;
+      bool coalescing;
+
+    public:
+      ShmRingWriter();
+      ~ShmRingWriter();
+
+      ShmRingWriter(const ShmRingWriter &) = delete;
+      ShmRingWriter &operator=(const ShmRingWriter &) = delete;
+
+      /**
+       * Create the shared memory object and initialise the ring buffer
+       *
+       * An existing object with the same name is reused and reset. Throws a
+       * std::runtime_error if the object cannot be created.
+       *
+       * @param name       the name of the shared memory object, a leading `/` is added if missing
+       * @param slotCount  the number of snapshots the ring can hold
+       * @param slotSize   the maximum size of a snapshot in bytes
+       */
+      void open(const std::string &name, size_t slotCount, size_t slotSize);
+
+      bool isOpen() const { return mapping != nullptr; }
+      const std::string &getName() const { return name; }
+      size_t getSlotSize() const { return slotSize; }
+
+      void setPolicy(ShmRingPolicy policy_) { policy = policy_; }
+
+      /**
+       * Reserve a slot for a snapshot of the given size
+       *
+       * @return  the memory into which the snapshot is written or nullptr if
+       *          the snapshot is dropped
+       */
+      void *beginWrite(size_t bytes);
+
+      /// Publish the snapshot written into the slot returned by beginWrite
+      void commit(size_t bytes);
+
+      /// The number of snapshots that have been dropped or replaced before they were read
+      uint64_t getDropped() const;
+
+      /// Mark the ring as finished, unmap and remove the shared memory object
+      void close();
+  };
+
+  /**
+   * @brief The consumer side of a ring buffer written by ShmRingWriter
+   *
+   * The consumer attaches to the shared memory object by name and reads the
+   * snapshots in order at its own pace. Snapshots that the producer dropped or
+   * replaced are skipped.
+   */
+  class ShmRingReader {
+    private:
+      int fd;
+      char *mapping;
+      size_t mappingSize;
+      uint64_t lastSequence;
+
+    public:
+      ShmRingReader();
+      ~ShmRingReader();
+
+      ShmRingReader(const ShmRingReader &) = delete;
+      ShmRingReader &operator=(const ShmRingReader &) = delete;
+
+      /**
+       * Attach to a ring buffer
+       *
+       * @return  false if the producer has not created the ring buffer yet
+       */
+      bool open(const std::string &name);
+
+      bool isOpen() const { return mapping != nullptr; }
+
+      /**
+       * Copy the next unread snapshot and release its slot
+       *
+       * @return  false if there is no unread snapshot
+       */
+      bool next(std::vector<char> &snapshot);
+
+      /// The sequence number of the last snapshot returned by next
+      uint64_t getSequence() const { return lastSequence; }
+
+      /// The number of snapshots that have been dropped or replaced before they were read
+      uint64_t getDropped() const;
+
+      /// True when the producer has closed the ring, unread snapshots can still be read
+      bool finished() const;
+
+      void close();
+  };
+
+  /**
+   * The metadata at the start of every snapshot written by ShmGridDiagnostic
+   *
+   * The header is followed by the values of the region between lo and hi in
+   * C order, i.e. the last index varying fastest.
+   */
+  struct ShmSnapshotHeader {
+      static const int maxRank = 8;
+
+      /// The output time, the time step or the physical time
+      double time;
+      /// The rank of the grid
+      int32_t rank;
+      /// The size of a single value in bytes
+      int32_t valueSize;
+      /// The XDMF number type of the values, see XdmfNumberType
+      char numberType[8];
+      /// The name of the field
+      char field[64];
+      /// The region held by the snapshot, inclusive
+      int32_t lo[maxRank];
+      int32_t hi[maxRank];
+      /// The global extent of the simulation
+      int32_t globalMin[maxRank];
+      int32_t globalMax[maxRank];
+  };
+
+  /**
+   * Abstract diagnostic class streaming grids to an analysis process on the same node
+   *
+   * The inner region of the grid that lies within the global bounds is
+   * published, together with a ShmSnapshotHeader, into a ring buffer in POSIX
+   * shared memory. The `file` parameter is the name of the shared memory
+   * object. With `#p` in the name, every process writes into its own ring
+   * buffer. The name should not contain `#t`, the ring buffer is created at
+   * the first output and kept until the diagnostic is destroyed.
+   *
+   * The parameter `slots` sets the number of snapshots the ring buffer can hold
+   * and `policy` what happens if the consumer falls behind, see ShmRingPolicy.
+   * The simulation never waits for the consumer. Consumers read the snapshots
+   * with ShmRingReader.
+   */
+  template<typename Type, class DiagnosticType = IntervalDiagnostic>
+  class ShmGridDiagnostic : public SimpleDiagnostic<Type, Type, DiagnosticType> {
+    public:
+      typedef typename Type::IndexType IndexType;
+      typedef typename Type::value_type value_type;
+
+    protected:
+      ShmRingWriter ring;
+      GridContainer<Type> container;
+
+      /// Parameter: the number of snapshots in the ring buffer
+      int slots;
+      /// Parameter: the policy when the ring buffer is full
+      std::string policyName;
+
+    protected:
+      /// Create the ring buffer at the first output
+      void open(const std::string &);
+      /// Publish a snapshot
+      void write();
+      /// The ring buffer stays open between outputs
+      void close() {}
+
+      /// Block inititialisation
+      void init();
+      /// Block callback to initialise the parameters
+      void initParameters(BlockParameters &blockPars);
+      /// Get the global minimum of the simulation bounds
+      virtual IndexType getGlobalMin() = 0;
+      /// Get the global maximum of the simulation bounds
+      virtual IndexType getGlobalMax() = 0;
+
+    private:
+      /// The region that is published by this process
+      bool selectRegion(IndexType &lo, IndexType &hi);
+
+    public:
+      ShmGridDiagnostic() : slots(4) {}
+  };
+
+}  // namespace schnek
+
+#include "shmdiagnostic.t"
+
+#endif  // SCHNEK_HAVE_POSIX_IO
+
+#endif  // SCHNEK_DIAGNOSTIC_SHMDIAGNOSTIC_HPP_
@@ -0,0 +1,123 @@
+/*
+ * shmdiagnostic.t
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "../grid/iteration/range-iteration.hpp"
+#include "../util/exceptions.hpp"
+#include "rawdiagnostic.hpp"
+
+namespace schnek {
+
+  template<typename Type, class DiagnosticType>
+  bool ShmGridDiagnostic<Type, DiagnosticType>::selectRegion(IndexType &lo, IndexType &hi) {
+    bool empty = false;
+    for (size_t i = 0; i < Type::Rank; ++i) {
+      lo[i] = std::max(container.local_min[i], container.global_min[i]);
+      hi[i] = std::min(container.local_max[i], container.global_max[i]);
+      empty = empty || (lo[i] > hi[i]);
+    }
+    return !empty;
+  }
+
+  template<typename Type, class DiagnosticType>
+  void ShmGridDiagnostic<Type, DiagnosticType>::open(const std::string &name) {
+    if (ring.isOpen()) return;
+
+    IndexType lo, hi;
+    size_t count = 0;
+    if (selectRegion(lo, hi)) {
+      count = 1;
+      for (size_t i = 0; i < Type::Rank; ++i) count *= hi[i] - lo[i] + 1;
+    }
+
+    ring.setPolicy(parseShmRingPolicy(policyName));
+    ring.open(name, slots, sizeof(ShmSnapshotHeader) + count * sizeof(value_type));
+  }
+
+  template<typename Type, class DiagnosticType>
+  void ShmGridDiagnostic<Type, DiagnosticType>::write() {
+    static const size_t rank = Type::Rank;
+
+    IndexType lo, hi;
+    bool hasData = selectRegion(lo, hi);
+    size_t count = 0;
+    if (hasData) {
+      count = 1;
+      for (size_t i = 0; i < rank; ++i) count *= hi[i] - lo[i] + 1;
+    }
+
+    size_t bytes = sizeof(ShmSnapshotHeader) + count * sizeof(value_type);
+    char *slot = static_cast<char *>(ring.beginWrite(bytes));
+    if (!slot) return;
+
+    ShmSnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.time = this->outputTime;
+    header.rank = rank;
+    header.valueSize = sizeof(value_type);
+    std::strncpy(header.numberType, XdmfNumberType<value_type>::name(), sizeof(header.numberType) - 1);
+    std::strncpy(header.field, this->getFieldName().c_str(), sizeof(header.field) - 1);
+    for (size_t i = 0; i < rank; ++i) {
+      header.lo[i] = lo[i];
+      header.hi[i] = hasData ? hi[i] : lo[i] - 1;
+      header.globalMin[i] = container.global_min[i];
+      header.globalMax[i] = container.global_max[i];
+    }
+    std::memcpy(slot, &header, sizeof(header));
+
+    if (hasData) {
+      value_type *values = reinterpret_cast<value_type *>(slot + sizeof(header));
+      Type &grid = container.grid;
+      typename Type::RangeType region(lo, hi);
+      RangeCIterationPolicy<rank>::forEach(region, [&](const IndexType &pos) { *(values++) = grid[pos]; });
+    }
+
+    ring.commit(bytes);
+  }
+
+  template<typename Type, class DiagnosticType>
+  void ShmGridDiagnostic<Type, DiagnosticType>::init() {
+    static_assert(Type::Rank <= ShmSnapshotHeader::maxRank, "ShmGridDiagnostic: the rank of the grid is too large");
+    SimpleDiagnostic<Type, Type, DiagnosticType>::init();
+    SCHNEK_ASSERT(slots > 0, "ShmGridDiagnostic: the number of slots must be positive");
+
+    if (!this->isDerived()) {
+      CopyToContainer<Type>::copy(this->field, container);
+      container.global_min = this->getGlobalMin();
+      container.global_max = this->getGlobalMax();
+    }
+  }
+
+  template<typename Type, class DiagnosticType>
+  void ShmGridDiagnostic<Type, DiagnosticType>::initParameters(BlockParameters &blockPars) {
+    SimpleDiagnostic<Type, Type, DiagnosticType>::initParameters(blockPars);
+    blockPars.addParameter("slots", &slots, 4);
+    blockPars.addParameter("policy", &policyName, std::string("drop"));
+  }
+
+}  // namespace schnek
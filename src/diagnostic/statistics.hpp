@@ -0,0 +1,111 @@
+/*
+ * statistics.hpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHNEK_DIAGNOSTIC_STATISTICS_HPP_
+#define SCHNEK_DIAGNOSTIC_STATISTICS_HPP_
+
+#include <fstream>
+#include <vector>
+
+#include "../grid/domainsubdivision.hpp"
+#include "diagnostic.hpp"
+
+namespace schnek {
+
+  /**
+   * @brief A diagnostic that writes statistics of a field instead of the field itself
+   *
+   * At every output the minimum, maximum, mean and L2 norm of the inner cells of
+   * the field are calculated. The values of all processes are combined in a
+   * single call to DomainSubdivision::batchReduce and the master process appends
+   * one line to the output file. The first line of a new file is a header
+   * naming the columns.
+   *
+   * Setting `bins` to a positive number adds a histogram of the values. The
+   * histogram covers the interval from `histMin` to `histMax`. If `histMin` is
+   * not smaller than `histMax` the interval is adapted to the minimum and
+   * maximum of the field at every output, which needs a second reduction.
+   * Values outside the interval are counted in the first or the last bin.
+   *
+   * NaN values are left out of all the statistics and the histogram, the mean
+   * is taken over the remaining cells.
+   *
+   * The file name is not parsed, all outputs are appended to the same file.
+   */
+  template<class Type, class DiagnosticType = IntervalDiagnostic>
+  class FieldStatisticsDiagnostic : public SimpleDiagnostic<Type, Type *, DiagnosticType> {
+    public:
+      typedef typename Type::value_type value_type;
+
+    private:
+      /// The number of histogram bins, no histogram is calculated if zero
+      int bins;
+      /// The lower limit of the histogram
+      double histMin;
+      /// The upper limit of the histogram
+      double histMax;
+
+      std::ofstream output;
+
+    protected:
+      /// The global minimum of the last output
+      double minimum;
+      /// The global maximum of the last output
+      double maximum;
+      /// The global mean of the last output
+      double mean;
+      /// The L2 norm, i.e. the square root of the sum of squares, of the last output
+      double l2Norm;
+      /// The lower and upper limit of the histogram of the last output
+      double histLo, histHi;
+      /// The histogram counts of the last output
+      std::vector<double> histogram;
+
+    public:
+      FieldStatisticsDiagnostic() : bins(0), histMin(0.0), histMax(0.0) {}
+
+    protected:
+      void initParameters(BlockParameters &);
+
+      /// The files are opened by the master process in write()
+      void open(const std::string &) {}
+      void write();
+      void close() {}
+
+      /// The subdivision used to combine the values of all processes
+      virtual DomainSubdivision<Type> &getSubdivision() = 0;
+
+      /// Add the inner cells of the local field to the histogram with counts.size() bins between lo and hi
+      void fillHistogram(std::vector<double> &counts, double lo, double hi);
+
+    private:
+      void writeLine();
+  };
+
+}  // namespace schnek
+
+#include "statistics.t"
+
+#endif  // SCHNEK_DIAGNOSTIC_STATISTICS_HPP_
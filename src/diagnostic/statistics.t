@@ -0,0 +1,138 @@
+/*
+ * statistics.t
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../grid/iteration/range-iteration.hpp"
+
+namespace schnek {
+
+  template<class Type, class DiagnosticType>
+  void FieldStatisticsDiagnostic<Type, DiagnosticType>::initParameters(BlockParameters &blockPars) {
+    SimpleDiagnostic<Type, Type *, DiagnosticType>::initParameters(blockPars);
+    blockPars.addParameter("bins", &bins, 0);
+    blockPars.addParameter("histMin", &histMin, 0.0);
+    blockPars.addParameter("histMax", &histMax, 0.0);
+  }
+
+  template<class Type, class DiagnosticType>
+  void FieldStatisticsDiagnostic<Type, DiagnosticType>::fillHistogram(
+      std::vector<double> &counts, double lo, double hi
+  ) {
+    Type &f = *(this->field);
+    typename Type::RangeType inner(f.getInnerLo(), f.getInnerHi());
+    const int count = counts.size();
+    double scale = (hi > lo) ? count / (hi - lo) : 0.0;
+    RangeCIterationPolicy<Type::Rank>::forEach(inner, [&](const typename Type::IndexType &pos) {
+      double value = f[pos];
+      if (std::isnan(value)) return;
+      // the bin is clamped before the conversion, which is undefined for values that don't fit into an int
+      double bin = (scale > 0.0) ? std::floor((value - lo) * scale) : 0.0;
+      counts[int(std::min(std::max(bin, 0.0), double(count - 1)))] += 1.0;
+    });
+  }
+
+  template<class Type, class DiagnosticType>
+  void FieldStatisticsDiagnostic<Type, DiagnosticType>::write() {
+    Type &f = *(this->field);
+    DomainSubdivision<Type> &subdivision = getSubdivision();
+    typename Type::RangeType inner(f.getInnerLo(), f.getInnerHi());
+
+    bool adaptive = (bins > 0) && (histMin >= histMax);
+
+    // Layout: max, -min | sum, sum of squares, count, histogram
+    std::vector<double> values(5 + (adaptive ? 0 : std::max(bins, 0)), 0.0);
+    double &vMax = values[0];
+    double &vNegMin = values[1];
+    double &vSum = values[2];
+    double &vSumSq = values[3];
+    double &vCount = values[4];
+    vMax = -std::numeric_limits<double>::max();
+    vNegMin = -std::numeric_limits<double>::max();
+
+    RangeCIterationPolicy<Type::Rank>::forEach(inner, [&](const typename Type::IndexType &pos) {
+      double v = f[pos];
+      if (std::isnan(v)) return;
+      vMax = std::max(vMax, v);
+      vNegMin = std::max(vNegMin, -v);
+      vSum += v;
+      vSumSq += v * v;
+      vCount += 1.0;
+    });
+
+    if (bins > 0 && !adaptive) {
+      std::vector<double> counts(bins, 0.0);
+      fillHistogram(counts, histMin, histMax);
+      std::copy(counts.begin(), counts.end(), values.begin() + 5);
+    }
+
+    subdivision.batchReduce(values, 2);
+
+    maximum = values[0];
+    minimum = -values[1];
+    mean = (values[4] > 0.0) ? values[2] / values[4] : 0.0;
+    l2Norm = std::sqrt(values[3]);
+
+    if (bins > 0) {
+      if (adaptive) {
+        histLo = minimum;
+        histHi = maximum;
+        histogram.assign(bins, 0.0);
+        fillHistogram(histogram, histLo, histHi);
+        subdivision.batchReduce(histogram, 0);
+      } else {
+        histLo = histMin;
+        histHi = histMax;
+        histogram.assign(values.begin() + 5, values.end());
+      }
+    }
+
+    if (subdivision.master()) writeLine();
+  }
+
+  template<class Type, class DiagnosticType>
+  void FieldStatisticsDiagnostic<Type, DiagnosticType>::writeLine() {
+    if (!output.is_open()) {
+      output.open(this->fname.c_str(), std::ios::out | std::ios::app);
+      if (output.tellp() == 0) {
+        output << "# time min max mean l2";
+        if (bins > 0) output << " histLo histHi counts[" << bins << "]";
+        output << "\n";
+      }
+      output.precision(14);
+    }
+
+    output << this->outputTime << " " << minimum << " " << maximum << " " << mean << " " << l2Norm;
+    if (bins > 0) {
+      output << " " << histLo << " " << histHi;
+      for (double c : histogram) output << " " << c;
+    }
+    output << std::endl;
+  }
+
+}  // namespace schnek
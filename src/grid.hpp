@@ -34,5 +34,6 @@
 #include "grid/gridstorage.hpp"
 #include "grid/gridstorage/single-array-allocation.hpp"
 #include "grid/gridtransform.hpp"
+#include "grid/mpipatchsubdivision.hpp"
 #include "grid/mpisubdivision.hpp"
 #include "grid/range.hpp"
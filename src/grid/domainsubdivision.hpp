@@ -36,6 +36,7 @@
 #define SCHNEK_DOMAINSUBDIVISION_HPP
 
 #include <memory>
+#include <vector>
 
 #include "boundary.hpp"
 
@@ -182,6 +183,16 @@ namespace schnek {
       /// Return the minimum of a single value over all the processes
       virtual int minReduce(int) const = 0;
 
+      /** @brief Reduce several values over all the processes at once
+       *
+       *  The first maxCount values are replaced by their maximum and the remaining
+       *  values by their sum. Minima can be reduced as the maxima of the negated
+       *  values. Implementations should combine all values in a single message.
+       */
+      virtual void batchReduce(std::vector<double> &values, size_t maxCount) const {
+        for (size_t i = 0; i < values.size(); ++i) values[i] = (i < maxCount) ? maxReduce(values[i]) : sumReduce(values[i]);
+      }
+
       /// Return true if this is the master process and false otherwise
       virtual bool master() const = 0;
 
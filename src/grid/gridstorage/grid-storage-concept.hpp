@@ -147,6 +147,18 @@ namespace schnek {
 
   }  // namespace concepts
 
+  /**
+   * @brief The order in which the elements of a grid storage are laid out in memory
+   *
+   * The default is C order, where the last index varies fastest. Storages that
+   * place the first index fastest in memory specialise this trait and set
+   * `fortranOrder` to true.
+   */
+  template<class GridStorage>
+  struct GridStorageOrder {
+      static constexpr bool fortranOrder = false;
+  };
+
 }  // namespace schnek
 
 #endif  // SCHNEK_GRID_GRIDSTORAGE_GRID_STORAGE_CONCEPT_HPP_
@@ -38,6 +38,7 @@
 #include "../../macros.hpp"
 #include "../array.hpp"
 #include "../range.hpp"
+#include "grid-storage-concept.hpp"
 
 namespace schnek {
 
@@ -223,6 +224,14 @@ namespace schnek {
   template<typename T, size_t rank_t>
   using KokkosDefaultGridStorage = KokkosGridStorage<T, rank_t>;
 
+  /// Views with Kokkos::LayoutLeft store the first index fastest
+  template<typename T, size_t rank_t, class... ViewProperties>
+  struct GridStorageOrder<KokkosGridStorage<T, rank_t, ViewProperties...>> {
+      static constexpr bool fortranOrder = std::is_same<
+          typename Kokkos::View<typename internal::KokkosViewType<T, rank_t>::type, ViewProperties...>::array_layout,
+          Kokkos::LayoutLeft>::value;
+  };
+
   //=================================================================
   //==================== KokkosGridStorage ==========================
   //=================================================================
@@ -28,6 +28,7 @@
 #define SCHNEK_GRID_GRIDSTORAGE_SINGLESTORAGEBASE_HPP_
 
 #include "../array.hpp"
+#include "grid-storage-concept.hpp"
 
 namespace schnek {
   /**
@@ -282,6 +283,11 @@ namespace schnek {
       void updateDataFast();
   };
 
+  template<typename T, size_t rank, template<typename, size_t> class AllocationPolicy>
+  struct GridStorageOrder<SingleArrayGridFortranOrderStorageBase<T, rank, AllocationPolicy>> {
+      static constexpr bool fortranOrder = true;
+  };
+
   //=================================================================
   //================== SingleArrayGridStorageBase ===================
   //=================================================================
@@ -0,0 +1,271 @@
+/*
+ * mpipatchsubdivision.hpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/** @file mpipatchsubdivision.hpp
+ *  @brief Over-decomposition of the local domain into several patches per process
+ *
+ *  Each process owns a number of patches. Every patch has its own Boundary and
+ *  the user provides one grid per patch. Ghost cells are exchanged with
+ *  non-blocking communication and work on a patch can start as soon as
+ *  all its ghost cells have arrived.
+ */
+
+#ifndef SCHNEK_MPIPATCHSUBDIVISION_HPP
+#define SCHNEK_MPIPATCHSUBDIVISION_HPP
+
+#include "../config.hpp"
+#include "mpisubdivision.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace schnek {
+
+  /** @brief A rectangular patch of the local domain
+   *
+   *  A patch is the unit of work in an over-decomposed domain. It holds its own
+   *  Boundary object and knows the processes and local indices of its neighbours.
+   */
+  template<class GridType>
+  class DomainPatch {
+    public:
+      enum { Rank = GridType::Rank };
+
+      typedef typename GridType::IndexType LimitType;
+      typedef Range<int, Rank> DomainType;
+      typedef Boundary<Rank> BoundaryType;
+      typedef std::shared_ptr<BoundaryType> pBoundaryType;
+
+    private:
+      /// The index of the patch on the local process
+      int index;
+
+      /// The coordinates of the patch in the local patch grid
+      LimitType patchCoord;
+
+      /// The boundary of the patch including the ghost cells
+      pBoundaryType bounds;
+
+      /// The process ranks of the neighbouring patches, indexed by dimension and BoundaryType::bound
+      int neighbourRank[Rank][2];
+
+      /// The local indices of the neighbouring patches on their processes
+      int neighbourIndex[Rank][2];
+
+      template<class>
+      friend class MPIPatchSubdivision;
+
+    public:
+      /// Default constructor
+      DomainPatch() : index(0), patchCoord(0) {}
+
+      /// Return the index of the patch on the local process
+      int getIndex() const { return index; }
+
+      /// Return the coordinates of the patch in the local patch grid
+      const LimitType &getPatchCoord() const { return patchCoord; }
+
+      /// Return the boundary object of the patch
+      BoundaryType &getBoundary() { return *bounds; }
+
+      /// Return the number of ghost cells
+      int getDelta() { return bounds->getDelta(); }
+
+      /// Return the domain of the patch, including the ghost cells
+      const DomainType &getDomain() const { return bounds->getDomain(); }
+      /// Return the minimum of the patch domain
+      const LimitType &getLo() const { return bounds->getDomain().getLo(); }
+      /// Return the maximum of the patch domain
+      const LimitType &getHi() const { return bounds->getDomain().getHi(); }
+
+      /// Return the inner domain of the patch
+      DomainType getInnerDomain() const { return bounds->getInnerDomain(); }
+      /// Return the minimum of the inner domain of the patch
+      LimitType getInnerLo() const { return bounds->getInnerDomain().getLo(); }
+      /// Return the maximum of the inner domain of the patch
+      LimitType getInnerHi() const { return bounds->getInnerDomain().getHi(); }
+
+      /** Return the ghost domain on one side of the patch
+       *
+       * @param dim the dimension index of the side on which the ghost domain lies.
+       * @param b the location of the ghost domain.
+       */
+      DomainType getGhostDomain(size_t dim, typename BoundaryType::bound b) const {
+        return bounds->getGhostDomain(dim, b);
+      }
+
+      /// Return the process rank of the neighbour in direction dim
+      int getNeighbourRank(size_t dim, typename BoundaryType::bound b) const { return neighbourRank[dim][b]; }
+
+      /// Return the local index of the neighbour in direction dim on its process
+      int getNeighbourIndex(size_t dim, typename BoundaryType::bound b) const { return neighbourIndex[dim][b]; }
+
+      /** Return the inner physical extent of the patch
+       *
+       * @param globalExtent the physical extent of the global domain
+       * @param globalDomain the global grid domain excluding ghost cells
+       */
+      template<typename T, template<size_t> class CheckingPolicy>
+      Range<T, Rank, CheckingPolicy> getInnerExtent(
+          const Range<T, Rank, CheckingPolicy> &globalExtent, const DomainType &globalDomain
+      ) const {
+        typename Range<T, Rank, CheckingPolicy>::LimitType localDomainMin, localDomainMax;
+        LimitType innerLo = getInnerLo();
+        LimitType innerHi = getInnerHi();
+        for (size_t i = 0; i < Rank; ++i) {
+          const T &lo = globalExtent.getLo()[i];
+          T dx = (globalExtent.getHi()[i] - lo) / (T)(globalDomain.getHi()[i] - globalDomain.getLo()[i] + 1);
+          localDomainMin[i] = lo + innerLo[i] * dx;
+          localDomainMax[i] = lo + (innerHi[i] + 1) * dx;
+        }
+        return Range<T, Rank, CheckingPolicy>(localDomainMin, localDomainMax);
+      }
+  };
+
+#ifdef SCHNEK_HAVE_MPI
+
+  /** @brief A Cartesian MPI subdivision with several patches per process
+   *
+   *  The global domain is first split between the processes exactly like
+   *  MPICartSubdivision. The inner domain of each process is then split
+   *  further into a grid of patches. The subdivision still behaves like an
+   *  MPICartSubdivision for grids that cover the whole local domain.
+   *
+   *  Grids belonging to the patches are passed as a vector indexed by the patch
+   *  index. The exchange is carried out with non-blocking communication. The
+   *  ghost cells are filled dimension by dimension for each patch independently,
+   *  so that a patch never waits for a slow neighbour of another patch.
+   */
+  template<class GridType>
+  class MPIPatchSubdivision : public MPICartSubdivision<GridType> {
+    public:
+      typedef typename MPICartSubdivision<GridType>::LimitType LimitType;
+      typedef typename GridType::value_type value_type;
+      typedef typename MPICartSubdivision<GridType>::DomainType DomainType;
+      typedef typename MPICartSubdivision<GridType>::BoundaryType BoundaryType;
+      typedef DomainPatch<GridType> PatchType;
+      typedef std::vector<GridType> GridList;
+
+      enum { Rank = GridType::Rank };
+
+    private:
+      /// The number of patches requested per process
+      int patchCount;
+
+      /// The dimensions of the local patch grid
+      int patchDims[Rank];
+
+      /// The patches of the local process
+      std::vector<PatchType> patches;
+
+      /// Buffers for the outgoing data, indexed by patch, dimension and side
+      std::vector<std::vector<value_type> > sendBuffers;
+
+      /// Buffers for the incoming data, indexed by patch, dimension and side
+      std::vector<std::vector<value_type> > recvBuffers;
+
+      /// Return the index into the buffer arrays
+      int bufferIndex(int patch, size_t dim, int side) const { return (patch * Rank + dim) * 2 + side; }
+
+      /// The message tag for data arriving at the ghost cells of a patch
+      int messageTag(int patch, size_t dim, int side) const { return 1 + bufferIndex(patch, dim, side); }
+
+      /// Return the local patch index from the patch coordinates
+      int patchIndex(const LimitType &coord) const;
+
+      /// Create the patches after the process domain has been set up
+      void initPatches();
+
+      /// The counters for an exchange, exchanges within the process are counted separately
+      MPICommStatistics::Counters &statistics(int neighbourRank, size_t dim, int side) {
+        if (neighbourRank == this->ComRank) return this->commStatistics.local();
+        return this->commStatistics.neighbour(dim, side);
+      }
+
+      /** Start the non-blocking exchange for one patch in dimension dim
+       *
+       *  Packs the source domains into the send buffers and posts the sends
+       *  and receives.
+       */
+      void postExchange(
+          GridType &grid, int patch, size_t dim, std::vector<MPI_Request> &recvRequests,
+          std::vector<MPI_Request> &sendRequests
+      );
+
+      /// Unpack the received data into the ghost cells of one patch in dimension dim
+      void finishExchange(GridType &grid, int patch, size_t dim);
+
+    public:
+      using MPICartSubdivision<GridType>::init;
+      using MPICartSubdivision<GridType>::exchange;
+
+      /** Construct with the number of patches for each process
+       *
+       *  All processes must use the same number of patches.
+       */
+      MPIPatchSubdivision(int patchCount_ = 1);
+
+      /// Initialise the process domain and split it into patches
+      void init(const LimitType &low, const LimitType &high, int delta) override;
+
+      /// Return the number of patches on the local process
+      int getPatchCount() const { return patches.size(); }
+
+      /// Return the patch with a given local index
+      PatchType &getPatch(int i) { return patches[i]; }
+
+      /// Return all the patches on the local process
+      std::vector<PatchType> &getPatches() { return patches; }
+
+      /// Return the number of patches in dimension dim on the local process
+      int getPatchDims(size_t dim) const { return patchDims[dim]; }
+
+      /** @brief Exchange the ghost cells of all patches
+       *
+       *  grids[i] must be the grid belonging to patch i.
+       */
+      void exchange(GridList &grids);
+
+      /** @brief Exchange the ghost cells of all patches and run a task on each patch
+       *
+       *  The task is called with the patch index as soon as all the ghost cells
+       *  of that patch have been filled. Patches whose neighbours respond quickly
+       *  are processed first while the data for other patches is still in flight.
+       *
+       *  grids[i] must be the grid belonging to patch i. The task may modify the
+       *  grid of the patch it has been called for.
+       */
+      template<class Task>
+      void exchange(GridList &grids, Task task);
+  };
+
+#endif  // SCHNEK_HAVE_MPI
+
+}  // namespace schnek
+
+#include "mpipatchsubdivision.t"
+
+#endif  // SCHNEK_MPIPATCHSUBDIVISION_HPP
@@ -0,0 +1,247 @@
+/*
+ * mpipatchsubdivision.t
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef SCHNEK_HAVE_MPI
+
+#include "../util/exceptions.hpp"
+#include "../util/factor.hpp"
+
+namespace schnek {
+
+  /* **************************************************************
+   *                 MPIPatchSubdivision                          *
+   ****************************************************************/
+
+  template<class GridType>
+  MPIPatchSubdivision<GridType>::MPIPatchSubdivision(int patchCount_) : patchCount(patchCount_) {
+    SCHNEK_ASSERT(patchCount > 0, "MPIPatchSubdivision needs at least one patch per process");
+    for (size_t i = 0; i < Rank; ++i) patchDims[i] = 1;
+  }
+
+  template<class GridType>
+  void MPIPatchSubdivision<GridType>::init(const LimitType &lo, const LimitType &hi, int delta) {
+    MPICartSubdivision<GridType>::init(lo, hi, delta);
+    initPatches();
+  }
+
+  template<class GridType>
+  int MPIPatchSubdivision<GridType>::patchIndex(const LimitType &coord) const {
+    int index = coord[0];
+    for (size_t i = 1; i < Rank; ++i) index = patchDims[i] * index + coord[i];
+    return index;
+  }
+
+  template<class GridType>
+  void MPIPatchSubdivision<GridType>::initPatches() {
+    const DomainType &globalDomain = this->getGlobalDomain();
+    int delta = this->getDelta();
+
+    // The weights are the same on all processes so that all processes
+    // arrive at the same patch grid
+    std::vector<int> box(Rank);
+    for (size_t i = 0; i < Rank; ++i) {
+      box[i] = (globalDomain.getHi()[i] - globalDomain.getLo()[i]) / this->dims[i];
+    }
+
+    std::vector<int> eqDims;
+    equalFactors(patchCount, Rank, eqDims, box);
+    std::copy(eqDims.begin(), eqDims.end(), patchDims);
+
+    LimitType innerLo = this->getInnerLo();
+    LimitType innerHi = this->getInnerHi();
+
+    for (size_t i = 0; i < Rank; ++i) {
+      int width = innerHi[i] - innerLo[i] + 1;
+      SCHNEK_ASSERT(
+          width / patchDims[i] >= delta,
+          "Patches in dimension " << i << " are narrower than the number of ghost cells (" << width << " cells split into "
+                                  << patchDims[i] << " patches)"
+      );
+    }
+
+    patches.resize(patchCount);
+    sendBuffers.resize(patchCount * Rank * 2);
+    recvBuffers.resize(patchCount * Rank * 2);
+
+    DomainType patchGrid(LimitType(0), LimitType(0));
+    for (size_t i = 0; i < Rank; ++i) patchGrid.getHi()[i] = patchDims[i] - 1;
+
+    for (const LimitType &coord : patchGrid) {
+      int index = patchIndex(coord);
+      PatchType &patch = patches[index];
+      patch.index = index;
+      patch.patchCoord = coord;
+
+      LimitType low, high;
+      for (size_t i = 0; i < Rank; ++i) {
+        int width = innerHi[i] - innerLo[i] + 1;
+        low[i] = innerLo[i] + (width * coord[i]) / patchDims[i] - delta;
+        high[i] = innerLo[i] + (width * (coord[i] + 1)) / patchDims[i] - 1 + delta;
+      }
+      patch.bounds = std::make_shared<BoundaryType>(low, high, delta);
+
+      for (size_t i = 0; i < Rank; ++i) {
+        LimitType prev(coord);
+        LimitType next(coord);
+
+        if (coord[i] > 0) {
+          --prev[i];
+          patch.neighbourRank[i][BoundaryType::Min] = this->ComRank;
+        } else {
+          prev[i] = patchDims[i] - 1;
+          patch.neighbourRank[i][BoundaryType::Min] = this->prevcoord[i];
+        }
+
+        if (coord[i] < patchDims[i] - 1) {
+          ++next[i];
+          patch.neighbourRank[i][BoundaryType::Max] = this->ComRank;
+        } else {
+          next[i] = 0;
+          patch.neighbourRank[i][BoundaryType::Max] = this->nextcoord[i];
+        }
+
+        patch.neighbourIndex[i][BoundaryType::Min] = patchIndex(prev);
+        patch.neighbourIndex[i][BoundaryType::Max] = patchIndex(next);
+
+        for (int side = 0; side < 2; ++side) {
+          DomainType ghost = patch.bounds->getGhostDomain(i, typename BoundaryType::bound(side));
+          int size = 1;
+          for (size_t j = 0; j < Rank; ++j) size *= ghost.getHi()[j] - ghost.getLo()[j] + 1;
+          sendBuffers[bufferIndex(index, i, side)].resize(size);
+          recvBuffers[bufferIndex(index, i, side)].resize(size);
+        }
+      }
+    }
+  }
+
+  template<class GridType>
+  void MPIPatchSubdivision<GridType>::postExchange(
+      GridType &grid, int patch, size_t dim, std::vector<MPI_Request> &recvRequests,
+      std::vector<MPI_Request> &sendRequests
+  ) {
+    PatchType &p = patches[patch];
+    MPI_Datatype mpiType = MpiValueType<value_type>::value;
+
+    for (int side = 0; side < 2; ++side) {
+      std::vector<value_type> &recv = recvBuffers[bufferIndex(patch, dim, side)];
+      MPI_Irecv(
+          recv.data(), recv.size(), mpiType, p.neighbourRank[dim][side], messageTag(patch, dim, side), this->comm,
+          &recvRequests[2 * patch + side]
+      );
+    }
+
+    // The upper source cells fill the lower ghost cells of the next patch and
+    // the lower source cells fill the upper ghost cells of the previous patch
+    for (int side = 0; side < 2; ++side) {
+      int target = 1 - side;
+      std::vector<value_type> &send = sendBuffers[bufferIndex(patch, dim, side)];
+      DomainType source = p.bounds->getGhostSourceDomain(dim, typename BoundaryType::bound(side));
+
+      double packStart = MPI_Wtime();
+      int arr_ind = 0;
+      for (const LimitType &pos : source) send[arr_ind++] = grid[pos];
+
+      MPICommStatistics::Counters &counters = statistics(p.neighbourRank[dim][side], dim, side);
+      counters.packTime += MPI_Wtime() - packStart;
+      ++counters.messages;
+      counters.bytes += long(send.size()) * sizeof(value_type);
+
+      MPI_Isend(
+          send.data(), send.size(), mpiType, p.neighbourRank[dim][side],
+          messageTag(p.neighbourIndex[dim][side], dim, target), this->comm,
+          &sendRequests[bufferIndex(patch, dim, side)]
+      );
+    }
+  }
+
+  template<class GridType>
+  void MPIPatchSubdivision<GridType>::finishExchange(GridType &grid, int patch, size_t dim) {
+    PatchType &p = patches[patch];
+    for (int side = 0; side < 2; ++side) {
+      std::vector<value_type> &recv = recvBuffers[bufferIndex(patch, dim, side)];
+      DomainType ghost = p.bounds->getGhostDomain(dim, typename BoundaryType::bound(side));
+
+      double packStart = MPI_Wtime();
+      int arr_ind = 0;
+      for (const LimitType &pos : ghost) grid[pos] = recv[arr_ind++];
+      statistics(p.neighbourRank[dim][side], dim, side).packTime += MPI_Wtime() - packStart;
+    }
+  }
+
+  template<class GridType>
+  void MPIPatchSubdivision<GridType>::exchange(GridList &grids) {
+    exchange(grids, [](int) {});
+  }
+
+  template<class GridType>
+  template<class Task>
+  void MPIPatchSubdivision<GridType>::exchange(GridList &grids, Task task) {
+    int count = patches.size();
+    SCHNEK_ASSERT(
+        int(grids.size()) == count,
+        "MPIPatchSubdivision::exchange expected " << count << " grids but got " << grids.size()
+    );
+
+    std::vector<MPI_Request> recvRequests(2 * count, MPI_REQUEST_NULL);
+    std::vector<MPI_Request> sendRequests(2 * Rank * count, MPI_REQUEST_NULL);
+
+    // The dimension that each patch is currently exchanging and the number
+    // of messages it is still waiting for
+    std::vector<size_t> stage(count, 0);
+    std::vector<int> pending(count, 2);
+
+    for (int p = 0; p < count; ++p) postExchange(grids[p], p, 0, recvRequests, sendRequests);
+
+    int remaining = count;
+    while (remaining > 0) {
+      int index;
+      double start = MPI_Wtime();
+      MPI_Waitany(2 * count, recvRequests.data(), &index, MPI_STATUS_IGNORE);
+      SCHNEK_ASSERT(index != MPI_UNDEFINED, "MPIPatchSubdivision::exchange ran out of pending messages");
+
+      int p = index / 2;
+      statistics(patches[p].neighbourRank[stage[p]][index % 2], stage[p], index % 2).waitTime +=
+          MPI_Wtime() - start;
+      if (--pending[p] > 0) continue;
+
+      // Ghost cells of the next dimension include the ghost cells of the
+      // previous dimensions, so the edges and corners are filled correctly
+      finishExchange(grids[p], p, stage[p]);
+      if (++stage[p] < Rank) {
+        pending[p] = 2;
+        postExchange(grids[p], p, stage[p], recvRequests, sendRequests);
+      } else {
+        task(p);
+        --remaining;
+      }
+    }
+
+    MPI_Waitall(sendRequests.size(), sendRequests.data(), MPI_STATUSES_IGNORE);
+  }
+
+}  // namespace schnek
+
+#endif  // SCHNEK_HAVE_MPI
@@ -26,6 +26,11 @@
 
 #include "mpisubdivision.hpp"
 
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
 using namespace schnek;
 
 #ifdef SCHNEK_HAVE_MPI
@@ -67,4 +72,135 @@ const MPI_Datatype MpiValueType<double>::value = MPI_DOUBLE;
 template<>
 const MPI_Datatype MpiValueType<long double>::value = MPI_LONG_DOUBLE;
 
+/* **************************************************************
+ *                 Batched reduction                            *
+ ****************************************************************/
+
+namespace {
+  void batchReduceFunction(void *invec, void *inoutvec, int *len, MPI_Datatype *type) {
+    int typeSize;
+    MPI_Type_size(*type, &typeSize);
+    int count = typeSize / sizeof(double);
+
+    const double *in = static_cast<const double *>(invec);
+    double *inout = static_cast<double *>(inoutvec);
+    for (int k = 0; k < *len; ++k, in += count, inout += count) {
+      int maxCount = int(in[0]);
+      for (int i = 1; i <= maxCount; ++i) inout[i] = std::max(in[i], inout[i]);
+      for (int i = maxCount + 1; i < count; ++i) inout[i] += in[i];
+    }
+  }
+}  // namespace
+
+MPI_Op schnek::getBatchReduceOp() {
+  static MPI_Op op = MPI_OP_NULL;
+  if (op == MPI_OP_NULL) MPI_Op_create(&batchReduceFunction, 1, &op);
+  return op;
+}
+
+/* **************************************************************
+ *                 MPICommStatistics                            *
+ ****************************************************************/
+
+void MPICommStatistics::init(size_t rank, const int *prevRanks, const int *nextRanks) {
+  neighbours.assign(2 * rank, Counters());
+  neighbourRanks.resize(2 * rank);
+  for (size_t i = 0; i < rank; ++i) {
+    neighbourRanks[2 * i] = prevRanks[i];
+    neighbourRanks[2 * i + 1] = nextRanks[i];
+  }
+  collective = Counters();
+  localCopy = Counters();
+}
+
+void MPICommStatistics::reset() {
+  std::fill(neighbours.begin(), neighbours.end(), Counters());
+  collective = Counters();
+  localCopy = Counters();
+}
+
+MPICommStatistics::Counters MPICommStatistics::total() const {
+  Counters result;
+  for (const Counters &c : neighbours) {
+    result.messages += c.messages;
+    result.bytes += c.bytes;
+    result.packTime += c.packTime;
+    result.waitTime += c.waitTime;
+  }
+  return result;
+}
+
+void MPICommStatistics::report(std::ostream &out, MPI_Comm comm, int worstCount) const {
+  static const char *names[] = {"messages",   "bytes",              "pack time [s]", "wait time [s]",
+                                "reductions", "reduction time [s]", "local copies",  "local bytes"};
+  const int summaryCount = 8;
+
+  int comSize, comRank;
+  MPI_Comm_size(comm, &comSize);
+  MPI_Comm_rank(comm, &comRank);
+
+  int neighbourCount = neighbours.size();
+  int valueCount = summaryCount + neighbourCount;
+
+  Counters sum = total();
+  std::vector<double> values(valueCount);
+  values[0] = sum.messages;
+  values[1] = sum.bytes;
+  values[2] = sum.packTime;
+  values[3] = sum.waitTime;
+  values[4] = collective.messages;
+  values[5] = collective.waitTime;
+  values[6] = localCopy.messages;
+  values[7] = localCopy.bytes;
+  for (int i = 0; i < neighbourCount; ++i) values[summaryCount + i] = neighbours[i].waitTime;
+
+  std::vector<double> allValues;
+  std::vector<int> allRanks;
+  if (comRank == 0) {
+    allValues.resize(comSize * valueCount);
+    allRanks.resize(comSize * neighbourCount);
+  }
+
+  MPI_Gather(values.data(), valueCount, MPI_DOUBLE, allValues.data(), valueCount, MPI_DOUBLE, 0, comm);
+  MPI_Gather(
+      const_cast<int *>(neighbourRanks.data()), neighbourCount, MPI_INT, allRanks.data(), neighbourCount, MPI_INT, 0,
+      comm
+  );
+
+  if (comRank != 0) return;
+
+  out << "Communication statistics for " << comSize << " processes\n";
+  out << std::setw(20) << "" << std::setw(15) << "min" << std::setw(15) << "mean" << std::setw(15) << "max" << "\n";
+  for (int k = 0; k < summaryCount; ++k) {
+    double vmin = allValues[k], vmax = allValues[k], vsum = 0.0;
+    for (int r = 0; r < comSize; ++r) {
+      double v = allValues[r * valueCount + k];
+      vmin = std::min(vmin, v);
+      vmax = std::max(vmax, v);
+      vsum += v;
+    }
+    out << std::setw(20) << std::left << names[k] << std::right << std::setw(15) << vmin << std::setw(15)
+        << vsum / comSize << std::setw(15) << vmax << "\n";
+  }
+
+  std::vector<int> order(comSize);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return allValues[a * valueCount + 3] > allValues[b * valueCount + 3];
+  });
+
+  int listCount = std::min(worstCount, comSize);
+  if (listCount > 0) out << "Processes with the highest wait time\n";
+  for (int i = 0; i < listCount; ++i) {
+    int r = order[i];
+    out << "  rank " << r << ": " << allValues[r * valueCount + 3] << " s";
+    for (int n = 0; n < neighbourCount; ++n) {
+      out << (n == 0 ? " (" : ", ") << "dim " << n / 2 << (n % 2 == 0 ? " lower" : " upper") << " rank "
+          << allRanks[r * neighbourCount + n] << ": " << allValues[r * valueCount + summaryCount + n] << " s";
+    }
+    out << (neighbourCount > 0 ? ")\n" : "\n");
+  }
+  out << std::flush;
+}
+
 #endif
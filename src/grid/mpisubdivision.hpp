@@ -34,8 +34,99 @@
 
 #include <mpi.h>
 
+#include <iosfwd>
+#include <vector>
+
 namespace schnek {
 
+  /** @brief Communication counters of an MPI subdivision
+   *
+   *  Counts the messages, the bytes sent and the time spent packing buffers and
+   *  waiting for each neighbour. Collective reductions are counted separately.
+   *  The counters are cheap to update and are always active.
+   */
+  class MPICommStatistics {
+    public:
+      /// The counters for a single communication partner
+      struct Counters {
+          /// The number of messages sent
+          long messages;
+          /// The number of bytes sent
+          long bytes;
+          /// The time spent copying data to and from the communication buffers
+          double packTime;
+          /// The time spent blocked in MPI calls
+          double waitTime;
+
+          Counters() : messages(0), bytes(0), packTime(0.0), waitTime(0.0) {}
+      };
+
+    private:
+      /// The counters for each neighbour, indexed by 2*dim + side
+      std::vector<Counters> neighbours;
+
+      /// The ranks of the neighbours, indexed by 2*dim + side
+      std::vector<int> neighbourRanks;
+
+      /// The counters for the collective reductions
+      Counters collective;
+
+      /// The counters for the exchanges between patches on the same process
+      Counters localCopy;
+
+    public:
+      /// Set the number of dimensions and the neighbour ranks and reset all counters
+      void init(size_t rank, const int *prevRanks, const int *nextRanks);
+
+      /// Reset all counters to zero
+      void reset();
+
+      /** Return the counters for a neighbour
+       *
+       * @param dim the dimension in which the neighbour lies
+       * @param side 0 for the lower and 1 for the upper neighbour
+       */
+      Counters &neighbour(size_t dim, int side) { return neighbours[2 * dim + side]; }
+
+      /// Return the counters for a neighbour
+      const Counters &neighbour(size_t dim, int side) const { return neighbours[2 * dim + side]; }
+
+      /// Return the counters for the collective reductions
+      Counters &collectives() { return collective; }
+
+      /// Return the counters for the collective reductions
+      const Counters &collectives() const { return collective; }
+
+      /// Return the counters for the exchanges between patches on the same process
+      Counters &local() { return localCopy; }
+
+      /// Return the counters for the exchanges between patches on the same process
+      const Counters &local() const { return localCopy; }
+
+      /// Return the sum of the counters over all neighbours
+      Counters total() const;
+
+      /** @brief Gather the counters from all processes and print a summary
+       *
+       *  This is a collective operation on comm. The master process (rank 0 in comm)
+       *  prints the minimum, mean and maximum of each counter across processes,
+       *  followed by the processes that spent the most time waiting, broken down by
+       *  neighbour.
+       *
+       * @param out the stream to write to, only used on the master process
+       * @param comm the communicator of the subdivision
+       * @param worstCount the number of processes with the highest wait time to list
+       */
+      void report(std::ostream &out, MPI_Comm comm, int worstCount) const;
+  };
+
+  /** @brief The reduction operator of MPICartSubdivision::batchReduce
+   *
+   *  Each element is a block of doubles. The first entry holds the number of
+   *  entries that are reduced by their maximum, the others are summed.
+   */
+  MPI_Op getBatchReduceOp();
+
   /** @brief a boundary class for multiple processor runs
    *
    * Is designed to be exchanged via the MPI protocol.
@@ -83,6 +174,20 @@ namespace schnek {
 
       DomainType globalDomain;
 
+      /// Communication counters, mutable so that the const reductions can be counted
+      mutable MPICommStatistics commStatistics;
+
+      /** @brief Send data to one neighbour and receive from the opposite neighbour
+       *
+       *  Wraps MPI_Sendrecv and updates the communication counters.
+       *
+       * @param side the side of the neighbour that receives the data, 0 for lower and 1 for upper
+       */
+      void sendRecv(void *send, void *recv, int sendCount, int recvCount, MPI_Datatype type, size_t dim, int side);
+
+      /// Wraps MPI_Allreduce for a single value and updates the communication counters
+      void allReduce(void *in, void *out, MPI_Datatype type, MPI_Op op) const;
+
     public:
       using DomainSubdivision<GridType>::init;
       using DomainSubdivision<GridType>::exchange;
@@ -142,6 +247,9 @@ namespace schnek {
       /// Use MPIALLReduce to calculate the maximum
       int sumReduce(int val) const override;
 
+      /// Use a single MPI_Allreduce to calculate the maxima and sums
+      void batchReduce(std::vector<double> &values, size_t maxCount) const override;
+
       /// The process with the rank zero is designated master process
       bool master() const override { return ComRank == 0; }
 
@@ -154,6 +262,22 @@ namespace schnek {
       /// returns an ID, which consists of the Dimensions and coordinates
       int getUniqueId() const override;
 
+      /// Return the communication counters of this process
+      const MPICommStatistics &getCommStatistics() const { return commStatistics; }
+
+      /// Reset the communication counters of this process
+      void resetCommStatistics() { commStatistics.reset(); }
+
+      /** @brief Print a summary of the communication counters of all processes
+       *
+       *  This is a collective operation and must be called on all processes.
+       *  Only the master process writes to the output stream.
+       *
+       * @param out the stream to write to
+       * @param worstCount the number of processes with the highest wait time to list
+       */
+      void report(std::ostream &out, int worstCount = 3) const { commStatistics.report(out, comm, worstCount); }
+
       /** Returns true if this process is on the lower bound of the
        * global domain
        *
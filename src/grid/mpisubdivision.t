@@ -138,6 +138,13 @@ namespace schnek {
 
     this->bounds = typename DomainSubdivision<GridType>::pBoundaryType(new BoundaryType(Low, High, delta));
 
+    int prevRanks[Rank], nextRanks[Rank];
+    for (size_t i = 0; i < Rank; ++i) {
+      prevRanks[i] = prevcoord[i];
+      nextRanks[i] = nextcoord[i];
+    }
+    commStatistics.init(Rank, prevRanks, nextRanks);
+
     DiagnosticManager::instance().setMaster(this->master());
     DiagnosticManager::instance().setRank(this->procnum());
   }
@@ -151,6 +158,67 @@ namespace schnek {
     if (comm != 0) MPI_Comm_free(&comm);
   }
 
+  template<class GridType>
+  void MPICartSubdivision<GridType>::sendRecv(
+      void *send, void *recv, int sendCount, int recvCount, MPI_Datatype type, size_t dim, int side
+  ) {
+    int dest = (side == 1) ? nextcoord[dim] : prevcoord[dim];
+    int source = (side == 1) ? prevcoord[dim] : nextcoord[dim];
+    int typeSize;
+    MPI_Type_size(type, &typeSize);
+
+    MPI_Status stat;
+    double start = MPI_Wtime();
+    MPI_Sendrecv(send, sendCount, type, dest, 0, recv, recvCount, type, source, 0, comm, &stat);
+
+    // The time blocked is attributed to the neighbour that the data is received from
+    commStatistics.neighbour(dim, 1 - side).waitTime += MPI_Wtime() - start;
+
+    MPICommStatistics::Counters &counters = commStatistics.neighbour(dim, side);
+    ++counters.messages;
+    counters.bytes += long(sendCount) * typeSize;
+  }
+
+  template<class GridType>
+  void MPICartSubdivision<GridType>::allReduce(void *in, void *out, MPI_Datatype type, MPI_Op op) const {
+    int typeSize;
+    MPI_Type_size(type, &typeSize);
+
+    double start = MPI_Wtime();
+    MPI_Allreduce(in, out, 1, type, op, comm);
+
+    MPICommStatistics::Counters &counters = commStatistics.collectives();
+    counters.waitTime += MPI_Wtime() - start;
+    ++counters.messages;
+    counters.bytes += typeSize;
+  }
+
+  template<class GridType>
+  void MPICartSubdivision<GridType>::batchReduce(std::vector<double> &values, size_t maxCount) const {
+    if (values.empty()) return;
+
+    // All values form a single element, so that MPI never splits them. The
+    // first entry tells the reduction operator how many maxima follow.
+    std::vector<double> in(values.size() + 1), out(values.size() + 1);
+    in[0] = maxCount;
+    std::copy(values.begin(), values.end(), in.begin() + 1);
+
+    MPI_Datatype type;
+    MPI_Type_contiguous(in.size(), MPI_DOUBLE, &type);
+    MPI_Type_commit(&type);
+
+    double start = MPI_Wtime();
+    MPI_Allreduce(in.data(), out.data(), 1, type, getBatchReduceOp(), comm);
+
+    MPICommStatistics::Counters &counters = commStatistics.collectives();
+    counters.waitTime += MPI_Wtime() - start;
+    ++counters.messages;
+    counters.bytes += in.size() * sizeof(double);
+
+    MPI_Type_free(&type);
+    std::copy(out.begin() + 1, out.end(), values.begin());
+  }
+
   template<class GridType>
   void MPICartSubdivision<GridType>::exchange(GridType &grid, size_t dim) {
     // nothing to be done
@@ -161,8 +229,6 @@ namespace schnek {
     DomainType loSource = this->bounds->getGhostSourceDomain(dim, BoundaryType::Min);
     DomainType hiSource = this->bounds->getGhostSourceDomain(dim, BoundaryType::Max);
 
-    MPI_Status stat;
-
     value_type *send = sendarr[dim];
     value_type *recv = recvarr[dim];
 
@@ -171,6 +237,7 @@ namespace schnek {
     // fill the lower ghost cells with the vales from higher source cells
     // in the neighbouring process
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = hiSource.begin();
       typename DomainType::iterator domEnd = hiSource.end();
@@ -183,12 +250,12 @@ namespace schnek {
       if (arr_ind != exchSize[dim]) {
         std::cerr << "Error " << dim << "-min: " << arr_ind << " vs " << exchSize[dim] << std::endl;
       }
+      commStatistics.neighbour(dim, 1).packTime += MPI_Wtime() - packStart;
     }
 
-    MPI_Sendrecv(
-        send, exchSize[dim], mpiType, nextcoord[dim], 0, recv, exchSize[dim], mpiType, prevcoord[dim], 0, comm, &stat
-    );
+    sendRecv(send, recv, exchSize[dim], exchSize[dim], mpiType, dim, 1);
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = loGhost.begin();
       typename DomainType::iterator domEnd = loGhost.end();
@@ -198,11 +265,13 @@ namespace schnek {
         ++arr_ind;
         ++domIt;
       }
+      commStatistics.neighbour(dim, 0).packTime += MPI_Wtime() - packStart;
     }
 
     // fill the upper ghost cells with the values from lower source cells
     // in the neighbouring process
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = loSource.begin();
       typename DomainType::iterator domEnd = loSource.end();
@@ -215,12 +284,12 @@ namespace schnek {
       if (arr_ind != exchSize[dim]) {
         std::cerr << "Error " << dim << "-max: " << arr_ind << " vs " << exchSize[dim] << std::endl;
       }
+      commStatistics.neighbour(dim, 0).packTime += MPI_Wtime() - packStart;
     }
 
-    MPI_Sendrecv(
-        send, exchSize[dim], mpiType, prevcoord[dim], 0, recv, exchSize[dim], mpiType, nextcoord[dim], 0, comm, &stat
-    );
+    sendRecv(send, recv, exchSize[dim], exchSize[dim], mpiType, dim, 0);
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = hiGhost.begin();
       typename DomainType::iterator domEnd = hiGhost.end();
@@ -230,6 +299,7 @@ namespace schnek {
         ++arr_ind;
         ++domIt;
       }
+      commStatistics.neighbour(dim, 1).packTime += MPI_Wtime() - packStart;
     }
   }
 
@@ -247,8 +317,6 @@ namespace schnek {
     DomainType loSource = this->bounds->getGhostSourceDomain(dim, BoundaryType::Min);
     DomainType hiSource = this->bounds->getGhostSourceDomain(dim, BoundaryType::Max);
 
-    MPI_Status stat;
-
     value_type *send = sendarr[dim];
     value_type *recv = recvarr[dim];
 
@@ -260,6 +328,7 @@ namespace schnek {
 
     // fill send buffer with values from inner cells
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = hiSource.begin();
       typename DomainType::iterator domEnd = hiSource.end();
@@ -272,13 +341,13 @@ namespace schnek {
       if (arr_ind != exchSize[dim]) {
         std::cerr << "Error " << dim << "-min: " << arr_ind << " vs " << exchSize[dim] << std::endl;
       }
+      commStatistics.neighbour(dim, 1).packTime += MPI_Wtime() - packStart;
     }
     // send to neighbour
-    MPI_Sendrecv(
-        send, exchSize[dim], mpiType, nextcoord[dim], 0, recv, exchSize[dim], mpiType, prevcoord[dim], 0, comm, &stat
-    );
+    sendRecv(send, recv, exchSize[dim], exchSize[dim], mpiType, dim, 1);
     // add to the ghost cells and fill send array with the result
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = loGhost.begin();
       typename DomainType::iterator domEnd = loGhost.end();
@@ -291,13 +360,13 @@ namespace schnek {
         ++arr_ind;
         ++domIt;
       }
+      commStatistics.neighbour(dim, 0).packTime += MPI_Wtime() - packStart;
     }
     // send back to neighbour
-    MPI_Sendrecv(
-        send, exchSize[dim], mpiType, prevcoord[dim], 0, recv, exchSize[dim], mpiType, nextcoord[dim], 0, comm, &stat
-    );
+    sendRecv(send, recv, exchSize[dim], exchSize[dim], mpiType, dim, 0);
     // save result back to inner cells
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = hiSource.begin();
       typename DomainType::iterator domEnd = hiSource.end();
@@ -310,6 +379,7 @@ namespace schnek {
       if (arr_ind != exchSize[dim]) {
         std::cerr << "Error " << dim << "-min: " << arr_ind << " vs " << exchSize[dim] << std::endl;
       }
+      commStatistics.neighbour(dim, 1).packTime += MPI_Wtime() - packStart;
     }
 
     // == 2 ==
@@ -318,6 +388,7 @@ namespace schnek {
 
     // fill send buffer with values from inner cells
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = loSource.begin();
       typename DomainType::iterator domEnd = loSource.end();
@@ -330,13 +401,13 @@ namespace schnek {
       if (arr_ind != exchSize[dim]) {
         std::cerr << "Error " << dim << "-max: " << arr_ind << " vs " << exchSize[dim] << std::endl;
       }
+      commStatistics.neighbour(dim, 0).packTime += MPI_Wtime() - packStart;
     }
     // send to neighbour
-    MPI_Sendrecv(
-        send, exchSize[dim], mpiType, prevcoord[dim], 0, recv, exchSize[dim], mpiType, nextcoord[dim], 0, comm, &stat
-    );
+    sendRecv(send, recv, exchSize[dim], exchSize[dim], mpiType, dim, 0);
     // add to the ghost cells and fill send array with the result
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = hiGhost.begin();
       typename DomainType::iterator domEnd = hiGhost.end();
@@ -349,13 +420,13 @@ namespace schnek {
         ++arr_ind;
         ++domIt;
       }
+      commStatistics.neighbour(dim, 1).packTime += MPI_Wtime() - packStart;
     }
     // send result back to neighbour
-    MPI_Sendrecv(
-        send, exchSize[dim], mpiType, nextcoord[dim], 0, recv, exchSize[dim], mpiType, prevcoord[dim], 0, comm, &stat
-    );
+    sendRecv(send, recv, exchSize[dim], exchSize[dim], mpiType, dim, 1);
     // save result back to inner cells
     {
+      double packStart = MPI_Wtime();
       int arr_ind = 0;
       typename DomainType::iterator domIt = loSource.begin();
       typename DomainType::iterator domEnd = loSource.end();
@@ -368,6 +439,7 @@ namespace schnek {
       if (arr_ind != exchSize[dim]) {
         std::cerr << "Error " << dim << "-max: " << arr_ind << " vs " << exchSize[dim] << std::endl;
       }
+      commStatistics.neighbour(dim, 0).packTime += MPI_Wtime() - packStart;
     }
   }
 
@@ -377,76 +449,70 @@ namespace schnek {
     int sendSize = in.getDims(0);
     int recvSize = 0;
 
-    int sendCoord = (orientation > 0) ? nextcoord[dim] : prevcoord[dim];
-    int recvCoord = (orientation > 0) ? prevcoord[dim] : nextcoord[dim];
-
-    MPI_Status stat;
+    int side = (orientation > 0) ? 1 : 0;
 
-    MPI_Sendrecv(&sendSize, 1, MPI_INT, sendCoord, 0, &recvSize, 1, MPI_INT, recvCoord, 0, comm, &stat);
+    sendRecv(&sendSize, &recvSize, 1, 1, MPI_INT, dim, side);
 
     out.resize(Index(recvSize));
 
     // memcpy(out.getRawData(), in.getRawData(), sendSize*sizeof(value_type));
 
-    MPI_Sendrecv(
-        in.getRawData(), sendSize, MPI_UNSIGNED_CHAR, sendCoord, 0, out.getRawData(), recvSize, MPI_UNSIGNED_CHAR,
-        recvCoord, 0, comm, &stat
-    );
+    sendRecv(in.getRawData(), out.getRawData(), sendSize, recvSize, MPI_UNSIGNED_CHAR, dim, side);
   }
 
   template<class GridType>
   double MPICartSubdivision<GridType>::avgReduce(double val) const {
     double result;
-    MPI_Allreduce(&val, &result, 1, MPI_DOUBLE, MPI_SUM, comm);
+    allReduce(&val, &result, MPI_DOUBLE, MPI_SUM);
     return result / double(ComSize);
   }
 
   template<class GridType>
   int MPICartSubdivision<GridType>::avgReduce(int val) const {
     int result;
-    MPI_Allreduce(&val, &result, 1, MPI_INT, MPI_SUM, comm);
+    allReduce(&val, &result, MPI_INT, MPI_SUM);
     return result / double(ComSize);
   }
 
   template<class GridType>
   double MPICartSubdivision<GridType>::maxReduce(double val) const {
     double result;
-    MPI_Allreduce(&val, &result, 1, MPI_DOUBLE, MPI_MAX, comm);
+    allReduce(&val, &result, MPI_DOUBLE, MPI_MAX);
     return result;
   }
 
   template<class GridType>
   int MPICartSubdivision<GridType>::maxReduce(int val) const {
     int result;
-    MPI_Allreduce(&val, &result, 1, MPI_INT, MPI_MAX, comm);
+    allReduce(&val, &result, MPI_INT, MPI_MAX);
     return result;
   }
 
   template<class GridType>
   double MPICartSubdivision<GridType>::minReduce(double val) const {
     double result;
-    MPI_Allreduce(&val, &result, 1, MPI_DOUBLE, MPI_MIN, comm);
+    allReduce(&val, &result, MPI_DOUBLE, MPI_MIN);
     return result;
   }
 
   template<class GridType>
   int MPICartSubdivision<GridType>::minReduce(int val) const {
     int result;
-    MPI_Allreduce(&val, &result, 1, MPI_INT, MPI_MIN, comm);
+    allReduce(&val, &result, MPI_INT, MPI_MIN);
     return result;
   }
 
   template<class GridType>
   double MPICartSubdivision<GridType>::sumReduce(double val) const {
     double result;
-    MPI_Allreduce(&val, &result, 1, MPI_DOUBLE, MPI_SUM, comm);
+    allReduce(&val, &result, MPI_DOUBLE, MPI_SUM);
     return result;
   }
 
   template<class GridType>
   int MPICartSubdivision<GridType>::sumReduce(int val) const {
     int result;
-    MPI_Allreduce(&val, &result, 1, MPI_INT, MPI_SUM, comm);
+    allReduce(&val, &result, MPI_INT, MPI_SUM);
     return result;
   }
 
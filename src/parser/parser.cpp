@@ -28,6 +28,7 @@
 
 #include "../variables/block.hpp"
 #include "../variables/dependencies.hpp"
+#include "../variables/simplifier.hpp"
 #include "deckgrammar.hpp"
 #include "deckscanner.hpp"
 #include "tokenlist.hpp"
@@ -87,6 +88,10 @@ pBlock Parser::parse(std::istream &input, std::string filename) {
 
   ParseFree(pParser);
 
+  // fold constant sub expressions and share identical ones between the variables
+  ExpressionSimplifier simplifier;
+  simplifier.simplify(variables.getRootBlock());
+
   DependencyMap depMap(variables.getRootBlock());
   depMap.updateAll();
 
@@ -24,6 +24,8 @@
  *
  */
 
+#include <vector>
+
 #include "../grid/range.hpp"
 
 namespace schnek {
@@ -43,23 +45,45 @@ namespace schnek {
       T &value,
       DependencyUpdater &updater
   ) {
-    Range<int, rank> domain(field.getLo(), field.getHi());
+    typedef typename Range<int, rank>::LimitType IndexType;
+    static const size_t last = rank - 1;
+
+    // the expressions are evaluated for whole rows along the last dimension
+    const IndexType &lo = field.getLo();
+    IndexType rowHi = field.getHi();
+    int length = rowHi[last] - lo[last] + 1;
+    if (length <= 0) return;
+    rowHi[last] = lo[last];
+
+    std::vector<double> rowCoords(length);
+    std::vector<T> rowValues(length);
+    for (int i = 0; i < length; ++i) rowCoords[i] = field.indexToPosition(last, lo[last] + i);
 
-    typename Range<int, rank>::iterator it = domain.begin();
-    typename Range<int, rank>::iterator end = domain.end();
+    // the variables are evaluated in the outermost loop possible
+    std::vector<double *> loops(rank);
+    for (size_t i = 0; i < rank; ++i) loops[i] = &coords[i];
+
+    Range<int, rank> rows(lo, rowHi);
+    typename Range<int, rank>::iterator it = rows.begin();
+    typename Range<int, rank>::iterator end = rows.end();
+    IndexType previous = lo;
+    bool first = true;
     while (it != end) {
-      const typename Range<int, rank>::LimitType &pos = *it;
-      //    std::cerr << " fill_field (";
-      //    for (size_t i=0; i<rank; ++i)
-      //      std::cerr << " " << pos[i];
-      //    std::cerr << ") (";
-      for (size_t i = 0; i < rank; ++i) {
+      IndexType pos = *it;
+      size_t changed = 0;
+      while (!first && (changed < last) && (pos[changed] == previous[changed])) ++changed;
+      for (size_t i = changed; i < last; ++i) {
         coords[i] = field.indexToPosition(i, pos[i]);
-        //      std::cerr << " " << coords[i];
+        updater.updateLoop(loops, i);
+      }
+      previous = pos;
+      first = false;
+
+      updater.updateBatch(loops, rowCoords.data(), length, value, rowValues.data());
+      for (int i = 0; i < length; ++i) {
+        pos[last] = lo[last] + i;
+        field.get(pos) = rowValues[i];
       }
-      //    std::cerr << ")" << std::endl;
-      updater.update();
-      field.get(pos) = value;
       ++it;
     }
   }
@@ -116,6 +116,15 @@ namespace schnek {
       template<typename T>
       void retrieveData(std::string key, T &data);
 
+      /** Collect all the data of type T registered by this block and its descendants
+       *
+       * The data of the descendants is keyed by the names of the blocks separated by
+       * dots, so that every key can be passed to retrieveData on this block. Data that
+       * has been registered as a pointer is included as well.
+       */
+      template<typename T>
+      void collectData(std::map<std::string, T *> &data, std::string prefix = "");
+
       void initAll();
 
       void setName(const std::string &name_) { name = name_; }
@@ -178,6 +187,19 @@ namespace schnek {
     data = *datap;
   }
 
+  template<typename T>
+  void Block::collectData(std::map<std::string, T *> &data, std::string prefix) {
+    for (std::pair<const std::string, T *> &entry : BlockData<T>::instance().getAll(this->getId())) {
+      data[prefix + entry.first] = entry.second;
+    }
+    for (std::pair<const std::string, T **> &entry : BlockData<T *>::instance().getAll(this->getId())) {
+      data[prefix + entry.first] = *entry.second;
+    }
+    for (pBlock child : children) {
+      child->collectData(data, prefix + child->getName() + ".");
+    }
+  }
+
 }  // namespace schnek
 
 #endif  // SCHNEK_BLOCK_HPP_
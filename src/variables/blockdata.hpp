@@ -52,6 +52,8 @@ namespace schnek {
       void add(long blockId, std::string key, T& data);
       T* get(long blockId, std::string key);
       bool exists(long blockId, std::string key);
+      /// All the data registered by a block, keyed by name
+      DataMap getAll(long blockId);
   };
 
   template<typename T>
@@ -83,6 +85,13 @@ namespace schnek {
     return (blockDataMap[blockId]->count(key) > 0);
   }
 
+  template<typename T>
+  typename BlockData<T>::DataMap BlockData<T>::getAll(long blockId) {
+    SCHNEK_TRACE_LOG(2, "BlockData<T>::getAll(" << blockId << ")")
+    if (0 == blockDataMap.count(blockId)) return DataMap();
+    return *blockDataMap[blockId];
+  }
+
 }  // namespace schnek
 
 #endif  // SCHNEK_BLOCKDATA_HPP_
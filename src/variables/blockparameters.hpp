@@ -115,6 +115,9 @@ namespace schnek {
         if (variable->isReadOnly()) return;
         *value = boost::get<T>(variable->getValue());
       }
+
+      /// returns the pointer to the value that is set by the parameter
+      T *getValuePointer() { return value; }
   };
 
   template<typename T>
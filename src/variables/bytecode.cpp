@@ -0,0 +1,412 @@
+/*
+ * bytecode.cpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bytecode.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "expression.hpp"
+#include "variables.hpp"
+
+using namespace schnek;
+
+void BytecodeProgram::run() {
+  double *f = doubleRegisters.data();
+  int *n = intRegisters.data();
+
+  for (const BytecodeInstruction &ins : code) {
+    switch (ins.op) {
+      case BytecodeOp::Add:
+        f[ins.dst] = f[ins.a] + f[ins.b];
+        break;
+      case BytecodeOp::Subtract:
+        f[ins.dst] = f[ins.a] - f[ins.b];
+        break;
+      case BytecodeOp::Multiply:
+        f[ins.dst] = f[ins.a] * f[ins.b];
+        break;
+      case BytecodeOp::Divide:
+        f[ins.dst] = f[ins.a] / f[ins.b];
+        break;
+      case BytecodeOp::Power:
+        f[ins.dst] = std::pow(f[ins.a], f[ins.b]);
+        break;
+      case BytecodeOp::Negate:
+        f[ins.dst] = -f[ins.a];
+        break;
+      case BytecodeOp::Invert:
+        f[ins.dst] = 1 / f[ins.a];
+        break;
+
+      case BytecodeOp::AddI:
+        n[ins.dst] = n[ins.a] + n[ins.b];
+        break;
+      case BytecodeOp::SubtractI:
+        n[ins.dst] = n[ins.a] - n[ins.b];
+        break;
+      case BytecodeOp::MultiplyI:
+        n[ins.dst] = n[ins.a] * n[ins.b];
+        break;
+      case BytecodeOp::DivideI:
+        n[ins.dst] = n[ins.a] / n[ins.b];
+        break;
+      case BytecodeOp::PowerI:
+        n[ins.dst] = static_cast<int>(std::pow(n[ins.a], n[ins.b]));
+        break;
+      case BytecodeOp::NegateI:
+        n[ins.dst] = -n[ins.a];
+        break;
+      case BytecodeOp::InvertI:
+        n[ins.dst] = 1 / n[ins.a];
+        break;
+
+      case BytecodeOp::ToDouble:
+        f[ins.dst] = static_cast<double>(n[ins.a]);
+        break;
+      case BytecodeOp::ToInt:
+        n[ins.dst] = static_cast<int>(f[ins.a]);
+        break;
+
+      case BytecodeOp::External:
+        f[ins.dst] = *static_cast<double *>(ins.ptr);
+        break;
+      case BytecodeOp::ExternalI:
+        n[ins.dst] = *static_cast<int *>(ins.ptr);
+        break;
+      // it is assumed that the referenced variable has been evaluated
+      case BytecodeOp::Load:
+        f[ins.dst] = boost::get<double>(static_cast<Variable *>(ins.ptr)->getValueReference());
+        break;
+      case BytecodeOp::LoadI:
+        n[ins.dst] = boost::get<int>(static_cast<Variable *>(ins.ptr)->getValueReference());
+        break;
+      case BytecodeOp::Call:
+        f[ins.dst] = static_cast<Expression<double> *>(ins.ptr)->eval();
+        break;
+      case BytecodeOp::CallI:
+        n[ins.dst] = static_cast<Expression<int> *>(ins.ptr)->eval();
+        break;
+      case BytecodeOp::Function:
+        static_cast<BytecodeFunction *>(ins.ptr)->evaluate(getRegisters(), &arguments[ins.a], ins.dst, 1);
+        break;
+
+      case BytecodeOp::Sin:
+        f[ins.dst] = std::sin(f[ins.a]);
+        break;
+      case BytecodeOp::Cos:
+        f[ins.dst] = std::cos(f[ins.a]);
+        break;
+      case BytecodeOp::Tan:
+        f[ins.dst] = std::tan(f[ins.a]);
+        break;
+      case BytecodeOp::Asin:
+        f[ins.dst] = std::asin(f[ins.a]);
+        break;
+      case BytecodeOp::Acos:
+        f[ins.dst] = std::acos(f[ins.a]);
+        break;
+      case BytecodeOp::Atan:
+        f[ins.dst] = std::atan(f[ins.a]);
+        break;
+      case BytecodeOp::Sinh:
+        f[ins.dst] = std::sinh(f[ins.a]);
+        break;
+      case BytecodeOp::Cosh:
+        f[ins.dst] = std::cosh(f[ins.a]);
+        break;
+      case BytecodeOp::Tanh:
+        f[ins.dst] = std::tanh(f[ins.a]);
+        break;
+      case BytecodeOp::Exp:
+        f[ins.dst] = std::exp(f[ins.a]);
+        break;
+      case BytecodeOp::Log:
+        f[ins.dst] = std::log(f[ins.a]);
+        break;
+      case BytecodeOp::Log10:
+        f[ins.dst] = std::log10(f[ins.a]);
+        break;
+      case BytecodeOp::Sqrt:
+        f[ins.dst] = std::sqrt(f[ins.a]);
+        break;
+      case BytecodeOp::Ceil:
+        f[ins.dst] = std::ceil(f[ins.a]);
+        break;
+      case BytecodeOp::Fabs:
+        f[ins.dst] = std::fabs(f[ins.a]);
+        break;
+      case BytecodeOp::Floor:
+        f[ins.dst] = std::floor(f[ins.a]);
+        break;
+      case BytecodeOp::Atan2:
+        f[ins.dst] = std::atan2(f[ins.a], f[ins.b]);
+        break;
+      case BytecodeOp::Fmod:
+        f[ins.dst] = std::fmod(f[ins.a], f[ins.b]);
+        break;
+      case BytecodeOp::Min:
+        f[ins.dst] = std::min(f[ins.a], f[ins.b]);
+        break;
+      case BytecodeOp::Max:
+        f[ins.dst] = std::max(f[ins.a], f[ins.b]);
+        break;
+    }
+  }
+}
+
+namespace {
+  template<typename R, typename A, typename Op>
+  inline void batchUnary(const BytecodeRegisters &reg, const BytecodeInstruction &ins, size_t count, Op op) {
+    R *dst = reg.get<R>(ins.dst);
+    const A *a = reg.get<A>(ins.a);
+    for (size_t j = 0; j < count; ++j) dst[j] = op(a[j]);
+  }
+
+  template<typename T, typename Op>
+  inline void batchBinary(const BytecodeRegisters &reg, const BytecodeInstruction &ins, size_t count, Op op) {
+    T *dst = reg.get<T>(ins.dst);
+    const T *a = reg.get<T>(ins.a);
+    const T *b = reg.get<T>(ins.b);
+    for (size_t j = 0; j < count; ++j) dst[j] = op(a[j], b[j]);
+  }
+
+  template<typename T>
+  inline void broadcast(T *dst, T value, size_t count) {
+    for (size_t j = 0; j < count; ++j) dst[j] = value;
+  }
+}  // namespace
+
+void BytecodeProgram::run(size_t count) {
+  BytecodeRegisters reg = getRegisters();
+
+  for (const BytecodeInstruction &ins : code) {
+    switch (ins.op) {
+      case BytecodeOp::Add:
+        batchBinary<double>(reg, ins, count, std::plus<double>());
+        break;
+      case BytecodeOp::Subtract:
+        batchBinary<double>(reg, ins, count, std::minus<double>());
+        break;
+      case BytecodeOp::Multiply:
+        batchBinary<double>(reg, ins, count, std::multiplies<double>());
+        break;
+      case BytecodeOp::Divide:
+        batchBinary<double>(reg, ins, count, std::divides<double>());
+        break;
+      case BytecodeOp::Power:
+        batchBinary<double>(reg, ins, count, [](double a, double b) { return std::pow(a, b); });
+        break;
+      case BytecodeOp::Negate:
+        batchUnary<double, double>(reg, ins, count, std::negate<double>());
+        break;
+      case BytecodeOp::Invert:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return 1 / a; });
+        break;
+
+      case BytecodeOp::AddI:
+        batchBinary<int>(reg, ins, count, std::plus<int>());
+        break;
+      case BytecodeOp::SubtractI:
+        batchBinary<int>(reg, ins, count, std::minus<int>());
+        break;
+      case BytecodeOp::MultiplyI:
+        batchBinary<int>(reg, ins, count, std::multiplies<int>());
+        break;
+      case BytecodeOp::DivideI:
+        batchBinary<int>(reg, ins, count, std::divides<int>());
+        break;
+      case BytecodeOp::PowerI:
+        batchBinary<int>(reg, ins, count, [](int a, int b) { return static_cast<int>(std::pow(a, b)); });
+        break;
+      case BytecodeOp::NegateI:
+        batchUnary<int, int>(reg, ins, count, std::negate<int>());
+        break;
+      case BytecodeOp::InvertI:
+        batchUnary<int, int>(reg, ins, count, [](int a) { return 1 / a; });
+        break;
+
+      case BytecodeOp::ToDouble:
+        batchUnary<double, int>(reg, ins, count, [](int a) { return static_cast<double>(a); });
+        break;
+      case BytecodeOp::ToInt:
+        batchUnary<int, double>(reg, ins, count, [](double a) { return static_cast<int>(a); });
+        break;
+
+      // values from outside the program are the same for all values of the registers
+      case BytecodeOp::External:
+        broadcast(reg.get<double>(ins.dst), *static_cast<double *>(ins.ptr), count);
+        break;
+      case BytecodeOp::ExternalI:
+        broadcast(reg.get<int>(ins.dst), *static_cast<int *>(ins.ptr), count);
+        break;
+      case BytecodeOp::Load:
+        broadcast(
+            reg.get<double>(ins.dst), boost::get<double>(static_cast<Variable *>(ins.ptr)->getValueReference()), count
+        );
+        break;
+      case BytecodeOp::LoadI:
+        broadcast(reg.get<int>(ins.dst), boost::get<int>(static_cast<Variable *>(ins.ptr)->getValueReference()), count);
+        break;
+      case BytecodeOp::Call:
+        broadcast(reg.get<double>(ins.dst), static_cast<Expression<double> *>(ins.ptr)->eval(), count);
+        break;
+      case BytecodeOp::CallI:
+        broadcast(reg.get<int>(ins.dst), static_cast<Expression<int> *>(ins.ptr)->eval(), count);
+        break;
+      case BytecodeOp::Function:
+        static_cast<BytecodeFunction *>(ins.ptr)->evaluate(reg, &arguments[ins.a], ins.dst, count);
+        break;
+
+      case BytecodeOp::Sin:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::sin(a); });
+        break;
+      case BytecodeOp::Cos:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::cos(a); });
+        break;
+      case BytecodeOp::Tan:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::tan(a); });
+        break;
+      case BytecodeOp::Asin:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::asin(a); });
+        break;
+      case BytecodeOp::Acos:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::acos(a); });
+        break;
+      case BytecodeOp::Atan:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::atan(a); });
+        break;
+      case BytecodeOp::Sinh:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::sinh(a); });
+        break;
+      case BytecodeOp::Cosh:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::cosh(a); });
+        break;
+      case BytecodeOp::Tanh:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::tanh(a); });
+        break;
+      case BytecodeOp::Exp:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::exp(a); });
+        break;
+      case BytecodeOp::Log:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::log(a); });
+        break;
+      case BytecodeOp::Log10:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::log10(a); });
+        break;
+      case BytecodeOp::Sqrt:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::sqrt(a); });
+        break;
+      case BytecodeOp::Ceil:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::ceil(a); });
+        break;
+      case BytecodeOp::Fabs:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::fabs(a); });
+        break;
+      case BytecodeOp::Floor:
+        batchUnary<double, double>(reg, ins, count, [](double a) { return std::floor(a); });
+        break;
+      case BytecodeOp::Atan2:
+        batchBinary<double>(reg, ins, count, [](double a, double b) { return std::atan2(a, b); });
+        break;
+      case BytecodeOp::Fmod:
+        batchBinary<double>(reg, ins, count, [](double a, double b) { return std::fmod(a, b); });
+        break;
+      case BytecodeOp::Min:
+        batchBinary<double>(reg, ins, count, [](double a, double b) { return std::min(a, b); });
+        break;
+      case BytecodeOp::Max:
+        batchBinary<double>(reg, ins, count, [](double a, double b) { return std::max(a, b); });
+        break;
+    }
+  }
+}
+
+// -------------------------------------------------------------
+// BytecodeCompiler
+// -------------------------------------------------------------
+
+int BytecodeCompiler::newDouble(double value) {
+  program.doubleRegisters.resize(program.doubleRegisters.size() + program.width, value);
+  return program.doubleRegisters.size() / program.width - 1;
+}
+
+int BytecodeCompiler::newInt(int value) {
+  program.intRegisters.resize(program.intRegisters.size() + program.width, value);
+  return program.intRegisters.size() / program.width - 1;
+}
+
+int BytecodeCompiler::emit(BytecodeOp op, int dst, int a, int b, void *ptr) {
+  BytecodeInstruction ins = {op, dst, a, b, ptr};
+  program.code.push_back(ins);
+  return dst;
+}
+
+void BytecodeCompiler::unsupported() {
+  throw BytecodeException("Only int and float expressions can be compiled");
+}
+
+BytecodeOp BytecodeCompiler::intOp(BytecodeOp op) {
+  switch (op) {
+    case BytecodeOp::Add:
+      return BytecodeOp::AddI;
+    case BytecodeOp::Subtract:
+      return BytecodeOp::SubtractI;
+    case BytecodeOp::Multiply:
+      return BytecodeOp::MultiplyI;
+    case BytecodeOp::Divide:
+      return BytecodeOp::DivideI;
+    case BytecodeOp::Power:
+      return BytecodeOp::PowerI;
+    case BytecodeOp::Negate:
+      return BytecodeOp::NegateI;
+    case BytecodeOp::Invert:
+      return BytecodeOp::InvertI;
+    default:
+      throw BytecodeException("Not an arithmetic instruction");
+  }
+}
+
+int BytecodeCompiler::builtin(BytecodeOp op, const std::vector<int> &args) {
+  switch (op) {
+    case BytecodeOp::Atan2:
+    case BytecodeOp::Fmod:
+    case BytecodeOp::Min:
+    case BytecodeOp::Max:
+    case BytecodeOp::Power:
+      if (args.size() != 2) throw WrongNumberOfArgsException();
+      return emit(op, newDouble(), args[0], args[1]);
+    default:
+      if (args.size() != 1) throw WrongNumberOfArgsException();
+      return emit(op, newDouble(), args[0]);
+  }
+}
+
+void BytecodeCompiler::bind(Variable *variable, int reg) {
+  variables[variable] = reg;
+  variableIds.insert(variable->getId());
+}
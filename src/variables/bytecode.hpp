@@ -0,0 +1,396 @@
+/*
+ * bytecode.hpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCHNEK_BYTECODE_HPP_
+#define SCHNEK_BYTECODE_HPP_
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "types.hpp"
+
+namespace schnek {
+
+  class Variable;
+
+  /** The instruction set of the expression virtual machine
+   *
+   * Every instruction writes into one register and reads up to two registers.
+   * There are separate register banks for double and int values. Instructions
+   * ending in I operate on the int registers.
+   */
+  enum class BytecodeOp : uint8_t {
+    // arithmetic on double registers
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Power,
+    Negate,
+    Invert,
+    // arithmetic on int registers
+    AddI,
+    SubtractI,
+    MultiplyI,
+    DivideI,
+    PowerI,
+    NegateI,
+    InvertI,
+    // conversion between the register banks
+    ToDouble,
+    ToInt,
+    // read a value from outside the program
+    External,
+    ExternalI,
+    Load,
+    LoadI,
+    /// Evaluate an expression that has no bytecode through its eval() method
+    Call,
+    CallI,
+    /// Evaluate a BytecodeFunction, the arguments are listed in the program
+    Function,
+    // built-in functions of double arguments
+    Sin,
+    Cos,
+    Tan,
+    Asin,
+    Acos,
+    Atan,
+    Sinh,
+    Cosh,
+    Tanh,
+    Exp,
+    Log,
+    Log10,
+    Sqrt,
+    Ceil,
+    Fabs,
+    Floor,
+    Atan2,
+    Fmod,
+    Min,
+    Max
+  };
+
+  struct BytecodeInstruction {
+      BytecodeOp op;
+      int dst;
+      int a;
+      int b;
+      /// The external value, the variable, the expression or the function
+      void *ptr;
+  };
+
+  /// Access to the register banks of a running program
+  struct BytecodeRegisters {
+      double *doubles;
+      int *ints;
+      /// The number of values held by every register
+      size_t width;
+
+      template<typename vtype>
+      vtype *get(int reg) const {
+        if constexpr (std::is_same<vtype, int>::value)
+          return ints + reg * width;
+        else
+          return doubles + reg * width;
+      }
+  };
+
+  /** A function that is evaluated by the Function instruction
+   *
+   * The arguments and the result are registers of the types given by the
+   * signature of the function.
+   */
+  class BytecodeFunction {
+    public:
+      virtual ~BytecodeFunction() {}
+
+      /// Evaluate the function for the first count values of the argument registers
+      virtual void evaluate(const BytecodeRegisters &registers, const int *args, int result, size_t count) = 0;
+  };
+
+  /** A flat sequence of instructions together with its registers
+   *
+   * Constants are stored in the registers when the program is compiled. The
+   * result of the program is in the register given by getResult() after run()
+   * has been called.
+   *
+   * Programs with a width larger than one evaluate the expression for
+   * many values at once. Every register then holds width values and every
+   * instruction is a loop over the values, see run(size_t).
+   */
+  class BytecodeProgram {
+    private:
+      friend class BytecodeCompiler;
+
+      std::vector<BytecodeInstruction> code;
+      std::vector<double> doubleRegisters;
+      std::vector<int> intRegisters;
+      /// The argument registers of the Function instructions
+      std::vector<int> arguments;
+      size_t width;
+      int result;
+
+      BytecodeRegisters getRegisters() { return BytecodeRegisters{doubleRegisters.data(), intRegisters.data(), width}; }
+
+    public:
+      BytecodeProgram(size_t width_ = 1) : width(width_), result(-1) {}
+
+      /// Execute the instructions of a program with a width of one
+      void run();
+
+      /** Execute the instructions for the first count values of every register
+       *
+       * Values read from outside the program, through a Load, External or
+       * Call instruction, are the same for all count values.
+       */
+      void run(size_t count);
+
+      /// The number of values held by every register
+      size_t getWidth() const { return width; }
+
+      /// The instructions of the program
+      const std::vector<BytecodeInstruction> &getInstructions() const { return code; }
+
+      /// The register holding the result
+      int getResult() const { return result; }
+
+      template<typename vtype>
+      vtype getValue(int reg) const {
+        if constexpr (std::is_same<vtype, int>::value)
+          return intRegisters[reg * width];
+        else
+          return doubleRegisters[reg * width];
+      }
+
+      /// The values of a register
+      template<typename vtype>
+      vtype *getValues(int reg) {
+        return getRegisters().get<vtype>(reg);
+      }
+  };
+
+  class BytecodeException : public EvaluationException {
+    public:
+      BytecodeException(std::string message) : EvaluationException(message) {}
+  };
+
+  /** Translates expression trees into a BytecodeProgram
+   *
+   * The compiler is passed to Expression::compile. Every expression adds the
+   * instructions that evaluate it and returns the register holding its value.
+   * Expressions without a bytecode representation are evaluated by calling
+   * their eval() method from within the program. Only double and int
+   * expressions can be compiled.
+   */
+  class BytecodeCompiler {
+    private:
+      BytecodeProgram &program;
+      /// Variables whose values have been computed into registers
+      std::map<Variable *, int> variables;
+      /// External values replaced by registers
+      std::map<void *, int> externals;
+      /// The registers of expressions that have already been compiled
+      std::map<const void *, int> compiled;
+      /// The ids of the variables in the registers
+      std::set<long> variableIds;
+      bool batchable;
+
+      int newDouble(double value = 0.0);
+      int newInt(int value = 0);
+      int emit(BytecodeOp op, int dst, int a = -1, int b = -1, void *ptr = nullptr);
+
+      template<typename vtype>
+      static constexpr bool isInt() {
+        return std::is_same<vtype, int>::value;
+      }
+
+      template<typename vtype>
+      static constexpr bool isSupported() {
+        return std::is_same<vtype, int>::value || std::is_same<vtype, double>::value;
+      }
+
+      [[noreturn]] static void unsupported();
+
+      /// The int version of an arithmetic instruction
+      static BytecodeOp intOp(BytecodeOp op);
+
+    public:
+      BytecodeCompiler(BytecodeProgram &program_) : program(program_), batchable(true) {}
+
+      /// Compile the expression and make its value the result of the program
+      template<typename vtype>
+      void compileProgram(Expression<vtype> &expression) {
+        program.result = compile(expression);
+      }
+
+      /** Compile a sub expression and return the register holding its value
+       *
+       * Expressions shared between several parents, see ExpressionSimplifier,
+       * are compiled only once. Expressions that have to be evaluated at every
+       * update are compiled again every time.
+       */
+      template<typename vtype>
+      int compile(Expression<vtype> &expression) {
+        std::map<const void *, int>::iterator it = compiled.find(&expression);
+        if (it != compiled.end()) return it->second;
+        int reg = expression.compile(*this);
+        if (expression.getDependencies().count(-1) == 0) compiled[&expression] = reg;
+        return reg;
+      }
+
+      /// Store a constant in a register
+      template<typename vtype>
+      int constant(const vtype &value) {
+        if constexpr (isInt<vtype>())
+          return newInt(value);
+        else if constexpr (isSupported<vtype>())
+          return newDouble(value);
+        else
+          unsupported();
+      }
+
+      /// Read a value through a pointer
+      template<typename vtype>
+      int external(vtype *value) {
+        if (externals.count(value) > 0) return externals[value];
+        if constexpr (isInt<vtype>())
+          return emit(BytecodeOp::ExternalI, newInt(), -1, -1, value);
+        else if constexpr (isSupported<vtype>())
+          return emit(BytecodeOp::External, newDouble(), -1, -1, value);
+        else
+          unsupported();
+      }
+
+      /// Read the current value of a variable
+      template<typename vtype>
+      int load(Variable *variable) {
+        if (variables.count(variable) > 0) return variables[variable];
+        if constexpr (isInt<vtype>())
+          return emit(BytecodeOp::LoadI, newInt(), -1, -1, variable);
+        else if constexpr (isSupported<vtype>())
+          return emit(BytecodeOp::Load, newDouble(), -1, -1, variable);
+        else
+          unsupported();
+      }
+
+      /** Evaluate the expression by calling its eval() method
+       *
+       * The expression is evaluated once for all values of a register. If it
+       * depends on a variable bound to a register the program cannot be run
+       * with a width larger than one, see isBatchable().
+       */
+      template<typename vtype>
+      int call(Expression<vtype> *expression) {
+        std::set<long> dependencies = expression->getDependencies();
+        for (long id : dependencies) {
+          if ((id < 0) || (variableIds.count(id) > 0)) batchable = false;
+        }
+        if constexpr (isInt<vtype>())
+          return emit(BytecodeOp::CallI, newInt(), -1, -1, expression);
+        else if constexpr (isSupported<vtype>())
+          return emit(BytecodeOp::Call, newDouble(), -1, -1, expression);
+        else
+          unsupported();
+      }
+
+      /** An arithmetic operation on values of type vtype
+       *
+       * The double version of the operation is passed and replaced by the int
+       * version for int values. Pass b < 0 for unary operations.
+       */
+      template<typename vtype>
+      int arithmetic(BytecodeOp op, int a, int b = -1) {
+        if constexpr (isInt<vtype>())
+          return emit(intOp(op), newInt(), a, b);
+        else if constexpr (isSupported<vtype>())
+          return emit(op, newDouble(), a, b);
+        else
+          unsupported();
+      }
+
+      /// Convert a value from vtype_orig to vtype
+      template<typename vtype, typename vtype_orig>
+      int convert(int a) {
+        if constexpr (std::is_same<vtype, vtype_orig>::value)
+          return a;
+        else if constexpr (isInt<vtype>())
+          return emit(BytecodeOp::ToInt, newInt(), a);
+        else
+          return emit(BytecodeOp::ToDouble, newDouble(), a);
+      }
+
+      /// Returns true if the values can be held in the registers
+      template<typename vtype>
+      static constexpr bool supports() {
+        return isSupported<vtype>();
+      }
+
+      /// A built-in function of double arguments
+      int builtin(BytecodeOp op, const std::vector<int> &args);
+
+      /// A function that reads its arguments from registers and writes a value of type vtype
+      template<typename vtype>
+      int function(BytecodeFunction *function, const std::vector<int> &args) {
+        int offset = program.arguments.size();
+        program.arguments.insert(program.arguments.end(), args.begin(), args.end());
+        if constexpr (isInt<vtype>())
+          return emit(BytecodeOp::Function, newInt(), offset, args.size(), function);
+        else if constexpr (isSupported<vtype>())
+          return emit(BytecodeOp::Function, newDouble(), offset, args.size(), function);
+        else
+          unsupported();
+      }
+
+      /// A register whose values are set from outside before the program runs
+      template<typename vtype>
+      int input() {
+        if constexpr (isInt<vtype>())
+          return newInt();
+        else if constexpr (isSupported<vtype>())
+          return newDouble();
+        else
+          unsupported();
+      }
+
+      /// Subsequent references to the variable read the register instead of the variable
+      void bind(Variable *variable, int reg);
+
+      /// Subsequent reads through the pointer read the register instead
+      void bindExternal(void *value, int reg) { externals[value] = reg; }
+
+      /// Returns false if the program has to be run with a width of one
+      bool isBatchable() const { return batchable; }
+  };
+
+}  // namespace schnek
+
+#endif  // SCHNEK_BYTECODE_HPP_
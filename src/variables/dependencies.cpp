@@ -37,6 +37,7 @@
 
 #pragma GCC diagnostic pop
 
+#include <algorithm>
 #include <cassert>
 
 #undef LOGLEVEL
@@ -274,9 +275,139 @@ DependencyUpdater::DependencyUpdater(pDependencyMap dependencies_) : dependencie
   independentVars.insert(dependencies->dummyVar);
 }
 
+void DependencyUpdater::validate() {
+  dependencies->makeUpdateList(independentVars, dependentVars, updateList);
+  for (pVariable v : updateList) v->compile();
+
+  // the update list is ordered, so the variables a variable depends on have been visited before
+  independentDependencies.clear();
+  for (pVariable v : updateList) {
+    long id = v->getId();
+    std::set<long> &independent = independentDependencies[id];
+    if (independentVars.count(v) > 0) independent.insert(id);
+    for (long dep : dependencies->dependencies[id].dependsOn) {
+      if (independentDependencies.count(dep) == 0) continue;
+      const std::set<long> &indirect = independentDependencies[dep];
+      independent.insert(indirect.begin(), indirect.end());
+    }
+  }
+
+  loopNests.clear();
+  isValid = true;
+}
+
+DependencyUpdater::LoopNest &DependencyUpdater::getLoopNest(const std::vector<double *> &loops) {
+  assert(!loops.empty());
+  LoopNestMap::iterator it = loopNests.find(loops);
+  if (it != loopNests.end()) return it->second;
+
+  const size_t innermost = loops.size() - 1;
+  LoopNest &nest = loopNests[loops];
+  nest.levels.resize(loops.size());
+  nest.batchable = true;
+
+  std::vector<long> loopIds(loops.size(), -1);
+  for (size_t i = 0; i < loops.size(); ++i) {
+    if (independentValues.count(loops[i]) > 0)
+      loopIds[i] = independentValues[loops[i]]->getId();
+    else
+      nest.batchable = false;
+  }
+
+  // Without knowing which variables change with a value, all the variables are evaluated for every value
+  if (!nest.batchable) {
+    SCHNEK_TRACE_LOG(3, "Loop nest over values that are not independent parameters");
+    for (pVariable v : updateList) {
+      nest.levels[innermost].push_back(v);
+      nest.batched.push_back(v);
+      nest.batchedIds.insert(v->getId());
+    }
+    return nest;
+  }
+
+  // expressions that have to be evaluated at every update belong to the innermost loop
+  long dummyId = dependencies->dummyVar->getId();
+
+  for (pVariable v : updateList) {
+    const std::set<long> &independent = independentDependencies[v->getId()];
+    size_t level = (independent.count(dummyId) > 0) ? innermost : 0;
+    for (size_t i = 0; i < loops.size(); ++i) {
+      if (independent.count(loopIds[i]) > 0) level = std::max(level, i);
+    }
+    nest.levels[level].push_back(v);
+    if (level < innermost) continue;
+
+    if ((independent.count(loopIds[innermost]) > 0) || (independent.count(dummyId) > 0)) {
+      nest.batched.push_back(v);
+      nest.batchedIds.insert(v->getId());
+    } else
+      nest.hoisted.push_back(v);
+  }
+  SCHNEK_TRACE_LOG(3, "Loop nest with " << nest.batched.size() << " variables in the innermost loop");
+  return nest;
+}
+
+void DependencyUpdater::updateLoop(const std::vector<double *> &loops, size_t level) {
+  if (!isValid) validate();
+  LoopNest &nest = getLoopNest(loops);
+  for (pVariable v : nest.levels[level]) v->evaluateExpression();
+  if (level == loops.size() - 1) {
+    for (pParameter p : dependentParameters) p->update();
+  }
+}
+
+DependencyUpdater::BatchProgram *DependencyUpdater::getBatchProgram(
+    LoopNest &nest, double *independent, pVariable dependent
+) {
+  std::map<Variable *, BatchProgram>::iterator it = nest.programs.find(dependent.get());
+  if (it == nest.programs.end()) {
+    BatchProgram batch;
+    batch.program = std::make_shared<BytecodeProgram>(batchWidth);
+    batch.output = -1;
+
+    // the read only variable of the independent parameter reads its value through the pointer
+    BytecodeCompiler compiler(*batch.program);
+    batch.input = compiler.input<double>();
+    compiler.bindExternal(independent, batch.input);
+
+    // only the variables needed by the dependent variable are evaluated
+    std::set<long> needed;
+    needed.insert(dependent->getId());
+    for (VariableList::reverse_iterator v = nest.batched.rbegin(); v != nest.batched.rend(); ++v) {
+      if (needed.count((*v)->getId()) == 0) continue;
+      const DependencyMap::DependencySet &dependsOn = dependencies->dependencies[(*v)->getId()].dependsOn;
+      needed.insert(dependsOn.begin(), dependsOn.end());
+    }
+
+    // the variables of the outer loops are loaded from the variables
+    BytecodeCompilerVisitor visit(compiler);
+    try {
+      for (pVariable v : nest.batched) {
+        if (needed.count(v->getId()) == 0) continue;
+        int reg = boost::apply_visitor(visit, v->getExpression());
+        compiler.bind(v.get(), reg);
+        if (v == dependent) batch.output = reg;
+      }
+    } catch (BytecodeException &) {
+      batch.output = -1;
+    }
+    if (!compiler.isBatchable()) batch.output = -1;
+
+    SCHNEK_TRACE_LOG(3, "Batch program with " << batch.program->getInstructions().size() << " instructions");
+    it = nest.programs.insert(std::make_pair(dependent.get(), batch)).first;
+  }
+  return (it->second.output < 0) ? nullptr : &it->second;
+}
+
 void DependencyUpdater::addIndependent(pParameter p) {
   assert(p->getVariable()->isReadOnly());
   independentVars.insert(p->getVariable());
+
+  // loops over independent values refer to the parameters by the pointers to their values
+  if (std::shared_ptr<ConcreteParameter<double> > param = std::dynamic_pointer_cast<ConcreteParameter<double> >(p))
+    independentValues[param->getValuePointer()] = p->getVariable();
+  else if (std::shared_ptr<ConcreteParameter<int> > param = std::dynamic_pointer_cast<ConcreteParameter<int> >(p))
+    independentValues[param->getValuePointer()] = p->getVariable();
   isValid = false;
 }
 
@@ -28,6 +28,7 @@
 #define SCHNEK_DEPENDENCIES_HPP_
 
 #include "blockparameters.hpp"
+#include "bytecode.hpp"
 #include "variables.hpp"
 
 #pragma GCC diagnostic push
@@ -37,10 +38,13 @@
 
 #pragma GCC diagnostic pop
 
+#include <algorithm>
 #include <list>
 #include <map>
 #include <memory>
 #include <set>
+#include <utility>
+#include <vector>
 
 namespace schnek {
 
@@ -117,6 +121,52 @@ namespace schnek {
       pDependencyMap dependencies;
       bool isValid;
 
+      /// The variables of the independent parameters indexed by the pointers to their values
+      std::map<const void *, pVariable> independentValues;
+      /// The ids of the independent variables each variable in the update list depends on
+      std::map<long, std::set<long> > independentDependencies;
+
+      /// A program evaluating the update list for many values of one independent variable
+      struct BatchProgram {
+          std::shared_ptr<BytecodeProgram> program;
+          int input;
+          /// The register of the dependent variable, negative if the program cannot be used
+          int output;
+      };
+
+      /** The update list split between the levels of a loop nest over independent values
+       *
+       * The variables are evaluated in the innermost loop whose value they depend
+       * on. Variables that do not depend on any of the values belong to the
+       * outermost loop.
+       */
+      struct LoopNest {
+          std::vector<VariableList> levels;
+          /// The variables of the innermost loop that do not depend on its value
+          VariableList hoisted;
+          /// The variables of the innermost loop that depend on its value
+          VariableList batched;
+          std::set<long> batchedIds;
+          /// False if one of the values is not an independent parameter, all variables are then batched
+          /// and evaluated for every value without a batch program
+          bool batchable;
+          /// The batch programs indexed by the dependent variable
+          std::map<Variable *, BatchProgram> programs;
+      };
+      typedef std::map<std::vector<double *>, LoopNest> LoopNestMap;
+      LoopNestMap loopNests;
+
+      /// The number of values evaluated by a single run of a batch program
+      static const size_t batchWidth = 64;
+
+      /// Creates the update list after independent or dependent variables have changed
+      void validate();
+
+      LoopNest &getLoopNest(const std::vector<double *> &loops);
+
+      /// Returns nullptr if the batched variables of the loop nest cannot be evaluated in batches
+      BatchProgram *getBatchProgram(LoopNest &nest, double *independent, pVariable dependent);
+
     public:
       DependencyUpdater(pDependencyMap dependencies_);
       void addIndependent(pParameter v);
@@ -135,18 +185,111 @@ namespace schnek {
 
       /** Updates the dependent variables and all the variables needed to evaluate them.
        *
+       *  The variables in the update list are compiled into bytecode when the list is created.
        *  This method is inline because it is potentially speed critical.
        */
       void update() {
-        if (!isValid) {
-          dependencies->makeUpdateList(independentVars, dependentVars, updateList);
-          isValid = true;
-        }
+        if (!isValid) validate();
         for (pVariable v : updateList) v->evaluateExpression();
         for (pParameter p : dependentParameters) p->update();
       }
+
+      /** Updates the variables of one level of a loop nest over independent values
+       *
+       * `loops` holds the values of independent parameters changed by nested
+       * loops, from the outermost to the innermost loop, e.g. the coordinates.
+       * After the value `loops[level]` has changed, this evaluates the variables
+       * that depend on it but not on the values of the inner loops. Those
+       * variables are evaluated when the inner loops call updateLoop. This
+       * moves loop invariant parts of the expressions out of the inner loops.
+       * The dependent parameters are updated after the innermost level.
+       */
+      void updateLoop(const std::vector<double *> &loops, size_t level);
+
+      /** Evaluates one dependent parameter for many values of the innermost loop of a loop nest
+       *
+       * This is equivalent to setting `*loops.back() = values[j]`, calling
+       * `updateLoop(loops, loops.size() - 1)` and storing `value` in `results[j]`
+       * for all j < count. The variables of the outer loops must be up to date,
+       * see updateLoop. The variables that depend on the innermost value are
+       * compiled into a bytecode program that evaluates many values at once.
+       * If this is not possible, e.g. because an expression has to be evaluated
+       * at every update, the variables are evaluated for every value.
+       *
+       * @param loops    the values of the independent parameters of the loop nest
+       * @param values   the values of the innermost independent parameter
+       * @param count    the number of values
+       * @param value    the value of a dependent parameter
+       * @param results  receives the values of the dependent parameter
+       *
+       * The variables and the other dependent parameters are not guaranteed to be updated.
+       */
+      template<typename T>
+      void updateBatch(const std::vector<double *> &loops, const double *values, size_t count, T &value, T *results);
+
+      /** Evaluates one dependent parameter for many values of an independent variable
+       *
+       * This is equivalent to setting `*independent = values[j]`, calling update() and
+       * storing `value` in `results[j]` for all j < count.
+       *
+       * @param independent  the value of an independent parameter, e.g. one of the coordinates
+       */
+      template<typename T>
+      void updateBatch(double *independent, const double *values, size_t count, T &value, T *results) {
+        updateBatch(std::vector<double *>(1, independent), values, count, value, results);
+      }
   };
 
+  template<typename T>
+  void DependencyUpdater::updateBatch(
+      const std::vector<double *> &loops, const double *values, size_t count, T &value, T *results
+  ) {
+    if (!isValid) validate();
+    LoopNest &nest = getLoopNest(loops);
+    double *independent = loops.back();
+
+    for (pVariable v : nest.hoisted) v->evaluateExpression();
+
+    pParameter dependent;
+    for (pParameter p : dependentParameters) {
+      std::shared_ptr<ConcreteParameter<T> > param = std::dynamic_pointer_cast<ConcreteParameter<T> >(p);
+      if (param && (param->getValuePointer() == &value)) dependent = p;
+    }
+
+    // the value does not change within the innermost loop
+    if (dependent && (nest.batchedIds.count(dependent->getVariable()->getId()) == 0)) {
+      dependent->update();
+      std::fill(results, results + count, value);
+      return;
+    }
+
+    BatchProgram *batch = nullptr;
+    if constexpr (BytecodeCompiler::supports<T>()) {
+      if (dependent && nest.batchable) batch = getBatchProgram(nest, independent, dependent->getVariable());
+    }
+
+    if (!batch) {
+      double original = *independent;
+      for (size_t j = 0; j < count; ++j) {
+        *independent = values[j];
+        for (pVariable v : nest.batched) v->evaluateExpression();
+        for (pParameter p : dependentParameters) p->update();
+        results[j] = value;
+      }
+      *independent = original;
+      return;
+    }
+
+    BytecodeProgram &program = *batch->program;
+    for (size_t start = 0; start < count; start += batchWidth) {
+      size_t n = std::min(batchWidth, count - start);
+      std::copy(values + start, values + start + n, program.getValues<double>(batch->input));
+      program.run(n);
+      const T *output = program.getValues<T>(batch->output);
+      std::copy(output, output + n, results + start);
+    }
+  }
+
   typedef std::shared_ptr<DependencyUpdater> pDependencyUpdater;
 
 }  // namespace schnek
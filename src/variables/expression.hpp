@@ -28,6 +28,8 @@
 #define SCHNEK_EXPRESSION_HPP_
 
 #include "../util/logger.hpp"
+#include "bytecode.hpp"
+#include "simplifier.hpp"
 #include "variables.hpp"
 
 #pragma GCC diagnostic push
@@ -49,9 +51,12 @@
 #pragma GCC diagnostic pop
 
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <set>
 #include <string>
+#include <type_traits>
+#include <typeinfo>
 
 #undef LOGLEVEL
 #define LOGLEVEL 0
@@ -104,6 +109,21 @@ namespace schnek {
 
       virtual DependencyList getDependencies() { return DependencyList(); }
 
+      /** Adds the instructions evaluating the expression to the bytecode and returns the result register
+       *
+       * The default implementation calls eval() from within the bytecode.
+       */
+      virtual int compile(BytecodeCompiler &compiler) { return compiler.call<vtype>(this); }
+
+      /// Replaces the sub expressions by their simplified versions, see ExpressionSimplifier
+      virtual void simplify(ExpressionSimplifier &) {}
+
+      /// A hash of the structure of the expression, identical expressions have the same hash
+      virtual std::size_t hash() { return std::hash<Expression *>()(this); }
+
+      /// Returns true if both expressions always have the same value, sub expressions are compared by pointer
+      virtual bool isIdentical(Expression &other) { return this == &other; }
+
       /// A pointer to an Expression
       typedef std::shared_ptr<Expression> pExpression;
       typedef vtype ValueType;
@@ -138,6 +158,19 @@ namespace schnek {
       bool isConstant() { return true; }
       /// Return a reference to the value
       vtype &getReference() { return val; }
+      /// The value is stored in a register
+      int compile(BytecodeCompiler &compiler) { return compiler.constant(val); }
+
+      std::size_t hash() {
+        std::size_t seed = typeid(*this).hash_code();
+        ExpressionSimplifier::hashCombine(seed, val);
+        return seed;
+      }
+
+      bool isIdentical(Expression<vtype> &other) {
+        Value *value = dynamic_cast<Value *>(&other);
+        return value && ExpressionSimplifier::identical(val, value->val);
+      }
   };
 
   /** A special type of expresion that holds a reference to a variable.
@@ -175,6 +208,20 @@ namespace schnek {
         dep.insert(var->getId());
         return dep;
       }
+
+      /// The value of the variable is loaded into a register
+      int compile(BytecodeCompiler &compiler) { return compiler.load<vtype>(var.get()); }
+
+      std::size_t hash() {
+        std::size_t seed = typeid(*this).hash_code();
+        ExpressionSimplifier::hashCombine(seed, var.get());
+        return seed;
+      }
+
+      bool isIdentical(Expression<vtype> &other) {
+        ReferencedValue *value = dynamic_cast<ReferencedValue *>(&other);
+        return value && (var == value->var);
+      }
   };
 
   /** A special type of expresion that holds a reference to an external value
@@ -198,6 +245,20 @@ namespace schnek {
 
       /// The value of the external variable can change
       bool isConstant() { return false; }
+
+      /// The value is read through the pointer
+      int compile(BytecodeCompiler &compiler) { return compiler.external(var); }
+
+      std::size_t hash() {
+        std::size_t seed = typeid(*this).hash_code();
+        ExpressionSimplifier::hashCombine(seed, var);
+        return seed;
+      }
+
+      bool isIdentical(Expression<vtype> &other) {
+        ExternalValue *value = dynamic_cast<ExternalValue *>(&other);
+        return value && (var == value->var);
+      }
   };
 
   /** Unary operator expression
@@ -223,6 +284,22 @@ namespace schnek {
 
       /// returns the dependencies of the sub expression
       DependencyList getDependencies() { return expr->getDependencies(); }
+
+      /// compiles the sub expression followed by the operator
+      int compile(BytecodeCompiler &compiler) { return oper::compile(compiler, compiler.compile(*expr)); }
+
+      void simplify(ExpressionSimplifier &simplifier) { expr = simplifier.simplify(expr); }
+
+      std::size_t hash() {
+        std::size_t seed = typeid(*this).hash_code();
+        ExpressionSimplifier::hashCombine(seed, expr.get());
+        return seed;
+      }
+
+      bool isIdentical(Expression<vtype> &other) {
+        UnaryOp *op = dynamic_cast<UnaryOp *>(&other);
+        return op && (expr == op->expr);
+      }
   };
 
   template<class vtype>
@@ -323,6 +400,76 @@ namespace schnek {
         }
         return dependencies;
       }
+
+      /// compiles the operands in the same order as eval()
+      int compile(BytecodeCompiler &compiler) {
+        typedef typename oper::Positive opPositive;
+        typedef typename oper::Negative opNegative;
+        typename std::list<ExpressionInfo<vtype> >::iterator it = expressions.begin();
+        int reg = compiler.compile(*it->expression);
+
+        while (++it != expressions.end()) {
+          int arg = compiler.compile(*it->expression);
+          reg = it->positive ? opPositive::compile(compiler, reg, arg) : opNegative::compile(compiler, reg, arg);
+        }
+        return reg;
+      }
+
+      /** Simplifies the operands
+       *
+       * A leading sequence of constant operands, as in `2*pi/lambda*x`, is
+       * replaced by its value. Operands are not reordered, so that the result
+       * is not changed by rounding.
+       */
+      void simplify(ExpressionSimplifier &simplifier) {
+        typedef typename oper::Positive opPositive;
+        typedef typename oper::Negative opNegative;
+        size_t constants = 0;
+        bool leading = true;
+        for (ExpressionInfo<vtype> &exp : expressions) {
+          exp.expression = simplifier.simplify(exp.expression);
+          leading = leading && exp.expression->isConstant();
+          if (leading) ++constants;
+        }
+
+        // a constant expression is replaced as a whole
+        if ((constants < 2) || (constants == expressions.size())) return;
+
+        typename std::list<ExpressionInfo<vtype> >::iterator last = expressions.begin();
+        std::advance(last, constants);
+        try {
+          typename std::list<ExpressionInfo<vtype> >::iterator it = expressions.begin();
+          vtype val = it->expression->eval();
+          while (++it != last) {
+            val = it->positive ? opPositive::eval(val, it->expression->eval())
+                               : opNegative::eval(val, it->expression->eval());
+          }
+          expressions.erase(expressions.begin(), last);
+          expressions.push_front(ExpressionInfo<vtype>(true, simplifier.constant(val)));
+        } catch (SchnekException &) {
+          // the error is reported when the expression is evaluated
+        }
+      }
+
+      std::size_t hash() {
+        std::size_t seed = typeid(*this).hash_code();
+        for (ExpressionInfo<vtype> &exp : expressions) {
+          ExpressionSimplifier::hashCombine(seed, exp.positive);
+          ExpressionSimplifier::hashCombine(seed, exp.expression.get());
+        }
+        return seed;
+      }
+
+      bool isIdentical(Expression<vtype> &other) {
+        SelfType *op = dynamic_cast<SelfType *>(&other);
+        if (!op || (expressions.size() != op->expressions.size())) return false;
+        typename std::list<ExpressionInfo<vtype> >::iterator it = op->expressions.begin();
+        for (ExpressionInfo<vtype> &exp : expressions) {
+          if ((exp.positive != it->positive) || (exp.expression != it->expression)) return false;
+          ++it;
+        }
+        return true;
+      }
   };
 
   template<class vtype>
@@ -398,6 +545,94 @@ namespace schnek {
 
       /// returns the dependencies of the sub expression
       DependencyList getDependencies() { return expr->getDependencies(); }
+
+      /// numeric casts are compiled, conversions from and to strings call eval()
+      int compile(BytecodeCompiler &compiler) {
+        if constexpr (BytecodeCompiler::supports<vtype>() && BytecodeCompiler::supports<vtype_orig>()
+                      && !std::is_same<CastType<vtype>, LexicalCast<vtype> >::value)
+          return compiler.convert<vtype, vtype_orig>(compiler.compile(*expr));
+        else
+          return compiler.call<vtype>(this);
+      }
+
+      void simplify(ExpressionSimplifier &simplifier) { expr = simplifier.simplify(expr); }
+
+      std::size_t hash() {
+        std::size_t seed = typeid(*this).hash_code();
+        ExpressionSimplifier::hashCombine(seed, expr.get());
+        return seed;
+      }
+
+      bool isIdentical(Expression<vtype> &other) {
+        TypecastOp *op = dynamic_cast<TypecastOp *>(&other);
+        return op && (expr == op->expr);
+      }
+  };
+
+  /** An expression that is evaluated by running its bytecode
+   *
+   * The expression tree is compiled into a BytecodeProgram on construction. The
+   * tree is kept and supplies the dependencies and constancy of the expression.
+   * Only double and int expressions can be compiled.
+   */
+  template<typename vtype>
+  class CompiledExpression : public Expression<vtype> {
+    public:
+      typedef typename Expression<vtype>::pExpression pExpression;
+
+    private:
+      /// the original expression tree
+      pExpression expr;
+      BytecodeProgram program;
+
+    public:
+      CompiledExpression(pExpression expr_) : expr(expr_) {
+        BytecodeCompiler compiler(program);
+        compiler.compileProgram(*expr);
+      }
+
+      /// Run the bytecode and return the result
+      vtype eval() {
+        program.run();
+        return program.getValue<vtype>(program.getResult());
+      }
+
+      /// Constancy depends on the constancy of the original expression
+      bool isConstant() { return expr->isConstant(); }
+
+      /// returns the dependencies of the original expression
+      DependencyList getDependencies() { return expr->getDependencies(); }
+
+      /// compiles the original expression
+      int compile(BytecodeCompiler &compiler) { return expr->compile(compiler); }
+
+      /// returns the original expression
+      pExpression getExpression() { return expr; }
+
+      /// returns the bytecode
+      const BytecodeProgram &getProgram() { return program; }
+  };
+
+  /// Replaces double and int expressions by a CompiledExpression
+  struct ExpressionCompilerVisitor : public boost::static_visitor<ExpressionVariant> {
+      template<class vtype>
+      ExpressionVariant operator()(std::shared_ptr<Expression<vtype> > e) {
+        if constexpr (BytecodeCompiler::supports<vtype>()) {
+          if (std::dynamic_pointer_cast<CompiledExpression<vtype> >(e)) return e;
+          return std::shared_ptr<Expression<vtype> >(new CompiledExpression<vtype>(e));
+        } else
+          return e;
+      }
+  };
+
+  /// Adds the instructions of an expression to a program and returns the register of its value
+  struct BytecodeCompilerVisitor : public boost::static_visitor<int> {
+      BytecodeCompiler &compiler;
+      BytecodeCompilerVisitor(BytecodeCompiler &compiler_) : compiler(compiler_) {}
+      template<class ExpressionPointer>
+      int operator()(ExpressionPointer e) {
+        return compiler.compile(*e);
+      }
   };
 
   struct DependenciesGetter : public boost::static_visitor<DependencyList> {
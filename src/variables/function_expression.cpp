@@ -56,40 +56,40 @@ namespace schnek {
 using namespace schnek;
 
 void schnek::registerCMath(FunctionRegistry &freg) {
-  freg.registerFunction("cos", static_cast<double (*)(double)>(cos));
-  freg.registerFunction("sin", static_cast<double (*)(double)>(sin));
-  freg.registerFunction("tan", static_cast<double (*)(double)>(tan));
-  freg.registerFunction("acos", static_cast<double (*)(double)>(acos));
-  freg.registerFunction("asin", static_cast<double (*)(double)>(asin));
-  freg.registerFunction("atan", static_cast<double (*)(double)>(atan));
-  freg.registerFunction("atan2", static_cast<double (*)(double, double)>(atan2));
+  freg.registerFunction("cos", static_cast<double (*)(double)>(cos), false, BytecodeOp::Cos);
+  freg.registerFunction("sin", static_cast<double (*)(double)>(sin), false, BytecodeOp::Sin);
+  freg.registerFunction("tan", static_cast<double (*)(double)>(tan), false, BytecodeOp::Tan);
+  freg.registerFunction("acos", static_cast<double (*)(double)>(acos), false, BytecodeOp::Acos);
+  freg.registerFunction("asin", static_cast<double (*)(double)>(asin), false, BytecodeOp::Asin);
+  freg.registerFunction("atan", static_cast<double (*)(double)>(atan), false, BytecodeOp::Atan);
+  freg.registerFunction("atan2", static_cast<double (*)(double, double)>(atan2), false, BytecodeOp::Atan2);
 
-  freg.registerFunction("cosh", static_cast<double (*)(double)>(cosh));
-  freg.registerFunction("sinh", static_cast<double (*)(double)>(sinh));
-  freg.registerFunction("tanh", static_cast<double (*)(double)>(tanh));
+  freg.registerFunction("cosh", static_cast<double (*)(double)>(cosh), false, BytecodeOp::Cosh);
+  freg.registerFunction("sinh", static_cast<double (*)(double)>(sinh), false, BytecodeOp::Sinh);
+  freg.registerFunction("tanh", static_cast<double (*)(double)>(tanh), false, BytecodeOp::Tanh);
 
-  freg.registerFunction("exp", static_cast<double (*)(double)>(exp));
+  freg.registerFunction("exp", static_cast<double (*)(double)>(exp), false, BytecodeOp::Exp);
   freg.registerFunction("ldexp", static_cast<double (*)(double, int)>(ldexp));
-  freg.registerFunction("log", static_cast<double (*)(double)>(log));
-  freg.registerFunction("log10", static_cast<double (*)(double)>(log10));
+  freg.registerFunction("log", static_cast<double (*)(double)>(log), false, BytecodeOp::Log);
+  freg.registerFunction("log10", static_cast<double (*)(double)>(log10), false, BytecodeOp::Log10);
 
   //  The function frexp and modf take pointers as arguments and have side effects
   //  This behaviour is not supported
   //  freg.registerFunction("frexp", frexp);
   //  freg.registerFunction("modf", modf);
 
-  freg.registerFunction("pow", static_cast<double (*)(double, double)>(pow));
-  freg.registerFunction("sqrt", static_cast<double (*)(double)>(sqrt));
+  freg.registerFunction("pow", static_cast<double (*)(double, double)>(pow), false, BytecodeOp::Power);
+  freg.registerFunction("sqrt", static_cast<double (*)(double)>(sqrt), false, BytecodeOp::Sqrt);
 
-  freg.registerFunction("ceil", static_cast<double (*)(double)>(ceil));
-  freg.registerFunction("fabs", static_cast<double (*)(double)>(fabs));
-  freg.registerFunction("floor", static_cast<double (*)(double)>(floor));
-  freg.registerFunction("fmod", static_cast<double (*)(double, double)>(fmod));
+  freg.registerFunction("ceil", static_cast<double (*)(double)>(ceil), false, BytecodeOp::Ceil);
+  freg.registerFunction("fabs", static_cast<double (*)(double)>(fabs), false, BytecodeOp::Fabs);
+  freg.registerFunction("floor", static_cast<double (*)(double)>(floor), false, BytecodeOp::Floor);
+  freg.registerFunction("fmod", static_cast<double (*)(double, double)>(fmod), false, BytecodeOp::Fmod);
 }
 
 void schnek::registerUtilityFunctions(FunctionRegistry &freg) {
-  freg.registerFunction("min", schnek::internal::min);
-  freg.registerFunction("max", schnek::internal::max);
+  freg.registerFunction("min", schnek::internal::min, false, BytecodeOp::Min);
+  freg.registerFunction("max", schnek::internal::max, false, BytecodeOp::Max);
   freg.registerFunction("minI", schnek::internal::minI);
   freg.registerFunction("maxI", schnek::internal::maxI);
 }
@@ -27,6 +27,8 @@
 #ifndef FUNCTION_EXPRESSION_HPP_
 #define FUNCTION_EXPRESSION_HPP_
 
+#include <array>
+#include <boost/function_types/function_arity.hpp>
 #include <boost/mpl/begin.hpp>
 #include <boost/mpl/deref.hpp>
 #include <boost/mpl/end.hpp>
@@ -42,6 +44,13 @@ namespace schnek {
 
   typedef std::list<ExpressionVariant> ExpressionList;
 
+  /** The vector overload of a function of double arguments
+   *
+   * Evaluates the function for count values, args[i][j] is the i-th argument
+   * of the j-th value.
+   */
+  typedef void (*VectorFunction)(size_t count, const double *const *args, double *result);
+
   template<typename vtype>
   struct ExpressionConverterVisitor : public boost::static_visitor<ExpressionVariant> {
       typedef typename std::shared_ptr<Expression<vtype> > VarExpressionPointer;
@@ -56,7 +65,7 @@ namespace schnek {
   };
 
   template<class vtype, typename func>
-  class FunctionExpression : public Expression<vtype> {
+  class FunctionExpression : public Expression<vtype>, public BytecodeFunction {
     public:
       typedef typename bft::result_type<func>::type rtype;
 
@@ -74,12 +83,47 @@ namespace schnek {
           }
       };
 
+      struct compileVisitor : public boost::static_visitor<int> {
+          BytecodeCompiler &compiler;
+          compileVisitor(BytecodeCompiler &compiler_) : compiler(compiler_) {}
+          template<class ExpressionPointer>
+          int operator()(ExpressionPointer e) {
+            return compiler.compile(*e);
+          }
+      };
+
+      struct simplifyVisitor : public boost::static_visitor<ExpressionVariant> {
+          ExpressionSimplifier &simplifier;
+          simplifyVisitor(ExpressionSimplifier &simplifier_) : simplifier(simplifier_) {}
+          template<class ExpressionPointer>
+          ExpressionVariant operator()(ExpressionPointer e) {
+            return simplifier.simplify(e);
+          }
+      };
+
+      struct pointerVisitor : public boost::static_visitor<const void *> {
+          template<class ExpressionPointer>
+          const void *operator()(ExpressionPointer e) {
+            return e.get();
+          }
+      };
+
       ExpressionList args;
       func f;
       bool updateAlways;
+      /// The instruction replacing the function call, BytecodeOp::Call if there is none
+      BytecodeOp bytecode;
+      /// The vector overload of the function, if any
+      VectorFunction vectorFunction;
 
     public:
-      FunctionExpression(func f_, ExpressionList &args_, bool updateAlways);
+      FunctionExpression(
+          func f_,
+          ExpressionList &args_,
+          bool updateAlways,
+          BytecodeOp bytecode = BytecodeOp::Call,
+          VectorFunction vectorFunction = nullptr
+      );
 
       /// Return the modified value
       vtype eval();
@@ -87,6 +131,23 @@ namespace schnek {
       bool isConstant();
 
       DependencyList getDependencies();
+
+      /** Built-in functions are compiled into a single instruction
+       *
+       * Other functions of int and double arguments are evaluated by a
+       * Function instruction that reads the arguments from registers.
+       */
+      int compile(BytecodeCompiler &compiler);
+
+      /// Evaluates the function for the values of the argument registers
+      void evaluate(const BytecodeRegisters &registers, const int *argRegisters, int result, size_t count);
+
+      void simplify(ExpressionSimplifier &simplifier);
+
+      std::size_t hash();
+
+      /// Calls are identical if they call the same function pointer with identical arguments
+      bool isIdentical(Expression<vtype> &other);
   };
 
   template<
@@ -99,6 +160,12 @@ namespace schnek {
   template<class vtype, typename func, typename to>
   struct FunctionExpressionConverter<vtype, func, to, to> {
       typedef typename bft::result_type<func>::type rtype;
+
+      /// true if all arguments can be held in bytecode registers
+      static constexpr bool registersSupported = true;
+      /// true if all arguments are double
+      static constexpr bool allDouble = true;
+
       static void makeList(ExpressionList::iterator var, ExpressionList::iterator end, ExpressionList &) {
         if (var != end) throw WrongNumberOfArgsException();
       }
@@ -107,6 +174,11 @@ namespace schnek {
       static rtype evaluate(func f, ExpressionList::iterator, ArgType const &sArgs) {
         return fusion::invoke(f, sArgs);
       }
+
+      template<typename ArgType>
+      static rtype evaluateRegisters(func f, const BytecodeRegisters &, const int *, size_t, ArgType const &sArgs) {
+        return fusion::invoke(f, sArgs);
+      }
   };
 
   template<class vtype, typename func, typename from, typename to>
@@ -114,6 +186,11 @@ namespace schnek {
       typedef typename bft::result_type<func>::type rtype;
       typedef typename mpl::deref<from>::type arg_type;
       typedef typename mpl::next<from>::type next_type_iter;
+      typedef FunctionExpressionConverter<vtype, func, next_type_iter, to> Next;
+
+      static constexpr bool registersSupported =
+          BytecodeCompiler::supports<arg_type>() && Next::registersSupported;
+      static constexpr bool allDouble = std::is_same<arg_type, double>::value && Next::allDouble;
 
       static void makeList(ExpressionList::iterator var, ExpressionList::iterator end, ExpressionList &args) {
         if (var == end) throw WrongNumberOfArgsException();
@@ -135,11 +212,23 @@ namespace schnek {
             f, var, fusion::push_back(sArgs, expr->eval())
         );
       }
+
+      /// evaluates the function for the j-th values of the argument registers
+      template<typename ArgType>
+      static rtype evaluateRegisters(
+          func f, const BytecodeRegisters &registers, const int *args, size_t j, ArgType const &sArgs
+      ) {
+        return Next::evaluateRegisters(
+            f, registers, args + 1, j, fusion::push_back(sArgs, registers.get<arg_type>(*args)[j])
+        );
+      }
   };
 
   template<class vtype, typename func>
-  FunctionExpression<vtype, func>::FunctionExpression(func f_, ExpressionList &args_, bool updateAlways_)
-      : f(f_), updateAlways(updateAlways_) {
+  FunctionExpression<vtype, func>::FunctionExpression(
+      func f_, ExpressionList &args_, bool updateAlways_, BytecodeOp bytecode_, VectorFunction vectorFunction_
+  )
+      : f(f_), updateAlways(updateAlways_), bytecode(bytecode_), vectorFunction(vectorFunction_) {
     FunctionExpressionConverter<vtype, func>::makeList(args_.begin(), args_.end(), args);
   }
 
@@ -173,6 +262,69 @@ namespace schnek {
     return result;
   }
 
+  template<class vtype, typename func>
+  int FunctionExpression<vtype, func>::compile(BytecodeCompiler &compiler) {
+    if constexpr (BytecodeCompiler::supports<vtype>() && FunctionExpressionConverter<vtype, func>::registersSupported) {
+      std::vector<int> argRegisters;
+      compileVisitor visit(compiler);
+      for (ExpressionVariant ex : args) {
+        argRegisters.push_back(boost::apply_visitor(visit, ex));
+      }
+      if (bytecode != BytecodeOp::Call) return compiler.builtin(bytecode, argRegisters);
+      return compiler.function<vtype>(this, argRegisters);
+    } else
+      return compiler.call<vtype>(this);
+  }
+
+  template<class vtype, typename func>
+  void FunctionExpression<vtype, func>::evaluate(
+      const BytecodeRegisters &registers, const int *argRegisters, int result, size_t count
+  ) {
+    typedef FunctionExpressionConverter<vtype, func> Converter;
+    if constexpr (BytecodeCompiler::supports<vtype>() && Converter::registersSupported) {
+      vtype *values = registers.get<vtype>(result);
+      if constexpr (Converter::allDouble && std::is_same<vtype, double>::value) {
+        if (vectorFunction) {
+          std::array<const double *, bft::function_arity<func>::value> argValues;
+          for (size_t i = 0; i < argValues.size(); ++i) argValues[i] = registers.get<double>(argRegisters[i]);
+          vectorFunction(count, argValues.data(), values);
+          return;
+        }
+      }
+      for (size_t j = 0; j < count; ++j) {
+        values[j] = Converter::evaluateRegisters(f, registers, argRegisters, j, fusion::nil());
+      }
+    }
+  }
+
+  template<class vtype, typename func>
+  void FunctionExpression<vtype, func>::simplify(ExpressionSimplifier &simplifier) {
+    simplifyVisitor visit(simplifier);
+    for (ExpressionVariant &ex : args) {
+      ex = boost::apply_visitor(visit, ex);
+    }
+  }
+
+  template<class vtype, typename func>
+  std::size_t FunctionExpression<vtype, func>::hash() {
+    std::size_t seed = typeid(*this).hash_code();
+    if constexpr (std::is_pointer<func>::value) ExpressionSimplifier::hashCombine(seed, f);
+    pointerVisitor visit;
+    for (ExpressionVariant &ex : args) {
+      ExpressionSimplifier::hashCombine(seed, boost::apply_visitor(visit, ex));
+    }
+    return seed;
+  }
+
+  template<class vtype, typename func>
+  bool FunctionExpression<vtype, func>::isIdentical(Expression<vtype> &other) {
+    if constexpr (std::is_pointer<func>::value) {
+      FunctionExpression *call = dynamic_cast<FunctionExpression *>(&other);
+      return call && (f == call->f) && (updateAlways == call->updateAlways) && (args == call->args);
+    } else
+      return this == &other;
+  }
+
   class FunctionRegistry {
     private:
       class EntryBase {
@@ -191,12 +343,17 @@ namespace schnek {
 
           func f;
           bool updateAlways;
+          BytecodeOp bytecode;
+          VectorFunction vectorFunction;
 
         public:
-          Entry(func f_, bool updateAlways_) : f(f_), updateAlways(updateAlways_) {}
+          Entry(func f_, bool updateAlways_, BytecodeOp bytecode_, VectorFunction vectorFunction_ = nullptr)
+              : f(f_), updateAlways(updateAlways_), bytecode(bytecode_), vectorFunction(vectorFunction_) {}
 
           ExpressionVariant getExpression(ExpressionList &args) {
-            std::shared_ptr<Expression<rtype> > eP(new FunctionExpression<rtype, func>(f, args, updateAlways));
+            std::shared_ptr<Expression<rtype> > eP(
+                new FunctionExpression<rtype, func>(f, args, updateAlways, bytecode, vectorFunction)
+            );
             return eP;
           }
       };
@@ -208,9 +365,34 @@ namespace schnek {
       FunctionRegistry() : funcs(new FExprMap) {}
       FunctionRegistry(const FunctionRegistry &reg) : funcs(reg.funcs) {}
 
+      /** Register a function under the given name
+       *
+       * Functions with updateAlways set are evaluated again whenever the
+       * dependent variables are updated. Built-in functions pass the bytecode
+       * instruction that computes the same result as f, see BytecodeCompiler.
+       */
       template<typename func>
-      void registerFunction(std::string fname, func f, bool updateAlways = false) {
-        pEntryBase eB(new Entry<func>(f, updateAlways));
+      void registerFunction(
+          std::string fname, func f, bool updateAlways = false, BytecodeOp bytecode = BytecodeOp::Call
+      ) {
+        pEntryBase eB(new Entry<func>(f, updateAlways, bytecode));
+        (*funcs)[fname] = eB;
+      }
+
+      /** Register a function of double arguments together with its vector overload
+       *
+       * The function f is used when single values are evaluated. When the
+       * expression is evaluated for many values at once, see
+       * DependencyUpdater::updateBatch, vf is called for all values.
+       */
+      template<typename func>
+      void registerVectorFunction(std::string fname, func f, VectorFunction vf) {
+        static_assert(
+            FunctionExpressionConverter<double, func>::allDouble
+                && std::is_same<typename bft::result_type<func>::type, double>::value,
+            "Vector overloads are only supported for functions of double arguments"
+        );
+        pEntryBase eB(new Entry<func>(f, false, BytecodeOp::Call, vf));
         (*funcs)[fname] = eB;
       }
 
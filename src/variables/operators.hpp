@@ -42,16 +42,23 @@ namespace schnek {
     template<class vtype>
     struct OperatorId {
         static vtype eval(vtype val);
+        static int compile(BytecodeCompiler &, int a) { return a; }
     };
 
     template<class vtype>
     struct OperatorNeg {
         static vtype eval(vtype val);
+        static int compile(BytecodeCompiler &compiler, int a) {
+          return compiler.arithmetic<vtype>(BytecodeOp::Negate, a);
+        }
     };
 
     template<class vtype>
     struct OperatorInv {
         static vtype eval(vtype val);
+        static int compile(BytecodeCompiler &compiler, int a) {
+          return compiler.arithmetic<vtype>(BytecodeOp::Invert, a);
+        }
     };
 
     template<class vtype>
@@ -65,6 +72,9 @@ namespace schnek {
         typedef OperatorSubtract<vtype> Inverted;
 
         static vtype eval(vtype val1, vtype val2);
+        static int compile(BytecodeCompiler &compiler, int a, int b) {
+          return compiler.arithmetic<vtype>(BytecodeOp::Add, a, b);
+        }
         static typename Expression<vtype>::pExpression negate(typename Expression<vtype>::pExpression val);
     };
 
@@ -76,6 +86,9 @@ namespace schnek {
         typedef OperatorAdd<vtype> Inverted;
 
         static vtype eval(vtype val1, vtype val2);
+        static int compile(BytecodeCompiler &compiler, int a, int b) {
+          return compiler.arithmetic<vtype>(BytecodeOp::Subtract, a, b);
+        }
         static typename Expression<vtype>::pExpression negate(typename Expression<vtype>::pExpression val);
     };
 
@@ -90,6 +103,9 @@ namespace schnek {
         typedef OperatorDivide<vtype> Inverted;
 
         static vtype eval(vtype val1, vtype val2);
+        static int compile(BytecodeCompiler &compiler, int a, int b) {
+          return compiler.arithmetic<vtype>(BytecodeOp::Multiply, a, b);
+        }
         static typename Expression<vtype>::pExpression negate(typename Expression<vtype>::pExpression val);
     };
 
@@ -101,6 +117,9 @@ namespace schnek {
         typedef OperatorMultiply<vtype> Inverted;
 
         static vtype eval(vtype val1, vtype val2);
+        static int compile(BytecodeCompiler &compiler, int a, int b) {
+          return compiler.arithmetic<vtype>(BytecodeOp::Divide, a, b);
+        }
         static typename Expression<vtype>::pExpression negate(typename Expression<vtype>::pExpression val);
     };
 
@@ -112,6 +131,9 @@ namespace schnek {
         typedef OperatorExponent<vtype> Inverted;
 
         static vtype eval(vtype val1, vtype val2);
+        static int compile(BytecodeCompiler &compiler, int a, int b) {
+          return compiler.arithmetic<vtype>(BytecodeOp::Power, a, b);
+        }
         static typename Expression<vtype>::pExpression negate(typename Expression<vtype>::pExpression val);
     };
 
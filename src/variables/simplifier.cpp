@@ -0,0 +1,59 @@
+/*
+ * simplifier.cpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "simplifier.hpp"
+
+#include "expression.hpp"
+
+using namespace schnek;
+
+namespace {
+
+  struct SimplifyVisitor : public boost::static_visitor<ExpressionVariant> {
+      ExpressionSimplifier &simplifier;
+      SimplifyVisitor(ExpressionSimplifier &simplifier_) : simplifier(simplifier_) {}
+      template<class ExpressionPointer>
+      ExpressionVariant operator()(ExpressionPointer e) {
+        return simplifier.simplify(e);
+      }
+  };
+
+}  // namespace
+
+ExpressionVariant ExpressionSimplifier::simplify(const ExpressionVariant &expression) {
+  SimplifyVisitor visit(*this);
+  return boost::apply_visitor(visit, expression);
+}
+
+void ExpressionSimplifier::simplify(pBlockVariables block) {
+  for (VariableMap::value_type it : block->getVariables()) {
+    it.second->simplify(*this);
+  }
+
+  for (pBlockVariables child : block->getChildren()) {
+    simplify(child);
+  }
+}
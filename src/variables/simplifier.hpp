@@ -0,0 +1,170 @@
+/*
+ * simplifier.hpp
+ *
+ * Created on: 18 Oct 2026
+ * Author: Holger Schmitz
+ * Email: holger@notjustphysics.com
+ *
+ * Copyright 2026 Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCHNEK_SIMPLIFIER_HPP_
+#define SCHNEK_SIMPLIFIER_HPP_
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+
+#include "types.hpp"
+#include "variables.hpp"
+
+namespace schnek {
+
+  template<typename vtype>
+  class Value;
+
+  /** Simplifies the expression trees created by the parser
+   *
+   * Constant sub expressions are evaluated once and replaced by Value
+   * expressions. Identical sub expressions are replaced by a single shared
+   * instance. Two expressions are identical if they are of the same type, hold
+   * the same values and their sub expressions are identical. Because the sub
+   * expressions are simplified first, the latter only requires comparing
+   * pointers, see Expression::hash and Expression::isIdentical.
+   *
+   * Expressions depending on functions that are evaluated at every update are
+   * neither folded nor shared.
+   */
+  class ExpressionSimplifier {
+    private:
+      template<typename vtype>
+      struct Tables {
+          typedef std::shared_ptr<Expression<vtype> > pExpression;
+          /// The shared expressions indexed by their hash
+          std::unordered_multimap<std::size_t, pExpression> shared;
+          /// The expressions that have already been simplified, the keys are kept alive so that their addresses
+          /// cannot be reused by new expressions
+          std::unordered_map<pExpression, pExpression> simplified;
+      };
+
+      std::tuple<Tables<int>, Tables<double>, Tables<std::string> > tables;
+      int foldedCount;
+      int sharedCount;
+
+      template<typename vtype>
+      Tables<vtype> &getTables() {
+        return std::get<Tables<vtype> >(tables);
+      }
+
+      /// Returns the shared expression identical to the expression
+      template<typename vtype>
+      std::shared_ptr<Expression<vtype> > share(std::shared_ptr<Expression<vtype> > expression);
+
+    public:
+      ExpressionSimplifier() : foldedCount(0), sharedCount(0) {}
+
+      /// Returns the simplified expression, the sub expressions of the expression are replaced
+      template<typename vtype>
+      std::shared_ptr<Expression<vtype> > simplify(std::shared_ptr<Expression<vtype> > expression);
+
+      ExpressionVariant simplify(const ExpressionVariant &expression);
+
+      /// Simplifies the expressions of all variables in the block and its children
+      void simplify(pBlockVariables block);
+
+      /// Returns a shared Value expression, this is used when folding parts of an expression
+      template<typename vtype>
+      std::shared_ptr<Expression<vtype> > constant(const vtype &value);
+
+      /// The number of sub expressions that have been replaced by their value
+      int getFolded() const { return foldedCount; }
+
+      /// The number of sub expressions that have been replaced by an identical one
+      int getShared() const { return sharedCount; }
+
+      /// Combines the hash of a value into the seed
+      template<typename T>
+      static void hashCombine(std::size_t &seed, const T &value) {
+        seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      }
+
+      /// Compares two values, floating point values are compared bitwise so that 0.0 and -0.0 differ
+      template<typename T>
+      static bool identical(const T &a, const T &b) {
+        if constexpr (std::is_floating_point<T>::value)
+          return std::memcmp(&a, &b, sizeof(T)) == 0;
+        else
+          return a == b;
+      }
+  };
+
+  template<typename vtype>
+  std::shared_ptr<Expression<vtype> > ExpressionSimplifier::share(std::shared_ptr<Expression<vtype> > expression) {
+    Tables<vtype> &t = getTables<vtype>();
+    std::size_t hash = expression->hash();
+    auto range = t.shared.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second->isIdentical(*expression)) {
+        if (it->second != expression) ++sharedCount;
+        return it->second;
+      }
+    }
+    t.shared.insert(std::make_pair(hash, expression));
+    return expression;
+  }
+
+  template<typename vtype>
+  std::shared_ptr<Expression<vtype> > ExpressionSimplifier::simplify(std::shared_ptr<Expression<vtype> > expression) {
+    if (!expression) return expression;
+    Tables<vtype> &t = getTables<vtype>();
+    auto done = t.simplified.find(expression);
+    if (done != t.simplified.end()) return done->second;
+
+    std::shared_ptr<Expression<vtype> > result = expression;
+    expression->simplify(*this);
+
+    // expressions that have to be evaluated at every update stay unchanged
+    if (expression->getDependencies().count(-1) == 0) {
+      if (expression->isConstant() && !dynamic_cast<Value<vtype> *>(expression.get())) {
+        try {
+          result = constant<vtype>(expression->eval());
+        } catch (SchnekException &) {
+          // the error is reported when the expression is evaluated
+        }
+      }
+      result = share(result);
+    }
+
+    t.simplified[expression] = result;
+    return result;
+  }
+
+  template<typename vtype>
+  std::shared_ptr<Expression<vtype> > ExpressionSimplifier::constant(const vtype &value) {
+    ++foldedCount;
+    return share(std::shared_ptr<Expression<vtype> >(new Value<vtype>(value)));
+  }
+
+}  // namespace schnek
+
+#endif  // SCHNEK_SIMPLIFIER_HPP_
@@ -113,6 +113,18 @@ const ValueVariant &Variable::evaluateExpression() {
   return var;
 }
 
+void Variable::compile() {
+  // read only variables hold external values which gain nothing from compiling
+  if (fixed || readonly) return;
+  ExpressionCompilerVisitor compiler;
+  expression = boost::apply_visitor(compiler, expression);
+}
+
+void Variable::simplify(ExpressionSimplifier &simplifier) {
+  if (fixed || readonly) return;
+  expression = simplifier.simplify(expression);
+}
+
 // -------------------------------------------------------------
 // BlockVariables
 // -------------------------------------------------------------
@@ -46,6 +46,7 @@
 namespace schnek {
 
   class BlockVariables;
+  class ExpressionSimplifier;
   typedef std::shared_ptr<BlockVariables> pBlockVariables;
   typedef std::list<pBlockVariables> BlockVariablesList;
 
@@ -103,11 +104,23 @@ namespace schnek {
       VariableTypeInfo getType() { return type; }
       /// returns the fixed value of the variable
       ValueVariant getValue() { return var; }
+      /// returns a reference to the value of the variable, this avoids copying the value
+      const ValueVariant &getValueReference() const { return var; }
       /// returns the expression kept in the variable
       const ExpressionVariant &getExpression() { return expression; }
       /// evaluetes the expression kept in the variable and returns the value
       const ValueVariant &evaluateExpression();
 
+      /** Replaces a double or int expression by its bytecode, see CompiledExpression
+       *
+       * This speeds up variables that are evaluated many times. Fixed values and
+       * read only variables are left unchanged.
+       */
+      void compile();
+
+      /// Simplifies the expression of the variable, see ExpressionSimplifier
+      void simplify(ExpressionSimplifier &simplifier);
+
       /// returns true if the value of the variable is constant and does not depend on non-constant variables
       bool isConstant() { return fixed; }
 
@@ -0,0 +1,108 @@
+/*
+ * test_hdf_checkpoint.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <diagnostic/hdfdiagnostic.hpp>
+
+#ifdef SCHNEK_HAVE_HDF5
+
+#include <grid/grid.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <cstring>
+
+BOOST_AUTO_TEST_SUITE( diagnostic )
+
+BOOST_AUTO_TEST_SUITE( hdf_checkpoint )
+
+typedef schnek::Grid<double, 2, schnek::GridNoArgCheck, schnek::SingleArrayGridStorageFortran> FortranGrid;
+typedef schnek::HDFCheckpoint<FortranGrid> Checkpoint;
+
+BOOST_AUTO_TEST_CASE( fortran_order_round_trip )
+{
+  FortranGrid::IndexType lo(-2, 1), hi(9, 6);
+  schnek::Range<int, 2> range(lo, hi);
+
+  FortranGrid base(lo, hi), field(lo, hi);
+  for (const FortranGrid::IndexType &pos : range)
+  {
+    base[pos] = 100.0*pos[0] + pos[1] + 0.25;
+    field[pos] = base[pos];
+  }
+  field(-2, 1) = -1.5;
+  field(3, 4) = 1e10;
+  field(9, 6) = 0.0;
+
+  Checkpoint::WordGrid bits;
+  Checkpoint::getBits(base, bits);
+  for (const FortranGrid::IndexType &pos : range)
+  {
+    double value = base[pos];
+    Checkpoint::Word word;
+    std::memcpy(&word, &value, sizeof(word));
+    BOOST_CHECK_EQUAL(bits[pos], word);
+  }
+
+  // write the difference in small chunks, so that unchanged chunks are skipped
+  const char *fileName = "test_hdf_checkpoint.h5";
+  schnek::GridContainer<Checkpoint::WordGrid> out;
+  Checkpoint::getDifference(field, bits, out.grid);
+  out.global_min = out.local_min = lo;
+  out.global_max = out.local_max = hi;
+
+  schnek::HdfDatasetOptions options;
+  options.chunk = {4, 4};
+  options.deflate = 1;
+  options.shuffle = true;
+
+  schnek::HdfOStream output(fileName);
+  output.setDatasetOptions(options);
+  output.setBlockName("field");
+  output.writeSparseGrid(out);
+  output.close();
+
+  schnek::GridContainer<Checkpoint::WordGrid> in;
+  in.grid.resize(lo, hi);
+  in.grid = Checkpoint::Word(0);
+  in.global_min = in.local_min = lo;
+  in.global_max = in.local_max = hi;
+
+  schnek::HdfIStream input(fileName);
+  input.setBlockName("field");
+  input.readGrid(in);
+  input.close();
+  std::remove(fileName);
+
+  FortranGrid restored(base);
+  Checkpoint::applyDifference(restored, in.grid);
+  for (const FortranGrid::IndexType &pos : range)
+  {
+    BOOST_CHECK_EQUAL(restored[pos], field[pos]);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
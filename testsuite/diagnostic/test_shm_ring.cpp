@@ -0,0 +1,180 @@
+/*
+ * test_shm_ring.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <diagnostic/shmdiagnostic.hpp>
+
+#ifdef SCHNEK_HAVE_POSIX_IO
+
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct ShmRingTest
+{
+    std::string name;
+    schnek::ShmRingWriter writer;
+    schnek::ShmRingReader reader;
+
+    ShmRingTest() : name("/schnek_test_ring_" + std::to_string(::getpid())) {}
+
+    void open(schnek::ShmRingPolicy policy, size_t slots)
+    {
+      writer.open(name, slots, sizeof(int));
+      writer.setPolicy(policy);
+      BOOST_REQUIRE(reader.open(name));
+    }
+
+    /// Write a snapshot holding a single int, returns false if it has been dropped
+    bool write(int value)
+    {
+      void *slot = writer.beginWrite(sizeof(int));
+      if (!slot) return false;
+      std::memcpy(slot, &value, sizeof(int));
+      writer.commit(sizeof(int));
+      return true;
+    }
+
+    template<typename T>
+    static void checkEqual(const std::vector<T> &actual, const std::vector<T> &expected)
+    {
+      BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(), expected.begin(), expected.end());
+    }
+
+    /// Read the snapshots, the values and the sequence numbers are appended to the vectors
+    void readAll(std::vector<int> &values, std::vector<uint64_t> &sequences)
+    {
+      std::vector<char> snapshot;
+      while (reader.next(snapshot))
+      {
+        BOOST_REQUIRE_EQUAL(snapshot.size(), sizeof(int));
+        int value;
+        std::memcpy(&value, snapshot.data(), sizeof(int));
+        values.push_back(value);
+        sequences.push_back(reader.getSequence());
+      }
+    }
+};
+
+BOOST_AUTO_TEST_SUITE( diagnostic )
+
+BOOST_AUTO_TEST_SUITE( shm_ring )
+
+BOOST_FIXTURE_TEST_CASE( drop, ShmRingTest )
+{
+  open(schnek::ShmRingPolicy::Drop, 2);
+  BOOST_CHECK(write(0));
+  BOOST_CHECK(write(1));
+  BOOST_CHECK(!write(2));
+  BOOST_CHECK(!write(3));
+  BOOST_CHECK_EQUAL(writer.getDropped(), 2u);
+  BOOST_CHECK_EQUAL(reader.getDropped(), 2u);
+
+  // the oldest snapshots are kept
+  std::vector<int> values;
+  std::vector<uint64_t> sequences;
+  readAll(values, sequences);
+  checkEqual<int>(values, {0, 1});
+  checkEqual<uint64_t>(sequences, {0, 1});
+
+  // the slots can be used again once they have been read
+  BOOST_CHECK(write(4));
+  values.clear();
+  sequences.clear();
+  readAll(values, sequences);
+  checkEqual<int>(values, {4});
+  checkEqual<uint64_t>(sequences, {2});
+}
+
+BOOST_FIXTURE_TEST_CASE( overwrite, ShmRingTest )
+{
+  open(schnek::ShmRingPolicy::Overwrite, 2);
+  for (int i = 0; i < 5; ++i) BOOST_CHECK(write(i));
+  BOOST_CHECK_EQUAL(writer.getDropped(), 3u);
+
+  // the tail has moved past the overwritten snapshots
+  std::vector<int> values;
+  std::vector<uint64_t> sequences;
+  readAll(values, sequences);
+  checkEqual<int>(values, {3, 4});
+  checkEqual<uint64_t>(sequences, {3, 4});
+}
+
+BOOST_FIXTURE_TEST_CASE( coalesce, ShmRingTest )
+{
+  open(schnek::ShmRingPolicy::Coalesce, 2);
+  for (int i = 0; i < 5; ++i) BOOST_CHECK(write(i));
+  BOOST_CHECK_EQUAL(writer.getDropped(), 3u);
+
+  // the newest slot holds the latest snapshot, the head has not moved
+  std::vector<int> values;
+  std::vector<uint64_t> sequences;
+  readAll(values, sequences);
+  checkEqual<int>(values, {0, 4});
+  checkEqual<uint64_t>(sequences, {0, 1});
+
+  BOOST_CHECK(write(5));
+  values.clear();
+  sequences.clear();
+  readAll(values, sequences);
+  checkEqual<int>(values, {5});
+  checkEqual<uint64_t>(sequences, {2});
+}
+
+BOOST_FIXTURE_TEST_CASE( too_large, ShmRingTest )
+{
+  open(schnek::ShmRingPolicy::Overwrite, 2);
+  BOOST_CHECK(writer.beginWrite(writer.getSlotSize() + 1) == nullptr);
+  BOOST_CHECK_EQUAL(writer.getDropped(), 1u);
+
+  std::vector<char> snapshot;
+  BOOST_CHECK(!reader.next(snapshot));
+}
+
+BOOST_FIXTURE_TEST_CASE( finished, ShmRingTest )
+{
+  open(schnek::ShmRingPolicy::Drop, 2);
+  BOOST_CHECK(write(7));
+  BOOST_CHECK(!reader.finished());
+
+  writer.close();
+  BOOST_CHECK(reader.finished());
+
+  // unread snapshots can still be read after the producer has closed the ring
+  std::vector<int> values;
+  std::vector<uint64_t> sequences;
+  readAll(values, sequences);
+  checkEqual<int>(values, {7});
+
+  // the shared memory object has been removed
+  schnek::ShmRingReader late;
+  BOOST_CHECK(!late.open(name));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
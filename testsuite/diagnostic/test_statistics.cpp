@@ -0,0 +1,151 @@
+/*
+ * test_statistics.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: Holger Schmitz
+ *
+ * This file is part of Schnek.
+ *
+ * Schnek is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Schnek is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Schnek.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <diagnostic/statistics.hpp>
+#include <grid/domainsubdivision.hpp>
+#include <grid/field.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+typedef schnek::Field<double, 1> StatisticsField;
+
+/// Exposes the statistics of a serial field
+class TestStatistics : public schnek::FieldStatisticsDiagnostic<StatisticsField>
+{
+  private:
+    schnek::SerialSubdivision<StatisticsField> subdivision;
+    StatisticsField data;
+
+  public:
+    TestStatistics()
+    {
+      this->field = &data;
+      this->fname = "test_statistics.dat";
+    }
+
+    /// The diagnostic registers itself with the DiagnosticManager, so a single instance lives until the end
+    static TestStatistics &instance()
+    {
+      static TestStatistics statistics;
+      return statistics;
+    }
+
+    /// Fill the inner cells of the field, the ghost cells hold values that must not be counted
+    void setValues(const std::vector<double> &values)
+    {
+      StatisticsField::IndexType lo(0), hi(values.size() - 1);
+      schnek::Range<double, 1> domain(schnek::Array<double, 1>(0.0), schnek::Array<double, 1>(1.0));
+      data.resize(lo, hi, domain, schnek::Array<bool, 1>(false), 1);
+      data = 1e6;
+      for (size_t i = 0; i < values.size(); ++i) data[i] = values[i];
+    }
+
+    std::vector<double> histogram(int bins, double lo, double hi)
+    {
+      std::vector<double> counts(bins, 0.0);
+      fillHistogram(counts, lo, hi);
+      return counts;
+    }
+
+    void calculate()
+    {
+      write();
+      std::remove(this->fname.c_str());
+    }
+
+    double getMinimum() const { return minimum; }
+    double getMaximum() const { return maximum; }
+    double getMean() const { return mean; }
+    double getL2Norm() const { return l2Norm; }
+
+  protected:
+    schnek::DomainSubdivision<StatisticsField> &getSubdivision() { return subdivision; }
+};
+
+void checkCounts(const std::vector<double> &counts, const std::vector<double> &expected)
+{
+  BOOST_CHECK_EQUAL_COLLECTIONS(counts.begin(), counts.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_SUITE( diagnostic )
+
+BOOST_AUTO_TEST_SUITE( statistics )
+
+BOOST_AUTO_TEST_CASE( fixed_limits )
+{
+  TestStatistics &statistics = TestStatistics::instance();
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // the lower edge belongs to a bin, the upper edge to the next one
+  statistics.setValues({0.0, 0.999, 1.0, 2.5, 3.999, 4.0});
+  checkCounts(statistics.histogram(4, 0.0, 4.0), {2.0, 1.0, 1.0, 2.0});
+
+  // values outside the limits, including infinities and values too large for an int, are clamped
+  statistics.setValues({-1.0, -1e300, -inf, 5.0, 1e300, inf});
+  checkCounts(statistics.histogram(4, 0.0, 4.0), {3.0, 0.0, 0.0, 3.0});
+
+  // NaN values are not counted
+  statistics.setValues({nan, 0.5, nan, 3.5});
+  checkCounts(statistics.histogram(4, 0.0, 4.0), {1.0, 0.0, 0.0, 1.0});
+}
+
+BOOST_AUTO_TEST_CASE( adaptive_limits )
+{
+  TestStatistics &statistics = TestStatistics::instance();
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  // the limits are the minimum and maximum, the maximum is counted in the last bin
+  statistics.setValues({-2.0, nan, -1.0, 0.0, 1.0, 2.0});
+  statistics.calculate();
+  BOOST_CHECK_EQUAL(statistics.getMinimum(), -2.0);
+  BOOST_CHECK_EQUAL(statistics.getMaximum(), 2.0);
+  checkCounts(statistics.histogram(4, statistics.getMinimum(), statistics.getMaximum()), {1.0, 1.0, 1.0, 2.0});
+
+  // all values in the first bin if the limits are equal
+  statistics.setValues({3.0, 3.0, nan});
+  statistics.calculate();
+  checkCounts(statistics.histogram(2, statistics.getMinimum(), statistics.getMaximum()), {2.0, 0.0});
+}
+
+BOOST_AUTO_TEST_CASE( nan_values )
+{
+  TestStatistics &statistics = TestStatistics::instance();
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  // NaN values are left out of the mean and the norm as well
+  statistics.setValues({nan, 3.0, nan, -4.0, 1.0});
+  statistics.calculate();
+  BOOST_CHECK_EQUAL(statistics.getMinimum(), -4.0);
+  BOOST_CHECK_EQUAL(statistics.getMaximum(), 3.0);
+  BOOST_CHECK_EQUAL(statistics.getMean(), 0.0);
+  BOOST_CHECK_CLOSE(statistics.getL2Norm(), std::sqrt(26.0), 1e-12);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
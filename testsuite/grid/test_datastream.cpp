@@ -0,0 +1,128 @@
+/*
+ * test_datastream.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include "../utility.hpp"
+
+#include <datastream.hpp>
+#include <grid/grid.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+using namespace schnek;
+
+BOOST_AUTO_TEST_SUITE( datastream )
+
+typedef Grid<double, 2> Grid2d;
+typedef Grid<int, 3> Grid3i;
+
+// The format of the stream operators before the buffered writer was introduced
+std::string referenceText(const Grid2d &grid, std::ostream &format)
+{
+  std::ostringstream out;
+  out.copyfmt(format);
+  for (int j = grid.getLo()[1]; j <= grid.getHi()[1]; ++j)
+  {
+    out << grid(grid.getLo()[0], j);
+    for (int i = grid.getLo()[0] + 1; i <= grid.getHi()[0]; ++i) out << " " << grid(i, j);
+    out << std::endl;
+  }
+  return out.str();
+}
+
+void fill(Grid2d &grid)
+{
+  for (int j = grid.getLo()[1]; j <= grid.getHi()[1]; ++j)
+    for (int i = grid.getLo()[0]; i <= grid.getHi()[0]; ++i)
+      grid(i, j) = std::sin(0.37*i + 1.3*j) * std::pow(10.0, (i + 3*j) % 41 - 20);
+
+  grid(grid.getLo()[0], grid.getLo()[1]) = 0.0;
+  grid(grid.getHi()[0], grid.getHi()[1]) = -std::numeric_limits<double>::infinity();
+}
+
+BOOST_AUTO_TEST_CASE( text_default_format )
+{
+  Grid2d grid(Grid2d::IndexType(-3, 2), Grid2d::IndexType(400, 60));
+  fill(grid);
+
+  std::ostringstream out;
+  out << grid;
+  BOOST_CHECK(out.str() == referenceText(grid, out));
+}
+
+BOOST_AUTO_TEST_CASE( text_precision )
+{
+  Grid2d grid(Grid2d::IndexType(0, 0), Grid2d::IndexType(50, 20));
+  fill(grid);
+
+  std::ostringstream out;
+  out.precision(14);
+  out << grid;
+  BOOST_CHECK(out.str() == referenceText(grid, out));
+}
+
+BOOST_AUTO_TEST_CASE( text_stream_flags )
+{
+  Grid2d grid(Grid2d::IndexType(0, 0), Grid2d::IndexType(20, 10));
+  fill(grid);
+
+  std::ostringstream out;
+  out << std::scientific << std::showpos << std::setprecision(3);
+  out << grid;
+  BOOST_CHECK(out.str() == referenceText(grid, out));
+}
+
+BOOST_AUTO_TEST_CASE( text_integer_3d )
+{
+  Grid3i grid(Grid3i::IndexType(-2, 0, 1), Grid3i::IndexType(5, 3, 2));
+  std::ostringstream reference;
+  for (int k = 1; k <= 2; ++k)
+  {
+    for (int j = 0; j <= 3; ++j)
+    {
+      for (int i = -2; i <= 5; ++i)
+      {
+        grid(i, j, k) = (i - 3*j) * 1000 * k;
+        reference << (i > -2 ? " " : "") << grid(i, j, k);
+      }
+      reference << "\n";
+    }
+    reference << "\n";
+  }
+
+  std::ostringstream out;
+  out << grid;
+  BOOST_CHECK(out.str() == reference.str());
+}
+
+BOOST_AUTO_TEST_CASE( binary_grid )
+{
+  Grid2d grid(Grid2d::IndexType(1, -1), Grid2d::IndexType(7, 4));
+  fill(grid);
+
+  std::ostringstream out;
+  writeBinary(out, grid);
+  std::string data = out.str();
+  BOOST_REQUIRE_EQUAL(data.size(), 7*6*sizeof(double));
+
+  size_t count = 0;
+  for (int j = -1; j <= 4; ++j)
+    for (int i = 1; i <= 7; ++i)
+    {
+      double value;
+      std::memcpy(&value, data.data() + count*sizeof(double), sizeof(double));
+      BOOST_CHECK_EQUAL(value, grid(i, j));
+      ++count;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,6 +17,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include <cmath>
 
 #pragma GCC diagnostic push
@@ -171,6 +172,25 @@ std::string parser_input_count_evaluation =
     "test1 = eval1();\n"
     "test3 = eval3(x,y);\n";
 
+std::string parser_input_bytecode =
+    "float k = 2.5;\n"
+    "int n = xi/3 - yi^2;\n"
+    "float r = sqrt(x*x + y*y);\n"
+    "test1 = sin(k*x)*exp(-(x-y)^2) + n;\n"
+    "test2 = atan2(y, x) - fmod(x, 3) + fabs(x)/(1+x*x) - min(x, y)/max(1, y);\n"
+    "test3 = -x/y + 1/(2*y) - pow(r, 1.5);\n"
+    "test4 = twice(x) + r;\n"
+    "test_int1 = -n*(xi - yi)/(yi^2 + 1);\n"
+    "test_int2 = 2*xi - floor(r);\n";
+
+std::string parser_input_simplify =
+    "float pi = 3.14159265358979;\n"
+    "float lambda = 0.5;\n"
+    "test1 = sin(2*pi/lambda*x);\n"
+    "test2 = sin(2*pi/lambda*x)*exp(-y*y) + exp(-y*y);\n"
+    "test3 = sin(2*pi/lambda*x);\n"
+    "test4 = counter() - counter();\n";
+
 int NSteps;
 
 double dx;
@@ -819,4 +839,324 @@ BOOST_FIXTURE_TEST_CASE( parser_count_evaluations, ParserTest )
   }
 }
 
+double twice(double x) {
+  return 2.0*x;
+}
+
+BOOST_FIXTURE_TEST_CASE( parser_bytecode, ParserTest )
+{
+  x=1.0;
+  y=1.0;
+  registerAllFunctions(freg);
+  freg.registerFunction("twice", twice);
+  init(parser_input_bytecode);
+
+  const int N = 10000;
+
+  boost::random::mt19937 rGen;
+  boost::random::uniform_real_distribution<> dist(0.5, 5.0);
+  boost::random::uniform_int_distribution<> distI(-10, 10);
+
+  // the expression trees before the updater replaces them by their bytecode
+  pFloatExpression tree1 = boost::get<pFloatExpression>(test1Var->getVariable()->getExpression());
+  pFloatExpression tree4 = boost::get<pFloatExpression>(test4Var->getVariable()->getExpression());
+  pIntExpression treeInt1 = boost::get<pIntExpression>(test_int1Var->getVariable()->getExpression());
+
+  CompiledExpression<double> compiled1(tree1);
+  CompiledExpression<double> compiled4(tree4);
+  CompiledExpression<int> compiledInt1(treeInt1);
+
+  // built-in functions are compiled into instructions, others are evaluated from the registers
+  for (const BytecodeInstruction &ins : compiled1.getProgram().getInstructions())
+    BOOST_CHECK(ins.op != BytecodeOp::Call && ins.op != BytecodeOp::Function);
+  int calls = 0;
+  for (const BytecodeInstruction &ins : compiled4.getProgram().getInstructions())
+    if (ins.op == BytecodeOp::Function) ++calls;
+  BOOST_CHECK_EQUAL(calls, 1);
+
+  BOOST_CHECK(compiled1.getDependencies() == tree1->getDependencies());
+  BOOST_CHECK_EQUAL(compiled1.isConstant(), tree1->isConstant());
+
+  pDependencyMap depMap(new DependencyMap(vars.getRootBlock()));
+  DependencyUpdater updater(depMap);
+
+  updater.addIndependent(xVar);
+  updater.addIndependent(yVar);
+  updater.addIndependent(xiVar);
+  updater.addIndependent(yiVar);
+  updater.addDependent(test1Var);
+  updater.addDependent(test2Var);
+  updater.addDependent(test3Var);
+  updater.addDependent(test4Var);
+  updater.addDependent(test_int1Var);
+  updater.addDependent(test_int2Var);
+
+  for (int i=0; i<N; ++i)
+  {
+    x = dist(rGen);
+    y = dist(rGen);
+    xi = distI(rGen);
+    yi = distI(rGen);
+
+    updater.update();
+
+    double k = 2.5;
+    int n = xi/3 - yi*yi;
+    double r = sqrt(x*x + y*y);
+
+    BOOST_CHECK_CLOSE(test1, sin(k*x)*exp(-(x-y)*(x-y)) + n, 1e-10);
+    BOOST_CHECK_CLOSE(test2, atan2(y, x) - fmod(x, 3.0) + fabs(x)/(1+x*x) - std::min(x, y)/std::max(1.0, y), 1e-10);
+    BOOST_CHECK_CLOSE(test3, -x/y + 1/(2*y) - pow(r, 1.5), 1e-10);
+    BOOST_CHECK_CLOSE(test4, 2.0*x + r, 1e-10);
+    BOOST_CHECK_EQUAL(test_int1, -n*(xi - yi)/(yi*yi + 1));
+    BOOST_CHECK_EQUAL(test_int2, static_cast<int>(2*xi - floor(r)));
+
+    // the bytecode agrees with the expression tree
+    BOOST_CHECK_EQUAL(compiled1.eval(), tree1->eval());
+    BOOST_CHECK_EQUAL(compiled4.eval(), tree4->eval());
+    BOOST_CHECK_EQUAL(compiledInt1.eval(), treeInt1->eval());
+  }
+}
+
+int twiceVectorCalls = 0;
+
+void twiceVector(size_t count, const double *const *args, double *result) {
+  ++twiceVectorCalls;
+  for (size_t j=0; j<count; ++j) result[j] = 2.0*args[0][j];
+}
+
+BOOST_FIXTURE_TEST_CASE( parser_bytecode_batch, ParserTest )
+{
+  x=1.0;
+  y=1.0;
+  registerAllFunctions(freg);
+  freg.registerVectorFunction("twice", twice, twiceVector);
+  init(parser_input_bytecode);
+
+  const int N = 1000;
+
+  boost::random::mt19937 rGen;
+  boost::random::uniform_real_distribution<> dist(0.5, 5.0);
+  boost::random::uniform_int_distribution<> distI(-10, 10);
+
+  pDependencyMap depMap(new DependencyMap(vars.getRootBlock()));
+  DependencyUpdater updater(depMap);
+
+  updater.addIndependent(xVar);
+  updater.addIndependent(yVar);
+  updater.addIndependent(xiVar);
+  updater.addIndependent(yiVar);
+  updater.addDependent(test1Var);
+  updater.addDependent(test2Var);
+  updater.addDependent(test3Var);
+  updater.addDependent(test4Var);
+  updater.addDependent(test_int2Var);
+
+  std::vector<double> values(N);
+  std::vector<double> results1(N), results2(N), results3(N), results4(N);
+  std::vector<int> resultsInt2(N);
+
+  for (int i=0; i<10; ++i)
+  {
+    y = dist(rGen);
+    xi = distI(rGen);
+    yi = distI(rGen);
+    for (int j=0; j<N; ++j) values[j] = dist(rGen);
+
+    updater.updateBatch(&x, values.data(), N, test1, results1.data());
+    updater.updateBatch(&x, values.data(), N, test2, results2.data());
+    updater.updateBatch(&x, values.data(), N, test3, results3.data());
+    // the vector overload is called once for every chunk of the batch
+    twiceVectorCalls = 0;
+    updater.updateBatch(&x, values.data(), N, test4, results4.data());
+    BOOST_CHECK(twiceVectorCalls > 0);
+    BOOST_CHECK(twiceVectorCalls < N);
+    updater.updateBatch(&x, values.data(), N, test_int2, resultsInt2.data());
+
+    // the batches agree with the updates of single values
+    for (int j=0; j<N; ++j)
+    {
+      x = values[j];
+      updater.update();
+      BOOST_CHECK_CLOSE(results1[j], test1, 1e-10);
+      BOOST_CHECK_CLOSE(results2[j], test2, 1e-10);
+      BOOST_CHECK_CLOSE(results3[j], test3, 1e-10);
+      BOOST_CHECK_CLOSE(results4[j], test4, 1e-10);
+      BOOST_CHECK_EQUAL(resultsInt2[j], test_int2);
+    }
+  }
+}
+
+int simplify_counter;
+
+double count_calls() {
+  return ++simplify_counter;
+}
+
+BOOST_FIXTURE_TEST_CASE( parser_simplify, ParserTest )
+{
+  registerAllFunctions(freg);
+  freg.registerFunction("counter", count_calls, true);
+  init(parser_input_simplify);
+
+  pFloatExpression expr1 = boost::get<pFloatExpression>(test1Var->getVariable()->getExpression());
+  pFloatExpression expr2 = boost::get<pFloatExpression>(test2Var->getVariable()->getExpression());
+  pFloatExpression expr3 = boost::get<pFloatExpression>(test3Var->getVariable()->getExpression());
+
+  // identical expressions are shared
+  BOOST_CHECK(expr1 == expr3);
+
+  // 2*pi/lambda has been replaced by its value
+  CompiledExpression<double> compiled1(expr1);
+  int multiplications = 0;
+  int loads = 0;
+  for (const BytecodeInstruction &ins : compiled1.getProgram().getInstructions())
+  {
+    BOOST_CHECK(ins.op != BytecodeOp::Divide);
+    if (ins.op == BytecodeOp::Multiply) ++multiplications;
+    if (ins.op == BytecodeOp::Load) ++loads;
+  }
+  BOOST_CHECK_EQUAL(multiplications, 1);
+  BOOST_CHECK_EQUAL(loads, 1);
+
+  // the shared exp(-y*y) is evaluated once
+  CompiledExpression<double> compiled2(expr2);
+  int exponentials = 0;
+  for (const BytecodeInstruction &ins : compiled2.getProgram().getInstructions())
+    if (ins.op == BytecodeOp::Exp) ++exponentials;
+  BOOST_CHECK_EQUAL(exponentials, 1);
+
+  pDependencyMap depMap(new DependencyMap(vars.getRootBlock()));
+  DependencyUpdater updater(depMap);
+
+  updater.addIndependent(xVar);
+  updater.addIndependent(yVar);
+  updater.addDependent(test1Var);
+  updater.addDependent(test2Var);
+  updater.addDependent(test3Var);
+  updater.addDependent(test4Var);
+
+  boost::random::mt19937 rGen;
+  boost::random::uniform_real_distribution<> dist(-2.0, 2.0);
+
+  for (int i=0; i<100; ++i)
+  {
+    x = dist(rGen);
+    y = dist(rGen);
+    updater.update();
+
+    double k = 2*3.14159265358979/0.5;
+    BOOST_CHECK_CLOSE(test1, sin(k*x), 1e-10);
+    BOOST_CHECK_CLOSE(test2, sin(k*x)*exp(-y*y) + exp(-y*y), 1e-10);
+    BOOST_CHECK_CLOSE(test3, sin(k*x), 1e-10);
+
+    // functions that are evaluated at every update are not shared
+    BOOST_CHECK_EQUAL(test4, -1.0);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE( parser_loop_hoisting, ParserTest )
+{
+  const int N = 100;
+
+  freg.registerFunction("eval1", count_evaluation1);
+  freg.registerFunction("eval2", count_evaluation2);
+  freg.registerFunction("eval3", count_evaluation3);
+  freg.registerFunction("eval4", count_evaluation4, true);
+
+  init(parser_input_count_evaluation);
+
+  pDependencyMap depMap(new DependencyMap(vars.getRootBlock()));
+  DependencyUpdater updater(depMap);
+
+  updater.addIndependent(xVar);
+  updater.addIndependent(yVar);
+  updater.addDependent(test2Var);
+  updater.addDependent(test3Var);
+
+  evaluation_counter2 = 0;
+  evaluation_counter3 = 0;
+
+  std::vector<double *> loops{&x, &y};
+  std::vector<double> values(N);
+  std::vector<double> results(N);
+  for (int j=0; j<N; ++j) values[j] = 3.0*j;
+
+  for (int i=0; i<N; ++i)
+  {
+    x = 2.0*i;
+    updater.updateLoop(loops, 0);
+    updater.updateBatch(loops, values.data(), N, test3, results.data());
+    for (int j=0; j<N; ++j)
+      BOOST_CHECK_CLOSE(results[j], 2.0*x + 3.0*values[j], 1e-8);
+
+    updater.updateBatch(loops, values.data(), N, test2, results.data());
+    for (int j=0; j<N; ++j)
+      BOOST_CHECK_CLOSE(results[j], 2.0*x, 1e-8);
+  }
+
+  // terms depending only on the outer loop are evaluated once per outer iteration
+  BOOST_CHECK_EQUAL(evaluation_counter2, N);
+  BOOST_CHECK_EQUAL(evaluation_counter3, N*N);
+
+  // a single loop over y evaluates the terms depending on x once per batch
+  evaluation_counter2 = 0;
+  updater.updateBatch(&y, values.data(), N, test2, results.data());
+  BOOST_CHECK_EQUAL(evaluation_counter2, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE( parser_loop_unregistered, ParserTest )
+{
+  registerAllFunctions(freg);
+  freg.registerVectorFunction("twice", twice, twiceVector);
+  init(parser_input_bytecode);
+
+  const int N = 100;
+
+  pDependencyMap depMap(new DependencyMap(vars.getRootBlock()));
+  DependencyUpdater updater(depMap);
+
+  // y is not an independent parameter, so nothing is known about the variables that depend on it
+  updater.addIndependent(xVar);
+  updater.addIndependent(xiVar);
+  updater.addIndependent(yiVar);
+  updater.addDependent(test1Var);
+  updater.addDependent(test3Var);
+
+  xi = 2;
+  yi = 1;
+
+  std::vector<double *> loops{&x, &y};
+  std::vector<double> values(N);
+  std::vector<double> results1(N), results3(N);
+  for (int j=0; j<N; ++j) values[j] = 0.5 + 0.05*j;
+
+  for (int i=0; i<10; ++i)
+  {
+    x = 0.3*i + 0.1;
+    updater.updateLoop(loops, 0);
+    updater.updateBatch(loops, values.data(), N, test1, results1.data());
+    updater.updateBatch(loops, values.data(), N, test3, results3.data());
+
+    // the results change with every value, as they do for single updates
+    for (int j=0; j<N; ++j)
+    {
+      y = values[j];
+      updater.update();
+      BOOST_CHECK_CLOSE(results1[j], test1, 1e-10);
+      BOOST_CHECK_CLOSE(results3[j], test3, 1e-10);
+    }
+  }
+
+  // the same holds for a single loop over the unregistered value
+  x = 1.7;
+  updater.updateBatch(&y, values.data(), N, test3, results3.data());
+  for (int j=0; j<N; ++j)
+  {
+    y = values[j];
+    updater.update();
+    BOOST_CHECK_CLOSE(results3[j], test3, 1e-10);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()